@@ -0,0 +1,382 @@
+#pragma once
+
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "pyoptinterface/core.hpp"
+#include "pyoptinterface/container.hpp"
+
+// Handles of the variables and constraints read from a file, keyed by their names
+using CacheModelFileHandles = std::pair<std::unordered_map<std::string, VariableIndex>,
+                                        std::unordered_map<std::string, ConstraintIndex>>;
+
+// Handles of the flushed variables and constraints in the backend model
+// Variables and linear constraints are added in one call each, so their handles are the handles
+// of the cache shifted by an offset. The other constraints are added one by one and the handle
+// the backend returns is recorded for each of them, the backend may count them in another index
+// space, e.g. MOSEK numbers quadratic constraints after the linear ones.
+struct CacheModelFlushHandles
+{
+	IndexT variable_offset = 0;
+	IndexT linear_offset = 0;
+	Vector<ConstraintIndex> quadratic_constraints, sos_constraints, cone_constraints;
+
+	// the handle in the backend of a handle of the cache
+	VariableIndex variable(const VariableIndex &variable) const;
+	ConstraintIndex constraint(const ConstraintIndex &constraint) const;
+};
+
+// A solver-independent in-memory model
+// Variables are stored as columnar arrays, linear constraints as a CSR matrix, quadratic
+// constraints as COO blocks, SOS and cone constraints as flat lists with start offsets.
+// The model can be flushed into any backend by its bulk APIs.
+//
+// Deleted variables and constraints stay in the arrays and are only marked inactive in the
+// indexers, so the backend model adds everything in one shot and deletes the inactive ones
+// afterwards, and the i-th item of the cache is always the i-th item added to the backend.
+class CacheModel
+{
+  public:
+	static constexpr double INF = std::numeric_limits<double>::infinity();
+
+	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous,
+	                           double lb = -INF, double ub = INF, const char *name = nullptr);
+	VariableIndex add_variables(int N, const Vector<VariableDomain> &domains,
+	                            const Vector<double> &lbs, const Vector<double> &ubs,
+	                            const Vector<std::string> &names);
+	void delete_variable(const VariableIndex &variable);
+	bool is_variable_active(const VariableIndex &variable) const;
+	size_t number_of_variables() const;
+
+	ConstraintIndex add_linear_constraint(const ScalarAffineFunction &function,
+	                                      ConstraintSense sense, CoeffT rhs,
+	                                      const char *name = nullptr);
+	ConstraintIndex add_linear_constraints(std::span<const IndexT> row_starts,
+	                                       std::span<const IndexT> variables,
+	                                       std::span<const CoeffT> coefficients,
+	                                       const Vector<ConstraintSense> &senses,
+	                                       std::span<const CoeffT> rhss,
+	                                       const Vector<std::string> &names);
+	ConstraintIndex add_quadratic_constraint(const ScalarQuadraticFunction &function,
+	                                         ConstraintSense sense, CoeffT rhs,
+	                                         const char *name = nullptr);
+	ConstraintIndex add_sos_constraint(const Vector<VariableIndex> &variables, SOSType sos_type,
+	                                   const Vector<CoeffT> &weights = {});
+	ConstraintIndex add_second_order_cone_constraint(const Vector<VariableIndex> &variables,
+	                                                 const char *name = nullptr,
+	                                                 bool rotated = false);
+
+	void delete_constraint(const ConstraintIndex &constraint);
+	bool is_constraint_active(const ConstraintIndex &constraint) const;
+	size_t number_of_constraints(ConstraintType type) const;
+
+	void set_objective(const ScalarAffineFunction &function, ObjectiveSense sense);
+	void set_objective(const ScalarQuadraticFunction &function, ObjectiveSense sense);
+	void set_objective(const ExprBuilder &function, ObjectiveSense sense);
+
+	void clear();
+
+	// Write the model to a free MPS (.mps) or CPLEX LP (.lp) file without any solver
+	// The rows are formatted by n_threads threads, the file is the same for any n_threads
+	void write(const std::string &filename, int n_threads = 1) const;
+	// Read a free MPS (.mps) or CPLEX LP (.lp) file and append its content to the model
+	CacheModelFileHandles read(const std::string &filename);
+
+	// Save the whole model including deleted variables and constraints to a binary snapshot
+	void save_snapshot(const std::string &filename) const;
+	// Replace the model by a snapshot saved by save_snapshot
+	void load_snapshot(const std::string &filename);
+
+	// Add the whole model into a backend model and return the handles the backend assigned
+	template <typename ModelT>
+	CacheModelFlushHandles flush(ModelT &model) const;
+
+  private:
+	friend class CacheModelWriter;
+	friend class CacheModelSnapshot;
+
+	void _check_variables(std::span<const IndexT> variables) const;
+
+	// variables
+	MonotoneIndexer<int> m_variable_index;
+	size_t m_n_variables = 0;
+	Vector<VariableDomain> m_variable_domains;
+	Vector<double> m_variable_lbs;
+	Vector<double> m_variable_ubs;
+	Vector<std::string> m_variable_names;
+	bool m_has_variable_names = false;
+
+	// linear constraints in CSR form, row i has the terms [row_starts[i], row_starts[i+1])
+	MonotoneIndexer<int> m_linear_constraint_index;
+	size_t m_n_linear_constraints = 0;
+	Vector<IndexT> m_linear_row_starts = {0};
+	Vector<IndexT> m_linear_variables;
+	Vector<CoeffT> m_linear_coefficients;
+	Vector<ConstraintSense> m_linear_senses;
+	Vector<CoeffT> m_linear_rhss;
+	Vector<std::string> m_linear_names;
+	bool m_has_linear_names = false;
+
+	// quadratic constraints, the quadratic part of constraint i is the COO block
+	// [quadratic_starts[i], quadratic_starts[i+1]) and its affine part is the CSR row
+	// [affine_starts[i], affine_starts[i+1])
+	MonotoneIndexer<int> m_quadratic_constraint_index;
+	size_t m_n_quadratic_constraints = 0;
+	Vector<IndexT> m_quadratic_starts = {0};
+	Vector<IndexT> m_quadratic_variable_1s;
+	Vector<IndexT> m_quadratic_variable_2s;
+	Vector<CoeffT> m_quadratic_coefficients;
+	Vector<IndexT> m_quadratic_affine_starts = {0};
+	Vector<IndexT> m_quadratic_affine_variables;
+	Vector<CoeffT> m_quadratic_affine_coefficients;
+	Vector<ConstraintSense> m_quadratic_senses;
+	Vector<CoeffT> m_quadratic_rhss;
+	Vector<std::string> m_quadratic_names;
+
+	// SOS constraints, constraint i has the members [sos_starts[i], sos_starts[i+1])
+	MonotoneIndexer<int> m_sos_constraint_index;
+	size_t m_n_sos_constraints = 0;
+	Vector<IndexT> m_sos_starts = {0};
+	Vector<IndexT> m_sos_variables;
+	Vector<CoeffT> m_sos_weights;
+	Vector<SOSType> m_sos_types;
+
+	// second order cone constraints, constraint i has the members [cone_starts[i],
+	// cone_starts[i+1])
+	MonotoneIndexer<int> m_cone_constraint_index;
+	size_t m_n_cone_constraints = 0;
+	Vector<IndexT> m_cone_starts = {0};
+	Vector<IndexT> m_cone_variables;
+	Vector<bool> m_cone_rotated;
+	Vector<std::string> m_cone_names;
+
+	std::optional<ScalarQuadraticFunction> m_objective;
+	ObjectiveSense m_objective_sense = ObjectiveSense::Minimize;
+};
+
+namespace cache_model
+{
+// Copy variables and shift them by offset
+inline Vector<IndexT> shifted(std::span<const IndexT> variables, IndexT offset)
+{
+	Vector<IndexT> result(variables.begin(), variables.end());
+	if (offset != 0)
+	{
+		for (auto &v : result)
+		{
+			v += offset;
+		}
+	}
+	return result;
+}
+
+inline Vector<VariableIndex> shifted_variables(std::span<const IndexT> variables, IndexT offset)
+{
+	Vector<VariableIndex> result;
+	result.reserve(variables.size());
+	for (auto v : variables)
+	{
+		result.emplace_back(v + offset);
+	}
+	return result;
+}
+
+inline ScalarAffineFunction shifted_function(std::span<const IndexT> variables,
+                                             std::span<const CoeffT> coefficients, IndexT offset)
+{
+	ScalarAffineFunction f;
+	f.variables = shifted(variables, offset);
+	f.coefficients.assign(coefficients.begin(), coefficients.end());
+	return f;
+}
+
+inline ScalarQuadraticFunction shifted_function(const ScalarQuadraticFunction &function,
+                                                IndexT offset)
+{
+	ScalarQuadraticFunction f;
+	f.coefficients = function.coefficients;
+	f.variable_1s = shifted(function.variable_1s, offset);
+	f.variable_2s = shifted(function.variable_2s, offset);
+	if (function.affine_part)
+	{
+		auto &affine = function.affine_part.value();
+		auto shifted_affine = shifted_function(affine.variables, affine.coefficients, offset);
+		shifted_affine.constant = affine.constant;
+		f.affine_part = shifted_affine;
+	}
+	return f;
+}
+} // namespace cache_model
+
+template <typename ModelT>
+CacheModelFlushHandles CacheModel::flush(ModelT &model) const
+{
+	using namespace cache_model;
+
+	CacheModelFlushHandles handles;
+	const int n_variables = m_variable_domains.size();
+	IndexT offset = 0;
+	if (n_variables > 0)
+	{
+		auto first = model.add_variables(n_variables, m_variable_domains, m_variable_lbs,
+		                                  m_variable_ubs,
+		                                  m_has_variable_names ? m_variable_names
+		                                                       : Vector<std::string>{});
+		offset = first.index;
+	}
+	handles.variable_offset = offset;
+
+	const IndexT n_linear = m_linear_senses.size();
+	if (n_linear > 0)
+	{
+		auto variables = shifted(m_linear_variables, offset);
+		auto first = model.add_linear_constraints(
+		    m_linear_row_starts, variables, m_linear_coefficients, m_linear_senses, m_linear_rhss,
+		    m_has_linear_names ? m_linear_names : Vector<std::string>{});
+		handles.linear_offset = first.index;
+	}
+
+	const IndexT n_quadratic = m_quadratic_senses.size();
+	handles.quadratic_constraints.reserve(n_quadratic);
+	for (IndexT i = 0; i < n_quadratic; i++)
+	{
+		ScalarQuadraticFunction f;
+		auto q_start = m_quadratic_starts[i];
+		auto q_end = m_quadratic_starts[i + 1];
+		f.coefficients.assign(m_quadratic_coefficients.begin() + q_start,
+		                      m_quadratic_coefficients.begin() + q_end);
+		f.variable_1s =
+		    shifted(std::span(m_quadratic_variable_1s).subspan(q_start, q_end - q_start), offset);
+		f.variable_2s =
+		    shifted(std::span(m_quadratic_variable_2s).subspan(q_start, q_end - q_start), offset);
+		auto a_start = m_quadratic_affine_starts[i];
+		auto a_end = m_quadratic_affine_starts[i + 1];
+		if (a_end > a_start)
+		{
+			f.affine_part = shifted_function(
+			    std::span(m_quadratic_affine_variables).subspan(a_start, a_end - a_start),
+			    std::span(m_quadratic_affine_coefficients).subspan(a_start, a_end - a_start),
+			    offset);
+		}
+		auto constraint = model.add_quadratic_constraint(
+		    f, m_quadratic_senses[i], m_quadratic_rhss[i], m_quadratic_names[i].c_str());
+		handles.quadratic_constraints.push_back(constraint);
+	}
+
+	const IndexT n_sos = m_sos_types.size();
+	if (n_sos > 0)
+	{
+		if constexpr (requires {
+			              model.add_sos_constraint(Vector<VariableIndex>{}, SOSType::SOS1,
+			                                       Vector<CoeffT>{});
+		              })
+		{
+			for (IndexT i = 0; i < n_sos; i++)
+			{
+				auto start = m_sos_starts[i];
+				auto end = m_sos_starts[i + 1];
+				auto variables = shifted_variables(
+				    std::span(m_sos_variables).subspan(start, end - start), offset);
+				Vector<CoeffT> weights(m_sos_weights.begin() + start, m_sos_weights.begin() + end);
+				auto constraint = model.add_sos_constraint(variables, m_sos_types[i], weights);
+				handles.sos_constraints.push_back(constraint);
+			}
+		}
+		else
+		{
+			throw std::runtime_error("The model does not support SOS constraints");
+		}
+	}
+
+	const IndexT n_cone = m_cone_rotated.size();
+	if (n_cone > 0)
+	{
+		if constexpr (requires {
+			              model.add_second_order_cone_constraint(Vector<VariableIndex>{}, "",
+			                                                     false);
+		              })
+		{
+			for (IndexT i = 0; i < n_cone; i++)
+			{
+				auto start = m_cone_starts[i];
+				auto end = m_cone_starts[i + 1];
+				auto variables = shifted_variables(
+				    std::span(m_cone_variables).subspan(start, end - start), offset);
+				auto constraint = model.add_second_order_cone_constraint(
+				    variables, m_cone_names[i].c_str(), m_cone_rotated[i]);
+				handles.cone_constraints.push_back(constraint);
+			}
+		}
+		else
+		{
+			throw std::runtime_error("The model does not support second order cone constraints");
+		}
+	}
+
+	if (m_objective)
+	{
+		auto &objective = m_objective.value();
+		if (objective.size() == 0)
+		{
+			ScalarAffineFunction f;
+			if (objective.affine_part)
+			{
+				auto &affine = objective.affine_part.value();
+				f = shifted_function(affine.variables, affine.coefficients, offset);
+				f.constant = affine.constant;
+			}
+			model.set_objective(f, m_objective_sense);
+		}
+		else
+		{
+			model.set_objective(shifted_function(objective, offset), m_objective_sense);
+		}
+	}
+
+	// remove what has been deleted in the cache, constraints first because deleting variables
+	// changes the constraints
+	auto delete_inactive = [&](const MonotoneIndexer<int> &indexer, ConstraintType type,
+	                           IndexT N) {
+		for (IndexT i = 0; i < N; i++)
+		{
+			if (!indexer.has_index(i))
+			{
+				model.delete_constraint(handles.constraint(ConstraintIndex(type, i)));
+			}
+		}
+	};
+	if (m_n_linear_constraints < n_linear)
+	{
+		delete_inactive(m_linear_constraint_index, ConstraintType::Linear, n_linear);
+	}
+	if (m_n_quadratic_constraints < n_quadratic)
+	{
+		delete_inactive(m_quadratic_constraint_index, ConstraintType::Quadratic, n_quadratic);
+	}
+	if (m_n_sos_constraints < n_sos)
+	{
+		delete_inactive(m_sos_constraint_index, ConstraintType::SOS, n_sos);
+	}
+	if (m_n_cone_constraints < n_cone)
+	{
+		delete_inactive(m_cone_constraint_index, ConstraintType::Cone, n_cone);
+	}
+	if (m_n_variables < n_variables)
+	{
+		Vector<VariableIndex> deleted;
+		for (IndexT i = 0; i < n_variables; i++)
+		{
+			if (!m_variable_index.has_index(i))
+			{
+				deleted.emplace_back(offset + i);
+			}
+		}
+		model.delete_variables(deleted);
+	}
+
+	return handles;
+}
@@ -3,9 +3,12 @@
 #include <bit>
 #include <vector>
 #include <concepts>
+#include <limits>
+#include <type_traits>
 #include <assert.h>
 
 #include "pyoptinterface/core.hpp"
+#include "pyoptinterface/thread_pool.hpp"
 
 // index as the key, variable as the value
 // index is monotone increasing
@@ -213,6 +216,8 @@ class ChunkedBitVector
 			ChunkT mask = (newelement << (m_next_bit)) &
 			              (newelement >> (CHUNK_WIDTH - m_next_bit - extra_bits_in_current_chunk));
 			last_chunk |= mask;
+			// the rank of the current chunk changes
+			m_chunk_ranks.back() = -1;
 		}
 
 		N -= extra_bits_in_current_chunk;
@@ -238,7 +243,8 @@ class ChunkedBitVector
 			ChunkT remaining_chunk = (ChunkT{1} << N_remaining_bits) - 1;
 			m_data.push_back(remaining_chunk);
 			m_cumulated_ranks.push_back(m_cumulated_ranks.back());
-			m_chunk_ranks.push_back(N_remaining_bits);
+			// the last chunk is not full, its rank changes when new indices are added
+			m_chunk_ranks.push_back(-1);
 
 			m_next_bit = N_remaining_bits;
 		}
@@ -277,6 +283,31 @@ class ChunkedBitVector
 		}
 	}
 
+	// Delete n indices at once, the ranks are invalidated only once from the first touched chunk
+	void delete_indices(const IndexT *indices, std::size_t n)
+	{
+		std::size_t first_chunk = m_last_correct_chunk;
+		for (std::size_t i = 0; i < n; i++)
+		{
+			std::size_t chunk_index;
+			std::uint8_t bit_index;
+			locate_index(indices[i], chunk_index, bit_index);
+			if (chunk_index >= m_data.size())
+			{
+				continue;
+			}
+			ChunkT &chunk = m_data[chunk_index];
+			ChunkT mask = ChunkT{1} << bit_index;
+			if (chunk & mask)
+			{
+				chunk &= ~(mask);
+				m_chunk_ranks[chunk_index] = -1;
+				first_chunk = std::min(first_chunk, chunk_index);
+			}
+		}
+		m_last_correct_chunk = first_chunk;
+	}
+
 	bool has_index(const IndexT &index) const
 	{
 		std::size_t chunk_index;
@@ -312,21 +343,165 @@ class ChunkedBitVector
 		return m_cumulated_ranks[chunk_index] + current_chunk_index;
 	}
 
+	// Translate n indices at once, out[i] = get_index(in[i])
+	// The ranks are brought up to date once for the largest index, so the lookups do not need to
+	// check m_last_correct_chunk. For sorted input the current chunk is cached between lookups.
+	void get_indices(const IndexT *in, ResultT *out, std::size_t n)
+	{
+		if (n == 0)
+		{
+			return;
+		}
+		const std::size_t n_indices = m_data.size() * CHUNK_WIDTH;
+
+		bool sorted = true;
+		std::size_t max_index = 0;
+		for (std::size_t i = 0; i < n; i++)
+		{
+			// negative indices become huge and are treated as out of range
+			std::size_t index = static_cast<std::make_unsigned_t<IndexT>>(in[i]);
+			if (index < n_indices && index > max_index)
+			{
+				max_index = index;
+			}
+			if (i > 0 && in[i] < in[i - 1])
+			{
+				sorted = false;
+			}
+		}
+		std::size_t max_chunk = max_index >> LOG2_CHUNK_WIDTH;
+		if (max_chunk > m_last_correct_chunk)
+		{
+			update_to(max_chunk);
+		}
+
+		const ChunkT *data = m_data.data();
+		const ResultT *cumulated_ranks = m_cumulated_ranks.data();
+		if (sorted)
+		{
+			std::size_t current_chunk_index = std::numeric_limits<std::size_t>::max();
+			ChunkT chunk = 0;
+			ResultT base = 0;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				std::size_t index = static_cast<std::make_unsigned_t<IndexT>>(in[i]);
+				if (index >= n_indices)
+				{
+					out[i] = -1;
+					continue;
+				}
+				std::size_t chunk_index = index >> LOG2_CHUNK_WIDTH;
+				if (chunk_index != current_chunk_index)
+				{
+					current_chunk_index = chunk_index;
+					chunk = data[chunk_index];
+					base = cumulated_ranks[chunk_index];
+				}
+				std::uint8_t bit_index = index & (CHUNK_WIDTH - 1);
+				out[i] = select_rank(chunk, bit_index, base);
+			}
+		}
+		else
+		{
+			for (std::size_t i = 0; i < n; i++)
+			{
+				std::size_t index = static_cast<std::make_unsigned_t<IndexT>>(in[i]);
+				if (index >= n_indices)
+				{
+					out[i] = -1;
+					continue;
+				}
+				std::size_t chunk_index = index >> LOG2_CHUNK_WIDTH;
+				std::uint8_t bit_index = index & (CHUNK_WIDTH - 1);
+				out[i] = select_rank(data[chunk_index], bit_index, cumulated_ranks[chunk_index]);
+			}
+		}
+	}
+
 	void update_to(std::size_t chunk_index)
 	{
 		// m_cumulated_ranks[0, m_last_correct_chunk] and m_chunk_ranks[0, m_last_correct_chunk) are
 		// all correct
 		// we need to update m_cumulated_ranks[m_last_correct_chunk + 1, chunk_index]
 		// and m_chunk_ranks[m_last_correct_chunk, chunk_index)
-		for (int ichunk = m_last_correct_chunk; ichunk < chunk_index; ichunk++)
+		// The popcounts are recomputed unconditionally in a separate pass, this branchless loop is
+		// vectorized by the compiler and the prefix sum only reads the compact m_chunk_ranks
+		const ChunkT *data = m_data.data();
+		std::int8_t *chunk_ranks = m_chunk_ranks.data();
+		for (std::size_t ichunk = m_last_correct_chunk; ichunk < chunk_index; ichunk++)
+		{
+			chunk_ranks[ichunk] = std::popcount(data[ichunk]);
+		}
+		ResultT *cumulated_ranks = m_cumulated_ranks.data();
+		ResultT rank = cumulated_ranks[m_last_correct_chunk];
+		for (std::size_t ichunk = m_last_correct_chunk; ichunk < chunk_index; ichunk++)
+		{
+			rank += chunk_ranks[ichunk];
+			cumulated_ranks[ichunk + 1] = rank;
+		}
+		m_last_correct_chunk = chunk_index;
+	}
+
+	// Bring all ranks up to date, after that get_index/get_indices never walk the chunks
+	// This is useful after deleting many indices and before translating indices at random
+	void rebuild()
+	{
+		update_to(m_data.size() - 1);
+	}
+
+	// The same with a thread pool, the stale chunks are split into one contiguous range per thread.
+	// Every thread counts the bits of its range, the totals of the ranges are scanned serially and
+	// then every thread writes the cumulated ranks of its range starting from its offset.
+	void rebuild(ThreadPool &thread_pool)
+	{
+		const std::size_t begin = m_last_correct_chunk;
+		const std::size_t end = m_data.size() - 1;
+		const std::size_t n_ranges =
+		    std::min(thread_pool.size(), (end - begin) / MIN_PARALLEL_REBUILD_CHUNKS);
+		if (n_ranges <= 1)
 		{
-			if (m_chunk_ranks[ichunk] < 0)
+			update_to(end);
+			return;
+		}
+
+		auto range_start = [&](std::size_t t) { return begin + (end - begin) * t / n_ranges; };
+		const ChunkT *data = m_data.data();
+		std::int8_t *chunk_ranks = m_chunk_ranks.data();
+		ResultT *cumulated_ranks = m_cumulated_ranks.data();
+		// range_offsets[t] is the cumulated rank at the start of range t
+		std::vector<ResultT> range_offsets(n_ranges + 1);
+		thread_pool.run([&](std::size_t t) {
+			if (t >= n_ranges)
 			{
-				m_chunk_ranks[ichunk] = std::popcount(m_data[ichunk]);
+				return;
 			}
-			m_cumulated_ranks[ichunk + 1] = m_cumulated_ranks[ichunk] + m_chunk_ranks[ichunk];
+			ResultT rank = 0;
+			for (std::size_t ichunk = range_start(t); ichunk < range_start(t + 1); ichunk++)
+			{
+				std::int8_t chunk_rank = std::popcount(data[ichunk]);
+				chunk_ranks[ichunk] = chunk_rank;
+				rank += chunk_rank;
+			}
+			range_offsets[t + 1] = rank;
+		});
+		range_offsets[0] = cumulated_ranks[begin];
+		for (std::size_t t = 0; t < n_ranges; t++)
+		{
+			range_offsets[t + 1] += range_offsets[t];
 		}
-		m_last_correct_chunk = chunk_index;
+		thread_pool.run([&](std::size_t t) {
+			if (t >= n_ranges)
+			{
+				return;
+			}
+			ResultT rank = range_offsets[t];
+			for (std::size_t ichunk = range_start(t); ichunk < range_start(t + 1); ichunk++)
+			{
+				rank += chunk_ranks[ichunk];
+				cumulated_ranks[ichunk + 1] = rank;
+			}
+		});
+		m_last_correct_chunk = end;
 	}
 
 	void locate_index(IndexT index, std::size_t &chunk_index, std::uint8_t &bit_index) const
@@ -337,9 +512,9 @@ class ChunkedBitVector
 
 	void clear()
 	{
-		m_data.resize(1, 0);
-		m_cumulated_ranks.resize(1, m_start);
-		m_chunk_ranks.resize(1, -1);
+		m_data.assign(1, 0);
+		m_cumulated_ranks.assign(1, m_start);
+		m_chunk_ranks.assign(1, -1);
 		m_last_correct_chunk = 0;
 		m_next_bit = 0;
 	}
@@ -351,6 +526,20 @@ class ChunkedBitVector
 		LOG2_CHUNK_WIDTH = std::countr_zero(CHUNK_WIDTH)
 	};
 
+	// a smaller range is not worth waking up a thread for
+	static constexpr std::size_t MIN_PARALLEL_REBUILD_CHUNKS = 1024;
+
+	// base + the number of 1 on the right of bit_index, or -1 if bit_index is not set
+	static ResultT select_rank(ChunkT chunk, std::uint8_t bit_index, ResultT base)
+	{
+		ChunkT bit = ChunkT{1} << bit_index;
+		if (!(chunk & bit))
+		{
+			return -1;
+		}
+		return base + std::popcount(chunk & (bit - 1));
+	}
+
 	ResultT m_start;
 
 	std::vector<ChunkT> m_data;
@@ -26,8 +26,10 @@ extern "C"
 	B(COPT_WriteMst);              \
 	B(COPT_WriteParam);            \
 	B(COPT_AddCol);                \
+	B(COPT_AddCols);               \
 	B(COPT_DelCols);               \
 	B(COPT_AddRow);                \
+	B(COPT_AddRows);               \
 	B(COPT_AddQConstr);            \
 	B(COPT_AddSOSs);               \
 	B(COPT_AddCones);              \
@@ -167,15 +169,25 @@ class COPTModel
 	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous,
 	                           double lb = -COPT_INFINITY, double ub = COPT_INFINITY,
 	                           const char *name = nullptr);
+	VariableIndex add_variables(int N, const Vector<VariableDomain> &domains,
+	                            const Vector<double> &lbs, const Vector<double> &ubs,
+	                            const Vector<std::string> &names);
 	void delete_variable(const VariableIndex &variable);
 	void delete_variables(const Vector<VariableIndex> &variables);
 	bool is_variable_active(const VariableIndex &variable);
 	double get_variable_value(const VariableIndex &variable);
+	void get_variable_values(std::span<const IndexT> variables, std::span<double> values);
 	std::string pprint_variable(const VariableIndex &variable);
 
 	ConstraintIndex add_linear_constraint(const ScalarAffineFunction &function,
 	                                      ConstraintSense sense, CoeffT rhs,
 	                                      const char *name = nullptr);
+	ConstraintIndex add_linear_constraints(std::span<const IndexT> row_starts,
+	                                       std::span<const IndexT> variables,
+	                                       std::span<const CoeffT> coefficients,
+	                                       const Vector<ConstraintSense> &senses,
+	                                       std::span<const CoeffT> rhss,
+	                                       const Vector<std::string> &names);
 	ConstraintIndex add_quadratic_constraint(const ScalarQuadraticFunction &function,
 	                                         ConstraintSense sense, CoeffT rhs,
 	                                         const char *name = nullptr);
@@ -236,6 +248,7 @@ class COPTModel
 	void set_variable_upper_bound(const VariableIndex &variable, double ub);
 
 	double get_constraint_info(const ConstraintIndex &constraint, const char *info_name);
+	void get_constraint_duals(std::span<const IndexT> constraints, std::span<double> values);
 	std::string get_constraint_name(const ConstraintIndex &constraint);
 	void set_constraint_name(const ConstraintIndex &constraint, const char *name);
 
@@ -259,6 +272,8 @@ class COPTModel
 
 	int _variable_index(const VariableIndex &variable);
 	int _checked_variable_index(const VariableIndex &variable);
+	void _variable_indices(std::span<const IndexT> variables, std::span<int> columns);
+	void _checked_variable_indices(std::span<const IndexT> variables, std::span<int> columns);
 	int _constraint_index(const ConstraintIndex &constraint);
 	int _checked_constraint_index(const ConstraintIndex &constraint);
 
@@ -166,6 +166,72 @@ struct ExprBuilder
 	void set_affine_coef(const VariableIndex &i, CoeffT coeff);
 };
 
+// Accumulates terms by appending them to contiguous arrays instead of hashing them
+// Duplicated terms are merged lazily by a radix sort in finalize(), and the merged terms are
+// sorted by variable index, so it is suitable to sum up a huge number of terms
+struct FlatExprBuilder
+{
+	struct AffineTerm
+	{
+		IndexT variable;
+		CoeffT coefficient;
+	};
+	struct QuadraticTerm
+	{
+		VariablePair variables;
+		CoeffT coefficient;
+	};
+
+	Vector<QuadraticTerm> quadratic_terms;
+	Vector<AffineTerm> affine_terms;
+	std::optional<CoeffT> constant_term;
+	bool finalized = true;
+
+	FlatExprBuilder() = default;
+	FlatExprBuilder(CoeffT c);
+	FlatExprBuilder(const VariableIndex &v);
+	FlatExprBuilder(const ScalarAffineFunction &a);
+	FlatExprBuilder(const ScalarQuadraticFunction &q);
+	FlatExprBuilder(const ExprBuilder &t);
+
+	FlatExprBuilder &operator+=(CoeffT c);
+	FlatExprBuilder &operator+=(const VariableIndex &v);
+	FlatExprBuilder &operator+=(const ScalarAffineFunction &a);
+	FlatExprBuilder &operator+=(const ScalarQuadraticFunction &q);
+	FlatExprBuilder &operator+=(const ExprBuilder &t);
+	FlatExprBuilder &operator+=(const FlatExprBuilder &t);
+
+	FlatExprBuilder &operator-=(CoeffT c);
+	FlatExprBuilder &operator-=(const VariableIndex &v);
+	FlatExprBuilder &operator-=(const ScalarAffineFunction &a);
+	FlatExprBuilder &operator-=(const ScalarQuadraticFunction &q);
+	FlatExprBuilder &operator-=(const ExprBuilder &t);
+	FlatExprBuilder &operator-=(const FlatExprBuilder &t);
+
+	FlatExprBuilder &operator*=(CoeffT c);
+	FlatExprBuilder &operator/=(CoeffT c);
+
+	bool empty() const;
+	int degree() const;
+
+	void reserve_quadratic(size_t n);
+	void reserve_affine(size_t n);
+
+	void clear();
+	// sort the terms and merge the duplicated ones
+	void finalize();
+	void clean_nearzero_terms(CoeffT threshold = COEFTHRESHOLD);
+	void _add_quadratic_term(IndexT i, IndexT j, CoeffT coeff);
+	void add_quadratic_term(const VariableIndex &i, const VariableIndex &j, CoeffT coeff);
+	void _add_affine_term(IndexT i, CoeffT coeff);
+	void add_affine_term(const VariableIndex &i, CoeffT coeff);
+
+	// The conversions finalize the builder first
+	ScalarAffineFunction to_affine();
+	ScalarQuadraticFunction to_quadratic();
+	ExprBuilder to_expr_builder();
+};
+
 auto operator+(const VariableIndex &a, CoeffT b) -> ScalarAffineFunction;
 auto operator+(CoeffT a, const VariableIndex &b) -> ScalarAffineFunction;
 auto operator+(const VariableIndex &a, const VariableIndex &b) -> ScalarAffineFunction;
@@ -15,8 +15,10 @@
 	B(GRBgetenv);             \
 	B(GRBwrite);              \
 	B(GRBaddvar);             \
+	B(GRBaddvars);            \
 	B(GRBdelvars);            \
 	B(GRBaddconstr);          \
+	B(GRBaddconstrs);         \
 	B(GRBaddqconstr);         \
 	B(GRBaddsos);             \
 	B(GRBdelconstrs);         \
@@ -142,10 +144,14 @@ class GurobiModel
 	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous,
 	                           double lb = -GRB_INFINITY, double ub = GRB_INFINITY,
 	                           const char *name = nullptr);
+	VariableIndex add_variables(int N, const Vector<VariableDomain> &domains,
+	                            const Vector<double> &lbs, const Vector<double> &ubs,
+	                            const Vector<std::string> &names);
 	void delete_variable(const VariableIndex &variable);
 	void delete_variables(const Vector<VariableIndex> &variables);
 	bool is_variable_active(const VariableIndex &variable);
 	double get_variable_value(const VariableIndex &variable);
+	void get_variable_values(std::span<const IndexT> variables, std::span<double> values);
 	std::string pprint_variable(const VariableIndex &variable);
 
 	void set_variable_name(const VariableIndex &variable, const char *name);
@@ -154,6 +160,12 @@ class GurobiModel
 	ConstraintIndex add_linear_constraint(const ScalarAffineFunction &function,
 	                                      ConstraintSense sense, CoeffT rhs,
 	                                      const char *name = nullptr);
+	ConstraintIndex add_linear_constraints(std::span<const IndexT> row_starts,
+	                                       std::span<const IndexT> variables,
+	                                       std::span<const CoeffT> coefficients,
+	                                       const Vector<ConstraintSense> &senses,
+	                                       std::span<const CoeffT> rhss,
+	                                       const Vector<std::string> &names);
 	ConstraintIndex add_quadratic_constraint(const ScalarQuadraticFunction &function,
 	                                         ConstraintSense sense, CoeffT rhs,
 	                                         const char *name = nullptr);
@@ -217,6 +229,8 @@ class GurobiModel
 
 	int _variable_index(const VariableIndex &variable);
 	int _checked_variable_index(const VariableIndex &variable);
+	void _variable_indices(std::span<const IndexT> variables, std::span<int> columns);
+	void _checked_variable_indices(std::span<const IndexT> variables, std::span<int> columns);
 
 	// constraint attribute
 	void set_constraint_raw_attribute_int(const ConstraintIndex &constraint, const char *attr_name,
@@ -234,6 +248,7 @@ class GurobiModel
 	                                           const char *attr_name);
 	std::string get_constraint_raw_attribute_string(const ConstraintIndex &constraint,
 	                                                const char *attr_name);
+	void get_constraint_duals(std::span<const IndexT> constraints, std::span<double> values);
 
 	int _constraint_index(const ConstraintIndex &constraint);
 	int _checked_constraint_index(const ConstraintIndex &constraint);
@@ -9,55 +9,58 @@
 #include "pyoptinterface/container.hpp"
 #include "pyoptinterface/solver_common.hpp"
 
-#define APILIST                     \
-	B(Highs_create);                \
-	B(Highs_destroy);               \
-	B(Highs_writeModel);            \
-	B(Highs_addCol);                \
-	B(Highs_getNumCol);             \
-	B(Highs_changeColIntegrality);  \
-	B(Highs_deleteColsBySet);       \
-	B(Highs_addRow);                \
-	B(Highs_getNumRow);             \
-	B(Highs_deleteRowsBySet);       \
-	B(Highs_passHessian);           \
-	B(Highs_changeColsCostByRange); \
-	B(Highs_changeObjectiveOffset); \
-	B(Highs_changeObjectiveSense);  \
-	B(Highs_run);                   \
-	B(Highs_getNumCols);            \
-	B(Highs_getNumRows);            \
-	B(Highs_getModelStatus);        \
-	B(Highs_getDualRay);            \
-	B(Highs_getPrimalRay);          \
-	B(Highs_getIntInfoValue);       \
-	B(Highs_getSolution);           \
-	B(Highs_getHessianNumNz);       \
-	B(Highs_getBasis);              \
-	B(Highs_version);               \
-	B(Highs_getRunTime);            \
-	B(Highs_getOptionType);         \
-	B(Highs_setBoolOptionValue);    \
-	B(Highs_setIntOptionValue);     \
-	B(Highs_setDoubleOptionValue);  \
-	B(Highs_setStringOptionValue);  \
-	B(Highs_getBoolOptionValue);    \
-	B(Highs_getIntOptionValue);     \
-	B(Highs_getDoubleOptionValue);  \
-	B(Highs_getStringOptionValue);  \
-	B(Highs_getInfoType);           \
-	B(Highs_getInt64InfoValue);     \
-	B(Highs_getDoubleInfoValue);    \
-	B(Highs_getColIntegrality);     \
-	B(Highs_changeColsBoundsBySet); \
-	B(Highs_getColsBySet);          \
-	B(Highs_getObjectiveSense);     \
-	B(Highs_getObjectiveValue);     \
-	B(Highs_getColsByRange);        \
-	B(Highs_setSolution);           \
-	B(Highs_getRowsBySet);          \
-	B(Highs_changeRowsBoundsBySet); \
-	B(Highs_changeCoeff);           \
+#define APILIST                            \
+	B(Highs_create);                       \
+	B(Highs_destroy);                      \
+	B(Highs_writeModel);                   \
+	B(Highs_addCol);                       \
+	B(Highs_getNumCol);                    \
+	B(Highs_changeColIntegrality);         \
+	B(Highs_addCols);                      \
+	B(Highs_changeColsIntegralityByRange); \
+	B(Highs_deleteColsBySet);              \
+	B(Highs_addRow);                       \
+	B(Highs_addRows);                      \
+	B(Highs_getNumRow);                    \
+	B(Highs_deleteRowsBySet);              \
+	B(Highs_passHessian);                  \
+	B(Highs_changeColsCostByRange);        \
+	B(Highs_changeObjectiveOffset);        \
+	B(Highs_changeObjectiveSense);         \
+	B(Highs_run);                          \
+	B(Highs_getNumCols);                   \
+	B(Highs_getNumRows);                   \
+	B(Highs_getModelStatus);               \
+	B(Highs_getDualRay);                   \
+	B(Highs_getPrimalRay);                 \
+	B(Highs_getIntInfoValue);              \
+	B(Highs_getSolution);                  \
+	B(Highs_getHessianNumNz);              \
+	B(Highs_getBasis);                     \
+	B(Highs_version);                      \
+	B(Highs_getRunTime);                   \
+	B(Highs_getOptionType);                \
+	B(Highs_setBoolOptionValue);           \
+	B(Highs_setIntOptionValue);            \
+	B(Highs_setDoubleOptionValue);         \
+	B(Highs_setStringOptionValue);         \
+	B(Highs_getBoolOptionValue);           \
+	B(Highs_getIntOptionValue);            \
+	B(Highs_getDoubleOptionValue);         \
+	B(Highs_getStringOptionValue);         \
+	B(Highs_getInfoType);                  \
+	B(Highs_getInt64InfoValue);            \
+	B(Highs_getDoubleInfoValue);           \
+	B(Highs_getColIntegrality);            \
+	B(Highs_changeColsBoundsBySet);        \
+	B(Highs_getColsBySet);                 \
+	B(Highs_getObjectiveSense);            \
+	B(Highs_getObjectiveValue);            \
+	B(Highs_getColsByRange);               \
+	B(Highs_setSolution);                  \
+	B(Highs_getRowsBySet);                 \
+	B(Highs_changeRowsBoundsBySet);        \
+	B(Highs_changeCoeff);                  \
 	B(Highs_changeColCost);
 
 namespace highs
@@ -117,15 +120,25 @@ class POIHighsModel
 	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous,
 	                           double lb = -kHighsInf, double ub = kHighsInf,
 	                           const char *name = nullptr);
+	VariableIndex add_variables(int N, const Vector<VariableDomain> &domains,
+	                            const Vector<double> &lbs, const Vector<double> &ubs,
+	                            const Vector<std::string> &names);
 	void delete_variable(const VariableIndex &variable);
 	void delete_variables(const Vector<VariableIndex> &variables);
 	bool is_variable_active(const VariableIndex &variable);
 	double get_variable_value(const VariableIndex &variable);
+	void get_variable_values(std::span<const IndexT> variables, std::span<double> values);
 	std::string pprint_variable(const VariableIndex &variable);
 
 	ConstraintIndex add_linear_constraint(const ScalarAffineFunction &function,
 	                                      ConstraintSense sense, CoeffT rhs,
 	                                      const char *name = nullptr);
+	ConstraintIndex add_linear_constraints(std::span<const IndexT> row_starts,
+	                                       std::span<const IndexT> variables,
+	                                       std::span<const CoeffT> coefficients,
+	                                       const Vector<ConstraintSense> &senses,
+	                                       std::span<const CoeffT> rhss,
+	                                       const Vector<std::string> &names);
 	ConstraintIndex add_quadratic_constraint(const ScalarQuadraticFunction &function,
 	                                         ConstraintSense sense, CoeffT rhs,
 	                                         const char *name = nullptr);
@@ -178,6 +191,7 @@ class POIHighsModel
 	void set_constraint_name(const ConstraintIndex &constraint, const char *name);
 	double get_constraint_primal(const ConstraintIndex &constraint);
 	double get_constraint_dual(const ConstraintIndex &constraint);
+	void get_constraint_duals(std::span<const IndexT> constraints, std::span<double> values);
 
 	ObjectiveSense get_obj_sense();
 	void set_obj_sense(ObjectiveSense sense);
@@ -185,6 +199,8 @@ class POIHighsModel
 
 	HighsInt _variable_index(const VariableIndex &variable);
 	HighsInt _checked_variable_index(const VariableIndex &variable);
+	void _variable_indices(std::span<const IndexT> variables, std::span<HighsInt> columns);
+	void _checked_variable_indices(std::span<const IndexT> variables, std::span<HighsInt> columns);
 	HighsInt _constraint_index(const ConstraintIndex &constraint);
 	HighsInt _checked_constraint_index(const ConstraintIndex &constraint);
 
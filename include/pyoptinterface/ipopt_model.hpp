@@ -1,5 +1,7 @@
 #pragma once
 
+#include <tuple>
+
 #include "solvers/ipopt/IpStdCInterface.h"
 #include "pyoptinterface/nlcore.hpp"
 
@@ -37,6 +39,49 @@ struct IpoptfreeproblemT
 	};
 };
 
+// The evaluations at the current iterate of IPOPT
+// IPOPT passes new_x = false if x is the same as in the previous call of any evaluation function.
+// Its TNLPAdapter already avoids most repeated calls at the same x, so the gradient, the
+// constraints and their jacobian are only copied into the cache after the same value has been
+// requested twice at one x. Until then a miss costs no extra O(nnz) copy.
+struct IpoptEvaluationCache
+{
+	bool has_obj = false, has_grad = false, has_g = false, has_jacobian = false;
+	// computed at the current x, but not necessarily stored
+	bool computed_grad = false, computed_g = false, computed_jacobian = false;
+	// set by the first repeated request, values are stored from then on
+	bool store_values = false;
+	double obj = 0.0;
+	std::vector<double> grad, g, jacobian;
+
+	// the number of evaluations answered from the cache and computed
+	size_t hits = 0, misses = 0;
+
+	// called on a miss, returns whether the computed value should be stored
+	bool store_after_miss(bool &computed)
+	{
+		if (computed)
+		{
+			store_values = true;
+		}
+		computed = true;
+		return store_values;
+	}
+
+	void new_x()
+	{
+		has_obj = has_grad = has_g = has_jacobian = false;
+		computed_grad = computed_g = computed_jacobian = false;
+	}
+
+	void reset()
+	{
+		new_x();
+		store_values = false;
+		hits = misses = 0;
+	}
+};
+
 struct IpoptResult
 {
 	// store results
@@ -123,6 +168,12 @@ struct IpoptModel
 	FunctionIndex register_function(ADFunD &f, const std::string &name,
 	                                const std::vector<double> &x_values,
 	                                const std::vector<double> &p_values);
+	FunctionIndex register_function_from_analysis(ADFunD &f, const std::string &name,
+	                                              const std::string &analysis);
+	FunctionIndex register_function_deferred(ADFunD &f, const std::string &name,
+	                                         const std::vector<double> &x_values,
+	                                         const std::vector<double> &p_values);
+	void initialize_deferred_functions();
 
 	NLConstraintIndex add_empty_nl_constraint(int dim, ConstraintSense sense,
 	                                          const std::vector<double> &rhss);
@@ -173,13 +224,58 @@ struct IpoptModel
 
 	void clear_nl_objective();
 
+	// analyzes the sparsity of the jacobian and the hessian
+	void analyze_structure();
+	// initializes the deferred functions and analyzes the structure if it has changed, returns
+	// whether it has been analyzed again
+	bool prepare_structure();
 	void optimize();
 
+	// Evaluate the model at x through the callbacks given to IPOPT, without solving
+	// new_x = false tells that x is the same as in the previous evaluation, as IPOPT does.
+	// The values of the jacobian and the hessian follow get_jacobian_structure and
+	// get_hessian_structure, the hessian is the lower triangle of
+	// obj_factor * the hessian of the objective + sum lambda_i * the hessian of constraint i.
+	double eval_objective(const std::vector<double> &x, bool new_x = true);
+	std::vector<double> eval_objective_gradient(const std::vector<double> &x, bool new_x = true);
+	std::vector<double> eval_constraints(const std::vector<double> &x, bool new_x = true);
+	std::vector<double> eval_constraint_jacobian(const std::vector<double> &x, bool new_x = true);
+	std::vector<double> eval_lagrangian_hessian(const std::vector<double> &x, double obj_factor,
+	                                            const std::vector<double> &lambda,
+	                                            bool new_x = true);
+	// rows, cols
+	std::tuple<std::vector<size_t>, std::vector<size_t>> get_jacobian_structure();
+	std::tuple<std::vector<size_t>, std::vector<size_t>> get_hessian_structure();
+
 	// set options
 	void set_raw_option_int(const std::string &name, int value);
 	void set_raw_option_double(const std::string &name, double value);
 	void set_raw_option_string(const std::string &name, const std::string &value);
 
+	// the number of threads to evaluate the nonlinear functions
+	int get_n_threads() const;
+	void set_n_threads(int n_threads);
+	// the nonlinear terms of objective are summed with compensated summation if enabled
+	void set_compensated_objective_sum(bool enable);
+	bool get_compensated_objective_sum() const;
+
+	// If warm start is enabled, optimize starts from the primal and dual solution of the previous
+	// successful solve or the point given by set_warm_start_point, and warm_start_init_point is set
+	// to yes. Setting warm_start_init_point as a raw option overrides this switch.
+	// Variables and constraints added since start from their start values and zero multipliers.
+	void set_warm_start(bool enable);
+	bool get_warm_start() const;
+	// x, mult_g, mult_x_L, mult_x_U
+	std::tuple<std::vector<double>, std::vector<double>, std::vector<double>, std::vector<double>>
+	get_warm_start_point() const;
+	void set_warm_start_point(const std::vector<double> &x, const std::vector<double> &mult_g,
+	                          const std::vector<double> &mult_x_L,
+	                          const std::vector<double> &mult_x_U);
+
+	// statistics of the evaluation cache in the last optimize
+	size_t get_eval_cache_hits() const;
+	size_t get_eval_cache_misses() const;
+
 	/* Members */
 
 	size_t n_variables = 0;
@@ -195,17 +291,29 @@ struct IpoptModel
 
 	size_t m_hessian_nnz = 0;
 	std::vector<size_t> m_hessian_rows, m_hessian_cols;
-	Hashmap<VariablePair, size_t> m_hessian_index_map;
 
 	NonlinearFunctionModel m_function_model;
 	LinearQuadraticModel m_lq_model;
 
+	IpoptEvaluationCache m_eval_cache;
+
+	// The structure analyzed by the last optimize, it is reused while no variable, constraint,
+	// objective or nonlinear function is added or changed
+	bool m_structure_analyzed = false;
+	size_t m_analyzed_nl_version = 0, m_analyzed_lq_version = 0;
+	size_t m_analyzed_n_variables = 0, m_analyzed_n_constraints = 0;
+	// m_problem keeps its own copy of the bounds, it is created again after they are changed
+	bool m_bounds_changed = true;
+
 	// The options of the Ipopt solver, we cache them before constructing the m_problem
 	Hashmap<std::string, int> m_options_int;
 	Hashmap<std::string, double> m_options_num;
 	Hashmap<std::string, std::string> m_options_str;
 
 	IpoptResult m_result;
+	bool m_warm_start = false;
+	// m_result holds a solution or a point set by the user
+	bool m_has_warm_start_point = false;
 	enum ApplicationReturnStatus m_status;
 
 	std::unique_ptr<IpoptProblemInfo, IpoptfreeproblemT> m_problem = nullptr;
@@ -22,12 +22,16 @@
 	B(MSK_getnumvar);                  \
 	B(MSK_putvartype);                 \
 	B(MSK_putvarbound);                \
+	B(MSK_putvartypelist);             \
+	B(MSK_putvarboundslice);           \
 	B(MSK_putvarname);                 \
 	B(MSK_removevars);                 \
 	B(MSK_getxxslice);                 \
 	B(MSK_appendcons);                 \
 	B(MSK_getnumcon);                  \
 	B(MSK_putarow);                    \
+	B(MSK_putarowslice);               \
+	B(MSK_putconboundslice);           \
 	B(MSK_putconbound);                \
 	B(MSK_putconname);                 \
 	B(MSK_putqconk);                   \
@@ -131,17 +135,25 @@ class MOSEKModel
 	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous,
 	                           double lb = -MSK_INFINITY, double ub = MSK_INFINITY,
 	                           const char *name = nullptr);
-	/*VariableIndex add_variables(int N, VariableDomain domain = VariableDomain::Continuous,
-	                            double lb = -MSK_INFINITY, double ub = MSK_INFINITY);*/
+	VariableIndex add_variables(int N, const Vector<VariableDomain> &domains,
+	                            const Vector<double> &lbs, const Vector<double> &ubs,
+	                            const Vector<std::string> &names);
 	void delete_variable(const VariableIndex &variable);
 	void delete_variables(const Vector<VariableIndex> &variables);
 	bool is_variable_active(const VariableIndex &variable);
 	double get_variable_value(const VariableIndex &variable);
+	void get_variable_values(std::span<const IndexT> variables, std::span<double> values);
 	std::string pprint_variable(const VariableIndex &variable);
 
 	ConstraintIndex add_linear_constraint(const ScalarAffineFunction &function,
 	                                      ConstraintSense sense, CoeffT rhs,
 	                                      const char *name = nullptr);
+	ConstraintIndex add_linear_constraints(std::span<const IndexT> row_starts,
+	                                       std::span<const IndexT> variables,
+	                                       std::span<const CoeffT> coefficients,
+	                                       const Vector<ConstraintSense> &senses,
+	                                       std::span<const CoeffT> rhss,
+	                                       const Vector<std::string> &names);
 	ConstraintIndex add_quadratic_constraint(const ScalarQuadraticFunction &function,
 	                                         ConstraintSense sense, CoeffT rhs,
 	                                         const char *name = nullptr);
@@ -210,6 +222,7 @@ class MOSEKModel
 
 	double get_constraint_primal(const ConstraintIndex &constraint);
 	double get_constraint_dual(const ConstraintIndex &constraint);
+	void get_constraint_duals(std::span<const IndexT> constraints, std::span<double> values);
 	std::string get_constraint_name(const ConstraintIndex &constraint);
 	void set_constraint_name(const ConstraintIndex &constraint, const char *name);
 
@@ -231,6 +244,8 @@ class MOSEKModel
 
 	MSKint32t _variable_index(const VariableIndex &variable);
 	MSKint32t _checked_variable_index(const VariableIndex &variable);
+	void _variable_indices(std::span<const IndexT> variables, std::span<MSKint32t> columns);
+	void _checked_variable_indices(std::span<const IndexT> variables, std::span<MSKint32t> columns);
 	MSKint32t _constraint_index(const ConstraintIndex &constraint);
 	MSKint32t _checked_constraint_index(const ConstraintIndex &constraint);
 
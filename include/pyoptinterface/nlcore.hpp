@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include "cppad/cppad.hpp"
 #include "core.hpp"
+#include "thread_pool.hpp"
 
 struct NLConstraintIndex
 {
@@ -140,19 +143,18 @@ JacobianHessianSparsityPattern jacobian_hessian_sparsity(CppAD::ADFun<Base> &f,
 	return jachess;
 }
 
-// [p, x] -> jacobian
+// [p, x] -> [f, jacobian] if with_function is true, otherwise [p, x] -> jacobian
 template <typename Base>
-CppAD::ADFun<Base> sparse_jacobian(const CppAD::ADFun<Base> &f,
-                                   const sparsity_pattern_t &pattern_jac,
-                                   const std::vector<double> &x_values,
-                                   const std::vector<double> &p_values)
+CppAD::ADFun<Base> record_sparse_jacobian(const CppAD::ADFun<Base> &f,
+                                          const sparsity_pattern_t &pattern_jac,
+                                          const std::vector<double> &x_values,
+                                          const std::vector<double> &p_values, bool with_function)
 {
 	using CppAD::AD;
 	using CppAD::ADFun;
 	using CppAD::Independent;
 
 	size_t nx = f.Domain();
-	size_t ny = f.Range();
 	size_t np = f.size_dyn_ind();
 	std::vector<AD<Base>> apx(np + nx), ax(nx), ap(np);
 	for (size_t i = 0; i < np; i++)
@@ -174,19 +176,46 @@ CppAD::ADFun<Base> sparse_jacobian(const CppAD::ADFun<Base> &f,
 		ax[i] = apx[np + i];
 	}
 	af.new_dynamic(ap);
+	std::vector<AD<Base>> ay;
+	if (with_function)
+	{
+		ay = af.Forward(0, ax);
+	}
 	CppAD::sparse_rcv<std::vector<size_t>, std::vector<AD<Base>>> subset(pattern_jac);
 	CppAD::sparse_jac_work work;
 	std::string coloring = "cppad";
-	size_t n_color = af.sparse_jac_rev(ax, subset, pattern_jac, coloring, work);
+	af.sparse_jac_rev(ax, subset, pattern_jac, coloring, work);
+	const auto &aj = subset.val();
+	ay.insert(ay.end(), aj.begin(), aj.end());
 	ADFun<double> jacobian;
-	jacobian.Dependent(apx, subset.val());
+	jacobian.Dependent(apx, ay);
 
-	const std::string opt_options = "no_compare_op no_conditional_skip no_cumulative_sum_op";
 	jacobian.optimize(opt_options);
 
 	return jacobian;
 }
 
+// [p, x] -> jacobian
+template <typename Base>
+CppAD::ADFun<Base> sparse_jacobian(const CppAD::ADFun<Base> &f,
+                                   const sparsity_pattern_t &pattern_jac,
+                                   const std::vector<double> &x_values,
+                                   const std::vector<double> &p_values)
+{
+	return record_sparse_jacobian(f, pattern_jac, x_values, p_values, false);
+}
+
+// [p, x] -> [f, jacobian]
+// f and its jacobian are recorded on the same tape, so optimize shares the forward sweep
+template <typename Base>
+CppAD::ADFun<Base> sparse_function_jacobian(const CppAD::ADFun<Base> &f,
+                                            const sparsity_pattern_t &pattern_jac,
+                                            const std::vector<double> &x_values,
+                                            const std::vector<double> &p_values)
+{
+	return record_sparse_jacobian(f, pattern_jac, x_values, p_values, true);
+}
+
 // [p, w, x] -> \Sigma w_i * Hessian_i
 template <typename Base>
 CppAD::ADFun<Base> sparse_hessian(const CppAD::ADFun<Base> &f,
@@ -265,6 +294,38 @@ using additive_grad_funcptr_noparam = void (*)(const double *x, double *grad, co
 using hessian_funcptr_noparam = void (*)(const double *x, const double *w, double *hessian,
                                          const size_t *xi, const size_t *hessiani);
 
+// batched version, evaluate n instances in one call
+// the indices of instance i are xi[i * nx:], pi[i * np:], gradi[i * ny:] and hessiani[i * ny:]
+// its output starts from y + yo[i] and its weights start from w + wo[i]
+using f_batch_funcptr = void (*)(size_t n, const double *x, const double *p, double *y,
+                                 const size_t *xi, const size_t *pi, const size_t *yo);
+using jacobian_batch_funcptr = void (*)(size_t n, const double *x, const double *p,
+                                        double *jacobian, const size_t *xi, const size_t *pi,
+                                        const size_t *yo);
+using additive_grad_batch_funcptr = void (*)(size_t n, const double *x, const double *p,
+                                             double *grad, const size_t *xi, const size_t *pi,
+                                             const size_t *gradi);
+using hessian_batch_funcptr = void (*)(size_t n, const double *x, const double *p, const double *w,
+                                       double *hessian, const size_t *xi, const size_t *pi,
+                                       const size_t *wo, const size_t *hessiani);
+
+using f_batch_funcptr_noparam = void (*)(size_t n, const double *x, double *y, const size_t *xi,
+                                         const size_t *yo);
+using jacobian_batch_funcptr_noparam = void (*)(size_t n, const double *x, double *jacobian,
+                                                const size_t *xi, const size_t *yo);
+using additive_grad_batch_funcptr_noparam = void (*)(size_t n, const double *x, double *grad,
+                                                     const size_t *xi, const size_t *gradi);
+using hessian_batch_funcptr_noparam = void (*)(size_t n, const double *x, const double *w,
+                                               double *hessian, const size_t *xi,
+                                               const size_t *wo, const size_t *hessiani);
+
+// reduction over instances of a function with ny = 1, returns the sum of the outputs of n
+// instances, the sum is compensated if compensated != 0
+using f_sum_funcptr = double (*)(size_t n, const double *x, const double *p, const size_t *xi,
+                                 const size_t *pi, int compensated);
+using f_sum_funcptr_noparam = double (*)(size_t n, const double *x, const size_t *xi,
+                                         int compensated);
+
 struct NonlinearFunction
 {
 	std::string name;
@@ -279,6 +340,9 @@ struct NonlinearFunction
 	bool has_jacobian = false;
 	bool has_hessian = false;
 	cpp_graph f_graph, jacobian_graph, hessian_graph;
+	// [f, jacobian] in one graph, it exists if has_jacobian
+	bool has_fused = false;
+	cpp_graph fused_graph;
 
 	union {
 		f_funcptr p = nullptr;
@@ -297,25 +361,72 @@ struct NonlinearFunction
 		hessian_funcptr_noparam nop;
 	} hessian_eval;
 
+	// optional, the instances are evaluated one by one if they are not assigned
+	union {
+		f_batch_funcptr p = nullptr;
+		f_batch_funcptr_noparam nop;
+	} f_batch_eval;
+	union {
+		jacobian_batch_funcptr p = nullptr;
+		jacobian_batch_funcptr_noparam nop;
+	} jacobian_batch_eval;
+	union {
+		additive_grad_batch_funcptr p = nullptr;
+		additive_grad_batch_funcptr_noparam nop;
+	} grad_batch_eval;
+	union {
+		hessian_batch_funcptr p = nullptr;
+		hessian_batch_funcptr_noparam nop;
+	} hessian_batch_eval;
+
+	// optional, the objective instances are evaluated one by one if it is not assigned
+	union {
+		f_sum_funcptr p = nullptr;
+		f_sum_funcptr_noparam nop;
+	} f_sum_eval;
+
+	// optional, f and jacobian are evaluated separately if they are not assigned
+	// the outputs have ny + m_jacobian_nnz elements, they have the signature of jacobian
+	union {
+		jacobian_funcptr p = nullptr;
+		jacobian_funcptr_noparam nop;
+	} fused_eval;
+	union {
+		jacobian_batch_funcptr p = nullptr;
+		jacobian_batch_funcptr_noparam nop;
+	} fused_batch_eval;
+
 	void init(ADFunD &f_, const std::string &name_, const std::vector<double> &x_values,
 	          const std::vector<double> &p_values);
 
+	// The sparsity patterns and derivative graphs computed by init as bytes
+	std::string save_analysis() const;
+	// Same as init, but the sparsity patterns and derivative graphs are read from save_analysis
+	// instead of being computed by CppAD
+	void init_from_analysis(ADFunD &f_, const std::string &name_, const std::string &data);
+
 	void assign_evaluators(uintptr_t fp, uintptr_t jp, uintptr_t ajp, uintptr_t hp);
-};
+	void assign_batch_evaluators(uintptr_t fp, uintptr_t jp, uintptr_t ajp, uintptr_t hp);
+	void assign_fused_evaluators(uintptr_t fp, uintptr_t fbp);
+	void assign_sum_evaluator(uintptr_t sp);
 
-struct FunctionInstance
-{
-	std::vector<size_t> xs, ps;
-	// The output in all outputs
-	size_t y_start;
-	// defaults to y_start, some optimizers only need the nonlinear parts
-	size_t eval_y_start;
-	size_t jacobian_start;
-	std::vector<size_t> hessian_indices;
-	std::vector<size_t> grad_indices;
+	bool has_fused_evaluator() const
+	{
+		return has_fused && fused_eval.p != nullptr;
+	}
+	bool has_sum_evaluator() const
+	{
+		return f_sum_eval.p != nullptr;
+	}
+	size_t fused_size() const
+	{
+		return ny + m_jacobian_nnz;
+	}
 };
 
-using FunctionInstances = std::vector<FunctionInstance>;
+// A binary form of cpp_graph, two graphs with the same operations serialize to the same bytes
+std::string serialize_cpp_graph(const cpp_graph &graph);
+void deserialize_cpp_graph(const std::string &data, cpp_graph &graph);
 
 struct ParameterIndex
 {
@@ -337,6 +448,47 @@ struct FunctionIndex
 	}
 };
 
+// All instances of a nonlinear function
+// The indices of instance i are stored in row i of the flat row-major matrices xs (nx columns),
+// ps (np columns), grad_indices (jacobian nnz columns) and hessian_indices (hessian nnz columns)
+struct FunctionInstances
+{
+	size_t nx = 0, np = 0;
+	std::vector<size_t> xs, ps;
+	// The output in all outputs, 0 for objective
+	std::vector<size_t> y_starts;
+	// defaults to y_start, some optimizers only need the nonlinear parts
+	std::vector<size_t> eval_y_starts;
+	std::vector<size_t> jacobian_starts;
+	std::vector<size_t> hessian_indices;
+	std::vector<size_t> grad_indices;
+	// the outputs of fused evaluation start from fused_starts[i] in the buffer of fused values
+	std::vector<size_t> fused_starts;
+
+	FunctionInstances() = default;
+	FunctionInstances(size_t nx_, size_t np_) : nx(nx_), np(np_)
+	{
+	}
+
+	size_t size() const
+	{
+		return y_starts.size();
+	}
+
+	const size_t *x_indices(size_t i) const
+	{
+		return xs.data() + i * nx;
+	}
+	const size_t *p_indices(size_t i) const
+	{
+		return ps.data() + i * np;
+	}
+
+	void add_instance(const std::vector<VariableIndex> &x, const std::vector<ParameterIndex> &p,
+	                  size_t y);
+	void clear();
+};
+
 struct ConstantDelta
 {
 	double c;
@@ -360,36 +512,93 @@ struct AffineDelta
 
 size_t add_gradient_column(size_t column, size_t &gradient_nnz, std::vector<size_t> &gradient_cols,
                            Hashmap<size_t, size_t> &grad_index_map);
-size_t add_hessian_index(size_t x1, size_t x2, size_t &m_hessian_nnz,
-                         std::vector<size_t> &m_hessian_rows, std::vector<size_t> &m_hessian_cols,
-                         Hashmap<VariablePair, size_t> &m_hessian_index_map,
-                         HessianSparsityType hessian_sparsity_type);
+
+// Builds the sparsity pattern of the hessian from the entries of all parts of a model
+//
+// add() appends an entry and returns its id, ids are consecutive from 0. build() sorts the
+// entries by (row, column) with a parallel radix sort and merges duplicates, afterwards
+// entry_index[id] is the index of the nonzero that entry id contributes to. The nonzeros are
+// ordered by row and then by column until permute() moves them.
+struct HessianStructureBuilder
+{
+	HessianSparsityType hessian_sparsity_type;
+	// (row << 32) | column of every entry
+	std::vector<std::uint64_t> keys;
+	std::vector<size_t> entry_index;
+	size_t nnz = 0;
+
+	HessianStructureBuilder(HessianSparsityType type) : hessian_sparsity_type(type)
+	{
+	}
+
+	size_t add(size_t x1, size_t x2);
+	void build(ThreadPool *thread_pool, size_t &m_hessian_nnz, std::vector<size_t> &m_hessian_rows,
+	           std::vector<size_t> &m_hessian_cols);
+	// moves nonzero order[i] to index i, entry_index and the pattern are updated
+	void permute(const std::vector<size_t> &order, std::vector<size_t> &m_hessian_rows,
+	             std::vector<size_t> &m_hessian_cols);
+};
 
 struct LinearQuadraticModel
 {
-	std::vector<ScalarAffineFunction> linear_constraints;
+	// The constraints are stored as rows of flat arrays in CSR format, row i has the terms
+	// [starts[i], starts[i + 1]) and is the constraint with index constraint_indices[i]
+	// linear constraint i =
+	//   sum(linear_coefficients[j] * x[linear_variables[j]]) + linear_constants[i]
+	std::vector<size_t> linear_row_starts = {0};
+	std::vector<IndexT> linear_variables;
+	std::vector<double> linear_coefficients;
+	std::vector<double> linear_constants;
 	std::vector<size_t> linear_constraint_indices;
 
-	std::vector<ScalarQuadraticFunction> quadratic_constraints;
+	// quadratic constraint i = sum(quadratic_coefficients[j] * x[quadratic_variable_1s[j]] *
+	// x[quadratic_variable_2s[j]]) + its affine row + quadratic_constants[i]
+	std::vector<size_t> quadratic_starts = {0};
+	std::vector<IndexT> quadratic_variable_1s, quadratic_variable_2s;
+	std::vector<double> quadratic_coefficients;
+	std::vector<size_t> quadratic_affine_starts = {0};
+	std::vector<IndexT> quadratic_affine_variables;
+	std::vector<double> quadratic_affine_coefficients;
+	std::vector<double> quadratic_constants;
 	std::vector<size_t> quadratic_constraint_indices;
 
+	// The constant nonzeros of the jacobian are contiguous from constant_jacobian_start, they are
+	// linear_coefficients followed by quadratic_affine_coefficients and are copied from them
+	size_t constant_jacobian_start = 0;
+
 	ExprBuilder lq_objective;
 	std::vector<size_t> lq_objective_hessian_indices;
 
-	// jacobian[yi] += c
-	std::vector<ConstantDelta> jacobian_constants;
-	// jacobian[yi] += c * x[xi]
+	// jacobian[yi] = c * x[xi], the nonzeros follow the constant ones and are not shared
 	std::vector<AffineDelta> jacobian_linear_terms;
 
-	// grad[yi] += c
-	std::vector<ConstantDelta> gradient_constants;
-	// grad[yi] += c * x[xi]
-	std::vector<AffineDelta> gradient_linear_terms;
+	// lq_objective frozen by analyze_dense_gradient_structure, the terms are sorted by variables
+	// objective = sum(objective_diagonal_coefficients[i] * x[objective_diagonal_variables[i]]^2) +
+	//   sum(objective_quadratic_coefficients[i] * x[objective_variable_1s[i]] *
+	//   x[objective_variable_2s[i]]) + its affine terms + objective_constant
+	std::vector<IndexT> objective_diagonal_variables;
+	std::vector<double> objective_diagonal_coefficients;
+	std::vector<IndexT> objective_variable_1s, objective_variable_2s;
+	std::vector<double> objective_quadratic_coefficients;
+	std::vector<IndexT> objective_affine_variables;
+	std::vector<double> objective_affine_coefficients;
+	double objective_constant = 0.0;
 
 	// hessian[yi] += lambda[xi] * c
 	std::vector<AffineDelta> constraint_hessian_linear_terms;
-	// hessian[yi] += sigma * c
+	// hessian[yi] += sigma * c, the nonzeros shared with nonlinear functions or constraints
 	std::vector<ConstantDelta> objective_hessian_linear_terms;
+	// nonzeros only touched by the quadratic objective,
+	// hessian[objective_hessian_start + i] = sigma * objective_hessian_values[i]
+	size_t objective_hessian_start = 0;
+	std::vector<double> objective_hessian_values;
+	// nonzeros only touched by the quadratic constraints and objective, they are set to zero
+	// before the terms are added
+	size_t constraint_hessian_start = 0;
+	size_t constraint_hessian_end = 0;
+
+	// incremented by every change that invalidates the analyzed structure
+	size_t structure_version = 0;
 
 	void add_linear_constraint(const ScalarAffineFunction &f, size_t y);
 	void add_quadratic_constraint(const ScalarQuadraticFunction &f, size_t y);
@@ -398,23 +607,28 @@ struct LinearQuadraticModel
 	void add_objective(const T &expr)
 	{
 		lq_objective += expr;
+		structure_version++;
 	}
 
 	template <typename T>
 	void set_objective(const T &expr)
 	{
 		lq_objective = expr;
+		structure_version++;
 	}
 
 	void analyze_jacobian_structure(size_t &m_jacobian_nnz, std::vector<size_t> &m_jacobian_rows,
 	                                std::vector<size_t> &m_jacobian_cols);
 	void analyze_dense_gradient_structure();
-	void analyze_sparse_gradient_structure(size_t &gradient_nnz, std::vector<size_t> &gradient_cols,
-	                                       Hashmap<size_t, size_t> &gradient_index_map);
-	void analyze_hessian_structure(size_t &m_hessian_nnz, std::vector<size_t> &m_hessian_rows,
-	                               std::vector<size_t> &m_hessian_cols,
-	                               Hashmap<VariablePair, size_t> &m_hessian_index_map,
-	                               HessianSparsityType hessian_sparsity_type);
+	// adds the hessian entries to builder and stores their ids in place of the hessian indices,
+	// assign_hessian_indices replaces the ids by the indices after builder.build()
+	void analyze_hessian_structure(HessianStructureBuilder &builder);
+	// orders the nonzeros as [nonzeros of the entries with id < n_shared_entries, nonzeros only
+	// touched by the objective, other nonzeros], called between build() and assign_hessian_indices
+	void partition_hessian_structure(HessianStructureBuilder &builder, size_t n_shared_entries,
+	                                 std::vector<size_t> &m_hessian_rows,
+	                                 std::vector<size_t> &m_hessian_cols);
+	void assign_hessian_indices(const HessianStructureBuilder &builder);
 
 #define restrict __restrict
 
@@ -430,6 +644,15 @@ struct LinearQuadraticModel
 	                             const double *restrict lambda, double *restrict hessian);
 };
 
+// A function whose sparsity and derivative graphs are computed later, nl_functions[index] only
+// has its dimensions and name until then
+struct DeferredFunction
+{
+	size_t index;
+	ADFunD f;
+	std::vector<double> x_values, p_values;
+};
+
 struct NonlinearFunctionModel
 {
 	std::vector<NonlinearFunction> nl_functions;
@@ -440,12 +663,48 @@ struct NonlinearFunctionModel
 
 	std::vector<double> p;
 
+	// incremented by every change of the functions and their instances, the values of parameters
+	// are not part of the structure
+	size_t structure_version = 0;
+
+	// the objective, the constraints and their derivatives are evaluated by several threads if
+	// n_threads > 1, each thread evaluates a contiguous part of the instances
+	std::unique_ptr<ThreadPool> thread_pool;
+	// the nonzeros of hessian written by the nonlinear functions are in [0, hessian_nnz)
+	size_t hessian_nnz = 0;
+	// the hessian of the threads except the first one are accumulated in their own buffers
+	std::vector<std::vector<double>> hessian_buffers;
+
+	// the nonlinear terms of objective are summed with compensated summation
+	bool compensated_objective_sum = false;
+	// partial sums of the objective of each thread
+	std::vector<double> objective_partial_sums;
+
+	// The values and jacobians of kernels with fused evaluators are computed together at the
+	// first evaluation of a new x and reused by the other evaluations at the same x.
+	// The optimizer calls new_x() when x changes.
+	std::vector<double> constraint_fused_values, objective_fused_values;
+	bool constraint_fused_valid = false, objective_fused_valid = false;
+
+	size_t get_n_threads() const;
+	void set_n_threads(size_t n_threads);
+
 	ParameterIndex add_parameter(double value = 0.0);
 	void set_parameter(const ParameterIndex &parameter, double value);
 
 	FunctionIndex register_function(ADFunD &f, const std::string &name,
 	                                const std::vector<double> &x_values,
 	                                const std::vector<double> &p_values);
+	FunctionIndex register_function_from_analysis(ADFunD &f, const std::string &name,
+	                                              const std::string &analysis);
+
+	// Registering a function with CppAD is expensive, deferred functions are initialized together
+	// by initialize_deferred_functions on the thread pool, each by one thread
+	std::vector<DeferredFunction> deferred_functions;
+	FunctionIndex register_function_deferred(ADFunD &f, const std::string &name,
+	                                         const std::vector<double> &x_values,
+	                                         const std::vector<double> &p_values);
+	void initialize_deferred_functions();
 
 	NLConstraintIndex add_nl_constraint(const FunctionIndex &k,
 	                                    const std::vector<VariableIndex> &xs,
@@ -466,10 +725,11 @@ struct NonlinearFunctionModel
 	void analyze_dense_gradient_structure();
 	void analyze_sparse_gradient_structure(size_t &gradient_nnz, std::vector<size_t> &gradient_cols,
 	                                       Hashmap<size_t, size_t> &gradient_index_map);
-	void analyze_hessian_structure(size_t &m_hessian_nnz, std::vector<size_t> &m_hessian_rows,
-	                               std::vector<size_t> &m_hessian_cols,
-	                               Hashmap<VariablePair, size_t> &m_hessian_index_map,
-	                               HessianSparsityType hessian_sparsity_type);
+	void analyze_hessian_structure(HessianStructureBuilder &builder);
+	void assign_hessian_indices(const HessianStructureBuilder &builder);
+	void analyze_fused_structure();
+
+	void new_x();
 
 	void eval_objective(const double *x, double *y);
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <span>
+#include <stdexcept>
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include "pyoptinterface/core.hpp"
+
+namespace nb = nanobind;
+
+using IndexArray = nb::ndarray<const IndexT, nb::ndim<1>, nb::c_contig, nb::device::cpu>;
+using CoeffArray = nb::ndarray<const CoeffT, nb::ndim<1>, nb::c_contig, nb::device::cpu>;
+using DoubleNumpyArray = nb::ndarray<nb::numpy, double, nb::ndim<1>>;
+
+// Allocates a NumPy array with N elements and lets f fill it
+template <typename F>
+DoubleNumpyArray make_numpy_array(size_t N, F &&f)
+{
+	double *values = new double[N];
+	nb::capsule owner(values, [](void *p) noexcept { delete[] (double *)p; });
+	f(std::span<double>(values, N));
+	return DoubleNumpyArray(values, {N}, owner);
+}
+
+// Bulk getters shared by the solver extensions, the model must provide
+// get_variable_values(span<const IndexT>, span<double>) and the same for get_constraint_duals
+template <typename Model>
+DoubleNumpyArray get_variable_values_array(Model &model, IndexArray variables)
+{
+	return make_numpy_array(variables.shape(0), [&](std::span<double> values) {
+		model.get_variable_values({variables.data(), variables.shape(0)}, values);
+	});
+}
+
+template <typename Model>
+DoubleNumpyArray get_variable_values_list(Model &model, const Vector<VariableIndex> &variables)
+{
+	Vector<IndexT> indices(variables.size());
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		indices[i] = variables[i].index;
+	}
+	return make_numpy_array(indices.size(), [&](std::span<double> values) {
+		model.get_variable_values(indices, values);
+	});
+}
+
+template <typename Model>
+DoubleNumpyArray get_constraint_duals_array(Model &model, IndexArray constraints)
+{
+	return make_numpy_array(constraints.shape(0), [&](std::span<double> values) {
+		model.get_constraint_duals({constraints.data(), constraints.shape(0)}, values);
+	});
+}
+
+template <typename Model>
+DoubleNumpyArray get_constraint_duals_list(Model &model, const Vector<ConstraintIndex> &constraints)
+{
+	Vector<IndexT> indices(constraints.size());
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		if (constraints[i].type != ConstraintType::Linear)
+		{
+			throw std::runtime_error("Only linear constraints are supported");
+		}
+		indices[i] = constraints[i].index;
+	}
+	return make_numpy_array(indices.size(), [&](std::span<double> values) {
+		model.get_constraint_duals(indices, values);
+	});
+}
@@ -327,6 +327,34 @@ void CommercialSolverMixin<T>::set_objective_as_constant(CoeffT c, ObjectiveSens
 	get_base()->set_objective(f, sense);
 }
 
+// The arguments of batch operations are either empty (the default value is used), scalar (the
+// only element is used for all items) or have exactly N elements
+template <typename C>
+void check_batch_argument(const C &values, size_t N, const char *name)
+{
+	auto n = values.size();
+	if (n > 1 && n != N)
+	{
+		throw std::runtime_error(
+		    fmt::format("The length of {} must be 0, 1 or {}, but got {}", name, N, n));
+	}
+}
+
+template <typename C>
+auto get_batch_argument(const C &values, size_t i, const typename C::value_type &default_value)
+    -> const typename C::value_type &
+{
+	switch (values.size())
+	{
+	case 0:
+		return default_value;
+	case 1:
+		return values[0];
+	default:
+		return values[i];
+	}
+}
+
 /* This concept combined with partial specialization causes ICE on gcc 10 */
 // template <typename T>
 // concept VarIndexModel = requires(T *model, const VariableIndex &v) {
@@ -351,10 +379,7 @@ struct AffineFunctionPtrForm
 		auto f_numnz = function.size();
 		numnz = f_numnz;
 		index_storage.resize(numnz);
-		for (int i = 0; i < numnz; ++i)
-		{
-			index_storage[i] = model->_variable_index(function.variables[i]);
-		}
+		model->_variable_indices(function.variables, index_storage);
 		index = index_storage.data();
 		if constexpr (std::is_same_v<VALT, CoeffT>)
 		{
@@ -367,6 +392,73 @@ struct AffineFunctionPtrForm
 			{
 				value_storage[i] = function.coefficients[i];
 			}
+			value = value_storage.data();
+		}
+	}
+};
+
+// A block of linear rows in CSR form, row i has the terms [row_starts[i], row_starts[i+1])
+// The variables are mapped to the columns of solver and the row starts are rebased to 0
+template <std::integral NZT, std::integral IDXT, std::floating_point VALT>
+struct CSRMatrixPtrForm
+{
+	int numrows;
+	NZT numnz;
+	NZT *start;
+	IDXT *index;
+	VALT *value;
+	std::vector<NZT> start_storage;
+	std::vector<IDXT> index_storage;
+	std::vector<VALT> value_storage;
+
+	template <VarIndexModel T>
+	void make(T *model, std::span<const IndexT> row_starts, std::span<const IndexT> variables,
+	          std::span<const CoeffT> coefficients)
+	{
+		if (row_starts.empty())
+		{
+			throw std::runtime_error("row_starts must have at least one element");
+		}
+		if (variables.size() != coefficients.size())
+		{
+			throw std::runtime_error("variables and coefficients must have the same length");
+		}
+		numrows = row_starts.size() - 1;
+		IndexT offset = row_starts[0];
+		IndexT end = row_starts[numrows];
+		if (offset < 0 || end < offset || static_cast<size_t>(end) > variables.size())
+		{
+			throw std::runtime_error("row_starts is out of the range of variables");
+		}
+		numnz = end - offset;
+
+		start_storage.resize(numrows + 1);
+		for (int i = 0; i <= numrows; ++i)
+		{
+			if (i > 0 && row_starts[i] < row_starts[i - 1])
+			{
+				throw std::runtime_error("row_starts must be nondecreasing");
+			}
+			start_storage[i] = row_starts[i] - offset;
+		}
+		start = start_storage.data();
+
+		index_storage.resize(numnz);
+		model->_checked_variable_indices(variables.subspan(offset, numnz), index_storage);
+		index = index_storage.data();
+
+		if constexpr (std::is_same_v<VALT, CoeffT>)
+		{
+			value = (VALT *)coefficients.data() + offset;
+		}
+		else
+		{
+			value_storage.resize(numnz);
+			for (NZT i = 0; i < numnz; ++i)
+			{
+				value_storage[i] = coefficients[offset + i];
+			}
+			value = value_storage.data();
 		}
 	}
 };
@@ -389,18 +481,8 @@ struct QuadraticFunctionPtrForm
 		numnz = f_numnz;
 		row_storage.resize(numnz);
 		col_storage.resize(numnz);
-		for (int i = 0; i < numnz; ++i)
-		{
-			row_storage[i] = model->_variable_index(function.variable_1s[i]);
-			if (function.variable_1s[i] == function.variable_2s[i])
-			{
-				col_storage[i] = row_storage[i];
-			}
-			else
-			{
-				col_storage[i] = model->_variable_index(function.variable_2s[i]);
-			}
-		}
+		model->_variable_indices(function.variable_1s, row_storage);
+		model->_variable_indices(function.variable_2s, col_storage);
 		row = row_storage.data();
 		col = col_storage.data();
 		if constexpr (std::is_same_v<VALT, CoeffT>)
@@ -414,6 +496,7 @@ struct QuadraticFunctionPtrForm
 			{
 				value_storage[i] = function.coefficients[i];
 			}
+			value = value_storage.data();
 		}
 	}
 };
@@ -443,14 +526,12 @@ struct CSCMatrix
 
 		std::vector<IDXT> rows(numnz); // Row indices
 		std::vector<IDXT> cols(numnz); // Column indices
+		model->_variable_indices(function.variable_1s, rows);
+		model->_variable_indices(function.variable_2s, cols);
 		for (int i = 0; i < numnz; ++i)
 		{
-			auto v1 = model->_variable_index(function.variable_1s[i]);
-			auto v2 = v1;
-			if (function.variable_1s[i] != function.variable_2s[i])
-			{
-				v2 = model->_variable_index(function.variable_2s[i]);
-			}
+			auto v1 = rows[i];
+			auto v2 = cols[i];
 
 			if (triangular_format == HessianTriangular::Upper)
 			{
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed group of worker threads for fork-join loops
+//
+// run(f) calls f(0), f(1), ..., f(n_threads - 1) concurrently and returns when all of them have
+// finished. f(0) is called on the calling thread, so a pool with one thread starts no worker at
+// all. The workers sleep between two calls of run.
+// If some calls of f throw, run still waits for all threads and then rethrows the first exception
+// on the calling thread.
+class ThreadPool
+{
+  public:
+	ThreadPool() = default;
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	size_t size() const;
+	void resize(size_t n_threads);
+
+	void run(const std::function<void(size_t)> &f);
+
+  private:
+	void stop_workers();
+	void worker_loop(size_t thread_id, size_t generation);
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_start_cv, m_finish_cv;
+	const std::function<void(size_t)> *m_task = nullptr;
+	// incremented by every call of run, the workers wait until it changes
+	size_t m_generation = 0;
+	size_t m_n_running = 0;
+	// the first exception thrown by a call of f during the current run
+	std::exception_ptr m_exception;
+	bool m_stop = false;
+};
@@ -1,143 +1,420 @@
-// #include <optional>
-//
-// #include "pyoptinterface/core.hpp"
-// #include "pyoptinterface/container.hpp"
-//
-// struct VariableInfo
-//{
-//	VariableDomain domain;
-// };
-//
-// class CacheModel
-//{
-//   public:
-//	VariableIndex add_variable(VariableDomain domain = VariableDomain::Continuous);
-//	void delete_variable(const VariableIndex &variable);
-//	bool is_variable_active(const VariableIndex &variable) const;
-//
-//	ConstraintIndex add_linear_constraint(const LinearConstraint &constraint);
-//	ConstraintIndex add_quadratic_constraint(const QuadraticConstraint &constraint);
-//	ConstraintIndex add_sos1_constraint(const SOSConstraint &constraint);
-//	ConstraintIndex add_sos2_constraint(const SOSConstraint &constraint);
-//
-//	void delete_constraint(const ConstraintIndex &constraint);
-//
-//	bool is_constraint_active(const ConstraintIndex &constraint) const;
-//
-//   private:
-//	int num_variable = 0;
-//	MonotoneVector<int> m_variable_index;
-//	Vector<std::optional<VariableInfo>> m_variables;
-//
-//	int num_linear_constraint = 0;
-//	MonotoneVector<int> m_linear_constraint_index;
-//	Vector<std::optional<LinearConstraint>> m_linear_constraints;
-//
-//	int num_quadratic_constraint = 0;
-//	MonotoneVector<int> m_quadratic_constraint_index;
-//	Vector<std::optional<QuadraticConstraint>> m_quadratic_constraints;
-//
-//	int num_sos1_constraint = 0;
-//	MonotoneVector<int> m_sos1_constraint_index;
-//	Vector<std::optional<SOSConstraint>> m_sos1_constraints;
-//
-//	int num_sos2_constraint = 0;
-//	MonotoneVector<int> m_sos2_constraint_index;
-//	Vector<std::optional<SOSConstraint>> m_sos2_constraints;
-// };
-//
-// VariableIndex CacheModel::add_variable(VariableDomain domain)
-//{
-//	IndexT index = m_variable_index.add_index();
-//	m_variables.push_back(VariableInfo{domain});
-//	num_variable++;
-//	return VariableIndex(index);
-// }
-//
-// void CacheModel::delete_variable(const VariableIndex &variable)
-//{
-//	m_variable_index.delete_index(variable.index);
-//	m_variables[variable.index] = std::nullopt;
-//	num_variable--;
-// }
-//
-// bool CacheModel::is_variable_active(const VariableIndex &variable) const
-//{
-//	return m_variables[variable.index].has_value();
-// }
-//
-// ConstraintIndex CacheModel::add_linear_constraint(const LinearConstraint &constraint)
-//{
-//	IndexT index = m_linear_constraint_index.add_index();
-//	m_linear_constraints.push_back(constraint);
-//	num_linear_constraint++;
-//	return ConstraintIndex{ConstraintType::Linear, index};
-// }
-//
-// ConstraintIndex CacheModel::add_quadratic_constraint(const QuadraticConstraint &constraint)
-//{
-//	IndexT index = m_quadratic_constraint_index.add_index();
-//	m_quadratic_constraints.push_back(constraint);
-//	num_quadratic_constraint++;
-//	return ConstraintIndex{ConstraintType::Quadratic, index};
-// }
-//
-// ConstraintIndex CacheModel::add_sos1_constraint(const SOSConstraint &constraint)
-//{
-//	IndexT index = m_sos1_constraint_index.add_index();
-//	m_sos1_constraints.push_back(constraint);
-//	num_sos1_constraint++;
-//	return ConstraintIndex{ConstraintType::SOS1, index};
-// }
-//
-// ConstraintIndex CacheModel::add_sos2_constraint(const SOSConstraint &constraint)
-//{
-//	IndexT index = m_sos2_constraint_index.add_index();
-//	m_sos2_constraints.push_back(constraint);
-//	num_sos2_constraint++;
-//	return ConstraintIndex{ConstraintType::SOS2, index};
-// }
-//
-// void CacheModel::delete_constraint(const ConstraintIndex &constraint)
-//{
-//	auto index = constraint.index;
-//	switch (constraint.type)
-//	{
-//	case ConstraintType::Linear:
-//		m_linear_constraint_index.delete_index(index);
-//		m_linear_constraints[index] = std::nullopt;
-//		num_linear_constraint--;
-//		break;
-//	case ConstraintType::Quadratic:
-//		m_quadratic_constraint_index.delete_index(index);
-//		m_quadratic_constraints[index] = std::nullopt;
-//		num_quadratic_constraint--;
-//		break;
-//	case ConstraintType::SOS1:
-//		m_sos1_constraint_index.delete_index(index);
-//		m_sos1_constraints[index] = std::nullopt;
-//		num_sos1_constraint--;
-//		break;
-//	case ConstraintType::SOS2:
-//		m_sos2_constraint_index.delete_index(index);
-//		m_sos2_constraints[index] = std::nullopt;
-//		num_sos2_constraint--;
-//		break;
-//	}
-// }
-//
-// bool CacheModel::is_constraint_active(const ConstraintIndex &constraint) const
-//{
-//	auto index = constraint.index;
-//	switch (constraint.type)
-//	{
-//	case ConstraintType::Linear:
-//		return m_linear_constraint_index.has_index(index);
-//	case ConstraintType::Quadratic:
-//		return m_quadratic_constraint_index.has_index(index);
-//	case ConstraintType::SOS1:
-//		return m_sos1_constraint_index.has_index(index);
-//	case ConstraintType::SOS2:
-//		return m_sos2_constraint_index.has_index(index);
-//	}
-// }
+#include "pyoptinterface/cache_model.hpp"
+
+#include "fmt/format.h"
+#include "pyoptinterface/solver_common.hpp"
+
+VariableIndex CacheModel::add_variable(VariableDomain domain, double lb, double ub,
+                                       const char *name)
+{
+	IndexT index = m_variable_index.add_index();
+	m_variable_domains.push_back(domain);
+	m_variable_lbs.push_back(lb);
+	m_variable_ubs.push_back(ub);
+	if (name != nullptr && name[0] != '\0')
+	{
+		m_variable_names.resize(index);
+		m_variable_names.emplace_back(name);
+		m_has_variable_names = true;
+	}
+	else if (m_has_variable_names)
+	{
+		m_variable_names.resize(index + 1);
+	}
+	m_n_variables++;
+	return VariableIndex(index);
+}
+
+VariableIndex CacheModel::add_variables(int N, const Vector<VariableDomain> &domains,
+                                        const Vector<double> &lbs, const Vector<double> &ubs,
+                                        const Vector<std::string> &names)
+{
+	check_batch_argument(domains, N, "domains");
+	check_batch_argument(lbs, N, "lbs");
+	check_batch_argument(ubs, N, "ubs");
+	check_batch_argument(names, N, "names");
+
+	IndexT index = m_variable_index.add_indices(N);
+	auto new_size = index + N;
+	m_variable_domains.reserve(new_size);
+	m_variable_lbs.reserve(new_size);
+	m_variable_ubs.reserve(new_size);
+	for (int i = 0; i < N; i++)
+	{
+		m_variable_domains.push_back(
+		    get_batch_argument(domains, i, VariableDomain::Continuous));
+		m_variable_lbs.push_back(get_batch_argument(lbs, i, -INF));
+		m_variable_ubs.push_back(get_batch_argument(ubs, i, INF));
+	}
+	if (!names.empty())
+	{
+		m_variable_names.resize(index);
+		for (int i = 0; i < N; i++)
+		{
+			m_variable_names.push_back(get_batch_argument(names, i, std::string{}));
+		}
+		m_has_variable_names = true;
+	}
+	else if (m_has_variable_names)
+	{
+		m_variable_names.resize(new_size);
+	}
+	m_n_variables += N;
+	return VariableIndex(index);
+}
+
+void CacheModel::delete_variable(const VariableIndex &variable)
+{
+	if (!is_variable_active(variable))
+	{
+		throw std::runtime_error("Variable does not exist");
+	}
+	m_variable_index.delete_index(variable.index);
+	m_n_variables--;
+}
+
+bool CacheModel::is_variable_active(const VariableIndex &variable) const
+{
+	if (variable.index < 0 ||
+	    static_cast<size_t>(variable.index) >= m_variable_domains.size())
+	{
+		return false;
+	}
+	return m_variable_index.has_index(variable.index);
+}
+
+size_t CacheModel::number_of_variables() const
+{
+	return m_n_variables;
+}
+
+void CacheModel::_check_variables(std::span<const IndexT> variables) const
+{
+	for (auto v : variables)
+	{
+		if (!is_variable_active(VariableIndex(v)))
+		{
+			throw std::runtime_error(fmt::format("Variable {} does not exist", v));
+		}
+	}
+}
+
+ConstraintIndex CacheModel::add_linear_constraint(const ScalarAffineFunction &function,
+                                                  ConstraintSense sense, CoeffT rhs,
+                                                  const char *name)
+{
+	_check_variables(function.variables);
+
+	IndexT index = m_linear_constraint_index.add_index();
+	m_linear_variables.insert(m_linear_variables.end(), function.variables.begin(),
+	                          function.variables.end());
+	m_linear_coefficients.insert(m_linear_coefficients.end(), function.coefficients.begin(),
+	                             function.coefficients.end());
+	m_linear_row_starts.push_back(m_linear_variables.size());
+	m_linear_senses.push_back(sense);
+	m_linear_rhss.push_back(rhs - function.constant.value_or(0.0));
+	if (name != nullptr && name[0] != '\0')
+	{
+		m_linear_names.resize(index);
+		m_linear_names.emplace_back(name);
+		m_has_linear_names = true;
+	}
+	else if (m_has_linear_names)
+	{
+		m_linear_names.resize(index + 1);
+	}
+	m_n_linear_constraints++;
+	return ConstraintIndex(ConstraintType::Linear, index);
+}
+
+ConstraintIndex CacheModel::add_linear_constraints(std::span<const IndexT> row_starts,
+                                                   std::span<const IndexT> variables,
+                                                   std::span<const CoeffT> coefficients,
+                                                   const Vector<ConstraintSense> &senses,
+                                                   std::span<const CoeffT> rhss,
+                                                   const Vector<std::string> &names)
+{
+	if (row_starts.empty())
+	{
+		throw std::runtime_error("row_starts must have at least one element");
+	}
+	if (variables.size() != coefficients.size())
+	{
+		throw std::runtime_error("variables and coefficients must have the same length");
+	}
+	int N = row_starts.size() - 1;
+	IndexT offset = row_starts[0];
+	IndexT end = row_starts[N];
+	if (offset < 0 || end < offset || static_cast<size_t>(end) > variables.size())
+	{
+		throw std::runtime_error("row_starts is out of the range of variables");
+	}
+	for (int i = 1; i <= N; i++)
+	{
+		if (row_starts[i] < row_starts[i - 1])
+		{
+			throw std::runtime_error("row_starts must be nondecreasing");
+		}
+	}
+	check_batch_argument(senses, N, "senses");
+	check_batch_argument(rhss, N, "rhss");
+	check_batch_argument(names, N, "names");
+	auto row_variables = variables.subspan(offset, end - offset);
+	auto row_coefficients = coefficients.subspan(offset, end - offset);
+	_check_variables(row_variables);
+
+	IndexT index = m_linear_constraint_index.add_indices(N);
+	IndexT base = m_linear_variables.size();
+	m_linear_variables.insert(m_linear_variables.end(), row_variables.begin(),
+	                          row_variables.end());
+	m_linear_coefficients.insert(m_linear_coefficients.end(), row_coefficients.begin(),
+	                             row_coefficients.end());
+	for (int i = 0; i < N; i++)
+	{
+		m_linear_row_starts.push_back(base + row_starts[i + 1] - offset);
+		m_linear_senses.push_back(get_batch_argument(senses, i, ConstraintSense::Equal));
+		m_linear_rhss.push_back(get_batch_argument(rhss, i, 0.0));
+	}
+	if (!names.empty())
+	{
+		m_linear_names.resize(index);
+		for (int i = 0; i < N; i++)
+		{
+			m_linear_names.push_back(get_batch_argument(names, i, std::string{}));
+		}
+		m_has_linear_names = true;
+	}
+	else if (m_has_linear_names)
+	{
+		m_linear_names.resize(index + N);
+	}
+	m_n_linear_constraints += N;
+	return ConstraintIndex(ConstraintType::Linear, index);
+}
+
+ConstraintIndex CacheModel::add_quadratic_constraint(const ScalarQuadraticFunction &function,
+                                                     ConstraintSense sense, CoeffT rhs,
+                                                     const char *name)
+{
+	_check_variables(function.variable_1s);
+	_check_variables(function.variable_2s);
+	if (function.affine_part)
+	{
+		_check_variables(function.affine_part->variables);
+	}
+
+	IndexT index = m_quadratic_constraint_index.add_index();
+	m_quadratic_variable_1s.insert(m_quadratic_variable_1s.end(), function.variable_1s.begin(),
+	                               function.variable_1s.end());
+	m_quadratic_variable_2s.insert(m_quadratic_variable_2s.end(), function.variable_2s.begin(),
+	                               function.variable_2s.end());
+	m_quadratic_coefficients.insert(m_quadratic_coefficients.end(),
+	                                function.coefficients.begin(), function.coefficients.end());
+	m_quadratic_starts.push_back(m_quadratic_coefficients.size());
+	if (function.affine_part)
+	{
+		auto &affine = function.affine_part.value();
+		m_quadratic_affine_variables.insert(m_quadratic_affine_variables.end(),
+		                                    affine.variables.begin(), affine.variables.end());
+		m_quadratic_affine_coefficients.insert(m_quadratic_affine_coefficients.end(),
+		                                       affine.coefficients.begin(),
+		                                       affine.coefficients.end());
+		rhs -= affine.constant.value_or(0.0);
+	}
+	m_quadratic_affine_starts.push_back(m_quadratic_affine_variables.size());
+	m_quadratic_senses.push_back(sense);
+	m_quadratic_rhss.push_back(rhs);
+	m_quadratic_names.emplace_back(name != nullptr ? name : "");
+	m_n_quadratic_constraints++;
+	return ConstraintIndex(ConstraintType::Quadratic, index);
+}
+
+ConstraintIndex CacheModel::add_sos_constraint(const Vector<VariableIndex> &variables,
+                                               SOSType sos_type, const Vector<CoeffT> &weights)
+{
+	if (!weights.empty() && weights.size() != variables.size())
+	{
+		throw std::runtime_error("The number of weights must be equal to the number of variables");
+	}
+	for (auto &v : variables)
+	{
+		if (!is_variable_active(v))
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+
+	IndexT index = m_sos_constraint_index.add_index();
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		m_sos_variables.push_back(variables[i].index);
+		m_sos_weights.push_back(weights.empty() ? 1.0 : weights[i]);
+	}
+	m_sos_starts.push_back(m_sos_variables.size());
+	m_sos_types.push_back(sos_type);
+	m_n_sos_constraints++;
+	return ConstraintIndex(ConstraintType::SOS, index);
+}
+
+ConstraintIndex CacheModel::add_second_order_cone_constraint(
+    const Vector<VariableIndex> &variables, const char *name, bool rotated)
+{
+	for (auto &v : variables)
+	{
+		if (!is_variable_active(v))
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+
+	IndexT index = m_cone_constraint_index.add_index();
+	for (auto &v : variables)
+	{
+		m_cone_variables.push_back(v.index);
+	}
+	m_cone_starts.push_back(m_cone_variables.size());
+	m_cone_rotated.push_back(rotated);
+	m_cone_names.emplace_back(name != nullptr ? name : "");
+	m_n_cone_constraints++;
+	return ConstraintIndex(ConstraintType::Cone, index);
+}
+
+void CacheModel::delete_constraint(const ConstraintIndex &constraint)
+{
+	if (!is_constraint_active(constraint))
+	{
+		throw std::runtime_error("Constraint does not exist");
+	}
+	switch (constraint.type)
+	{
+	case ConstraintType::Linear:
+		m_linear_constraint_index.delete_index(constraint.index);
+		m_n_linear_constraints--;
+		break;
+	case ConstraintType::Quadratic:
+		m_quadratic_constraint_index.delete_index(constraint.index);
+		m_n_quadratic_constraints--;
+		break;
+	case ConstraintType::SOS:
+		m_sos_constraint_index.delete_index(constraint.index);
+		m_n_sos_constraints--;
+		break;
+	case ConstraintType::Cone:
+		m_cone_constraint_index.delete_index(constraint.index);
+		m_n_cone_constraints--;
+		break;
+	default:
+		throw std::runtime_error("Unknown constraint type");
+	}
+}
+
+bool CacheModel::is_constraint_active(const ConstraintIndex &constraint) const
+{
+	auto index = constraint.index;
+	auto active = [index](const MonotoneIndexer<int> &indexer, size_t N) {
+		return index >= 0 && static_cast<size_t>(index) < N && indexer.has_index(index);
+	};
+	switch (constraint.type)
+	{
+	case ConstraintType::Linear:
+		return active(m_linear_constraint_index, m_linear_senses.size());
+	case ConstraintType::Quadratic:
+		return active(m_quadratic_constraint_index, m_quadratic_senses.size());
+	case ConstraintType::SOS:
+		return active(m_sos_constraint_index, m_sos_types.size());
+	case ConstraintType::Cone:
+		return active(m_cone_constraint_index, m_cone_rotated.size());
+	default:
+		return false;
+	}
+}
+
+size_t CacheModel::number_of_constraints(ConstraintType type) const
+{
+	switch (type)
+	{
+	case ConstraintType::Linear:
+		return m_n_linear_constraints;
+	case ConstraintType::Quadratic:
+		return m_n_quadratic_constraints;
+	case ConstraintType::SOS:
+		return m_n_sos_constraints;
+	case ConstraintType::Cone:
+		return m_n_cone_constraints;
+	default:
+		throw std::runtime_error("Unknown constraint type");
+	}
+}
+
+void CacheModel::set_objective(const ScalarAffineFunction &function, ObjectiveSense sense)
+{
+	_check_variables(function.variables);
+	ScalarQuadraticFunction f;
+	f.affine_part = function;
+	m_objective = f;
+	m_objective_sense = sense;
+}
+
+void CacheModel::set_objective(const ScalarQuadraticFunction &function, ObjectiveSense sense)
+{
+	_check_variables(function.variable_1s);
+	_check_variables(function.variable_2s);
+	if (function.affine_part)
+	{
+		_check_variables(function.affine_part->variables);
+	}
+	m_objective = function;
+	m_objective_sense = sense;
+}
+
+void CacheModel::set_objective(const ExprBuilder &function, ObjectiveSense sense)
+{
+	auto deg = function.degree();
+	if (deg <= 1)
+	{
+		ScalarAffineFunction f(function);
+		set_objective(f, sense);
+	}
+	else if (deg == 2)
+	{
+		ScalarQuadraticFunction f(function);
+		set_objective(f, sense);
+	}
+	else
+	{
+		throw std::runtime_error("Objective must be linear or quadratic");
+	}
+}
+
+void CacheModel::clear()
+{
+	*this = CacheModel();
+}
+
+VariableIndex CacheModelFlushHandles::variable(const VariableIndex &variable) const
+{
+	return VariableIndex(variable_offset + variable.index);
+}
+
+ConstraintIndex CacheModelFlushHandles::constraint(const ConstraintIndex &constraint) const
+{
+	auto recorded = [&](const Vector<ConstraintIndex> &handles) {
+		if (constraint.index < 0 || static_cast<size_t>(constraint.index) >= handles.size())
+		{
+			throw std::runtime_error("The constraint was not flushed");
+		}
+		return handles[constraint.index];
+	};
+	switch (constraint.type)
+	{
+	case ConstraintType::Linear:
+		return ConstraintIndex(ConstraintType::Linear, linear_offset + constraint.index);
+	case ConstraintType::Quadratic:
+		return recorded(quadratic_constraints);
+	case ConstraintType::SOS:
+		return recorded(sos_constraints);
+	case ConstraintType::Cone:
+		return recorded(cone_constraints);
+	default:
+		throw std::runtime_error("Unknown constraint type");
+	}
+}
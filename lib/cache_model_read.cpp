@@ -0,0 +1,1472 @@
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <string_view>
+
+#include "fmt/format.h"
+#include "pyoptinterface/cache_model.hpp"
+
+// Reads CPLEX LP and free MPS files into CacheModel
+// The whole file is read into one buffer and all names are std::string_view into it, so the
+// parsers do not allocate per token. The parsers fill ParsedModel with flat arrays, which is added
+// to CacheModel by its bulk APIs at the end.
+namespace
+{
+constexpr double INF = CacheModel::INF;
+
+bool iequals(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (std::tolower(static_cast<unsigned char>(a[i])) !=
+		    std::tolower(static_cast<unsigned char>(b[i])))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// parse the whole string as a number, "inf" and "infinity" are accepted
+bool parse_number(std::string_view s, double &value)
+{
+	if (!s.empty() && s[0] == '+')
+	{
+		s.remove_prefix(1);
+	}
+	auto end = s.data() + s.size();
+	auto [ptr, ec] = std::from_chars(s.data(), end, value);
+	return ec == std::errc() && ptr == end;
+}
+
+std::string read_file(const std::string &filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error(fmt::format("Cannot open file {}", filename));
+	}
+	file.seekg(0, std::ios::end);
+	auto size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	std::string buffer(size, '\0');
+	file.read(buffer.data(), size);
+	return buffer;
+}
+
+struct ParsedModel
+{
+	// variables, new variables have the default bounds [0, +inf) of both formats
+	Vector<std::string_view> variable_names;
+	std::unordered_map<std::string_view, IndexT> variable_map;
+	Vector<VariableDomain> variable_domains;
+	Vector<double> variable_lbs;
+	Vector<double> variable_ubs;
+
+	// constraints, the linear terms are in COO form
+	Vector<std::string_view> row_names;
+	Vector<ConstraintSense> row_senses;
+	Vector<CoeffT> row_rhss;
+	Vector<IndexT> term_rows;
+	Vector<IndexT> term_variables;
+	Vector<CoeffT> term_coefficients;
+	Vector<IndexT> quadratic_rows;
+	Vector<IndexT> quadratic_variable_1s;
+	Vector<IndexT> quadratic_variable_2s;
+	Vector<CoeffT> quadratic_coefficients;
+
+	ObjectiveSense objective_sense = ObjectiveSense::Minimize;
+	ScalarQuadraticFunction objective;
+	ScalarAffineFunction objective_affine;
+
+	Vector<std::string_view> sos_names;
+	Vector<SOSType> sos_types;
+	Vector<IndexT> sos_starts = {0};
+	Vector<IndexT> sos_variables;
+	Vector<CoeffT> sos_weights;
+
+	IndexT variable(std::string_view name)
+	{
+		auto [it, inserted] = variable_map.try_emplace(name, variable_names.size());
+		if (inserted)
+		{
+			variable_names.push_back(name);
+			variable_domains.push_back(VariableDomain::Continuous);
+			variable_lbs.push_back(0.0);
+			variable_ubs.push_back(INF);
+		}
+		return it->second;
+	}
+
+	IndexT add_row(std::string_view name, ConstraintSense sense, CoeffT rhs)
+	{
+		IndexT row = row_names.size();
+		row_names.push_back(name);
+		row_senses.push_back(sense);
+		row_rhss.push_back(rhs);
+		return row;
+	}
+
+	void add_term(IndexT row, IndexT variable, CoeffT coefficient)
+	{
+		term_rows.push_back(row);
+		term_variables.push_back(variable);
+		term_coefficients.push_back(coefficient);
+	}
+
+	void add_quadratic_term(IndexT row, IndexT variable_1, IndexT variable_2, CoeffT coefficient)
+	{
+		quadratic_rows.push_back(row);
+		quadratic_variable_1s.push_back(variable_1);
+		quadratic_variable_2s.push_back(variable_2);
+		quadratic_coefficients.push_back(coefficient);
+	}
+
+	void add_objective_term(IndexT variable, CoeffT coefficient)
+	{
+		objective_affine.variables.push_back(variable);
+		objective_affine.coefficients.push_back(coefficient);
+	}
+
+	void add_objective_quadratic_term(IndexT variable_1, IndexT variable_2, CoeffT coefficient)
+	{
+		objective.variable_1s.push_back(variable_1);
+		objective.variable_2s.push_back(variable_2);
+		objective.coefficients.push_back(coefficient);
+	}
+
+	void load(CacheModel &model, CacheModelFileHandles &handles) const;
+};
+
+void ParsedModel::load(CacheModel &model, CacheModelFileHandles &handles) const
+{
+	auto &[variable_handles, constraint_handles] = handles;
+
+	const IndexT n_variables = variable_names.size();
+	IndexT offset = 0;
+	if (n_variables > 0)
+	{
+		Vector<std::string> names(variable_names.begin(), variable_names.end());
+		offset = model.add_variables(n_variables, variable_domains, variable_lbs, variable_ubs,
+		                             names)
+		             .index;
+		variable_handles.reserve(n_variables);
+		for (IndexT i = 0; i < n_variables; i++)
+		{
+			variable_handles.emplace(std::move(names[i]), VariableIndex(offset + i));
+		}
+	}
+
+	// unnamed rows are named as R1, R2, ... like CPLEX
+	const IndexT n_rows = row_names.size();
+	auto row_name = [&](IndexT row) {
+		return row_names[row].empty() ? fmt::format("R{}", row + 1)
+		                              : std::string(row_names[row]);
+	};
+
+	// transpose COO to CSR by counting sort, the order of terms in a row is kept
+	Vector<IndexT> row_starts(n_rows + 1, 0);
+	for (auto row : term_rows)
+	{
+		row_starts[row + 1]++;
+	}
+	for (IndexT row = 0; row < n_rows; row++)
+	{
+		row_starts[row + 1] += row_starts[row];
+	}
+	Vector<IndexT> row_variables(term_rows.size());
+	Vector<CoeffT> row_coefficients(term_rows.size());
+	{
+		Vector<IndexT> position(row_starts.begin(), row_starts.end() - 1);
+		for (size_t k = 0; k < term_rows.size(); k++)
+		{
+			auto p = position[term_rows[k]]++;
+			row_variables[p] = term_variables[k] + offset;
+			row_coefficients[p] = term_coefficients[k];
+		}
+	}
+
+	Vector<bool> is_quadratic(n_rows, false);
+	for (auto row : quadratic_rows)
+	{
+		is_quadratic[row] = true;
+	}
+
+	// all linear rows are added in one batch
+	Vector<IndexT> linear_rows;
+	Vector<IndexT> linear_starts = {0};
+	Vector<IndexT> linear_variables;
+	Vector<CoeffT> linear_coefficients;
+	Vector<ConstraintSense> linear_senses;
+	Vector<CoeffT> linear_rhss;
+	Vector<std::string> linear_names;
+	linear_variables.reserve(row_variables.size());
+	linear_coefficients.reserve(row_coefficients.size());
+	for (IndexT row = 0; row < n_rows; row++)
+	{
+		if (is_quadratic[row])
+		{
+			continue;
+		}
+		linear_rows.push_back(row);
+		linear_variables.insert(linear_variables.end(), row_variables.begin() + row_starts[row],
+		                        row_variables.begin() + row_starts[row + 1]);
+		linear_coefficients.insert(linear_coefficients.end(),
+		                           row_coefficients.begin() + row_starts[row],
+		                           row_coefficients.begin() + row_starts[row + 1]);
+		linear_starts.push_back(linear_variables.size());
+		linear_senses.push_back(row_senses[row]);
+		linear_rhss.push_back(row_rhss[row]);
+		linear_names.push_back(row_name(row));
+	}
+	const IndexT n_linear = linear_rows.size();
+	if (n_linear > 0)
+	{
+		auto first = model.add_linear_constraints(linear_starts, linear_variables,
+		                                          linear_coefficients, linear_senses,
+		                                          linear_rhss, linear_names);
+		for (IndexT i = 0; i < n_linear; i++)
+		{
+			constraint_handles.emplace(std::move(linear_names[i]),
+			                           ConstraintIndex(ConstraintType::Linear, first.index + i));
+		}
+	}
+
+	if (n_linear < n_rows)
+	{
+		// group the quadratic terms by rows
+		Vector<IndexT> quadratic_starts(n_rows + 1, 0);
+		for (auto row : quadratic_rows)
+		{
+			quadratic_starts[row + 1]++;
+		}
+		for (IndexT row = 0; row < n_rows; row++)
+		{
+			quadratic_starts[row + 1] += quadratic_starts[row];
+		}
+		Vector<IndexT> order(quadratic_rows.size());
+		{
+			Vector<IndexT> position(quadratic_starts.begin(), quadratic_starts.end() - 1);
+			for (size_t k = 0; k < quadratic_rows.size(); k++)
+			{
+				order[position[quadratic_rows[k]]++] = k;
+			}
+		}
+
+		for (IndexT row = 0; row < n_rows; row++)
+		{
+			if (!is_quadratic[row])
+			{
+				continue;
+			}
+			ScalarQuadraticFunction f;
+			for (auto p = quadratic_starts[row]; p < quadratic_starts[row + 1]; p++)
+			{
+				auto k = order[p];
+				f.variable_1s.push_back(quadratic_variable_1s[k] + offset);
+				f.variable_2s.push_back(quadratic_variable_2s[k] + offset);
+				f.coefficients.push_back(quadratic_coefficients[k]);
+			}
+			if (row_starts[row + 1] > row_starts[row])
+			{
+				ScalarAffineFunction affine;
+				affine.variables.assign(row_variables.begin() + row_starts[row],
+				                        row_variables.begin() + row_starts[row + 1]);
+				affine.coefficients.assign(row_coefficients.begin() + row_starts[row],
+				                           row_coefficients.begin() + row_starts[row + 1]);
+				f.affine_part = affine;
+			}
+			auto name = row_name(row);
+			auto constraint =
+			    model.add_quadratic_constraint(f, row_senses[row], row_rhss[row], name.c_str());
+			constraint_handles.emplace(std::move(name), constraint);
+		}
+	}
+
+	ScalarAffineFunction affine;
+	for (size_t k = 0; k < objective_affine.variables.size(); k++)
+	{
+		affine.variables.push_back(objective_affine.variables[k] + offset);
+		affine.coefficients.push_back(objective_affine.coefficients[k]);
+	}
+	affine.constant = objective_affine.constant;
+	if (objective.size() > 0)
+	{
+		ScalarQuadraticFunction f;
+		f.coefficients = objective.coefficients;
+		for (size_t k = 0; k < objective.size(); k++)
+		{
+			f.variable_1s.push_back(objective.variable_1s[k] + offset);
+			f.variable_2s.push_back(objective.variable_2s[k] + offset);
+		}
+		f.affine_part = affine;
+		model.set_objective(f, objective_sense);
+	}
+	else
+	{
+		model.set_objective(affine, objective_sense);
+	}
+
+	const IndexT n_sos = sos_types.size();
+	for (IndexT i = 0; i < n_sos; i++)
+	{
+		Vector<VariableIndex> variables;
+		for (auto p = sos_starts[i]; p < sos_starts[i + 1]; p++)
+		{
+			variables.emplace_back(sos_variables[p] + offset);
+		}
+		Vector<CoeffT> weights(sos_weights.begin() + sos_starts[i],
+		                       sos_weights.begin() + sos_starts[i + 1]);
+		auto constraint = model.add_sos_constraint(variables, sos_types[i], weights);
+		auto name =
+		    sos_names[i].empty() ? fmt::format("SOS{}", i + 1) : std::string(sos_names[i]);
+		constraint_handles.emplace(std::move(name), constraint);
+	}
+}
+
+// Free MPS format, the fields are separated by whitespace so names must not contain spaces
+class MPSReader
+{
+  public:
+	MPSReader(std::string_view buffer, ParsedModel &model) : buffer(buffer), m(model)
+	{
+	}
+
+	void read();
+
+  private:
+	enum class Section
+	{
+		None,
+		ObjSense,
+		Rows,
+		Columns,
+		Rhs,
+		Ranges,
+		Bounds,
+		QuadObj,
+		QMatrix,
+		QCMatrix,
+		SOS,
+	};
+
+	// the objective row is OBJECTIVE_ROW and other free rows are FREE_ROW
+	static constexpr IndexT OBJECTIVE_ROW = -1;
+	static constexpr IndexT FREE_ROW = -2;
+
+	static constexpr size_t MAX_FIELDS = 8;
+
+	[[noreturn]] void error(std::string_view message) const
+	{
+		throw std::runtime_error(fmt::format("Invalid MPS file at line {}: {}", line, message));
+	}
+
+	// split the current line into fields, returns false at the end of the buffer
+	bool next_line()
+	{
+		while (position < buffer.size())
+		{
+			auto end = buffer.find('\n', position);
+			if (end == std::string_view::npos)
+			{
+				end = buffer.size();
+			}
+			auto text = buffer.substr(position, end - position);
+			position = end + 1;
+			line++;
+
+			n_fields = 0;
+			size_t i = 0;
+			while (i < text.size())
+			{
+				while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i])))
+				{
+					i++;
+				}
+				if (i == text.size())
+				{
+					break;
+				}
+				auto start = i;
+				while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])))
+				{
+					i++;
+				}
+				if (n_fields == MAX_FIELDS)
+				{
+					error("too many fields");
+				}
+				fields[n_fields++] = text.substr(start, i - start);
+			}
+			if (n_fields == 0 || fields[0][0] == '*')
+			{
+				continue;
+			}
+			is_header = !std::isspace(static_cast<unsigned char>(text[0]));
+			return true;
+		}
+		return false;
+	}
+
+	double number(size_t i) const
+	{
+		double value;
+		if (i >= n_fields || !parse_number(fields[i], value))
+		{
+			error("a number is expected");
+		}
+		return value;
+	}
+
+	IndexT row(std::string_view name) const
+	{
+		auto it = row_map.find(name);
+		if (it == row_map.end())
+		{
+			error(fmt::format("unknown row {}", name));
+		}
+		return it->second;
+	}
+
+	void add_quadratic_term(IndexT row, size_t i, double scale)
+	{
+		if (n_fields < i + 3)
+		{
+			error("two columns and a number are expected");
+		}
+		auto variable_1 = m.variable(fields[i]);
+		auto variable_2 = m.variable(fields[i + 1]);
+		auto coefficient = scale * number(i + 2);
+		if (row == OBJECTIVE_ROW)
+		{
+			m.add_objective_quadratic_term(variable_1, variable_2, coefficient);
+		}
+		else
+		{
+			m.add_quadratic_term(row, variable_1, variable_2, coefficient);
+		}
+	}
+
+	void read_header();
+	void read_bound();
+
+	std::string_view buffer;
+	ParsedModel &m;
+
+	size_t position = 0;
+	size_t line = 0;
+	std::string_view fields[MAX_FIELDS];
+	size_t n_fields = 0;
+	bool is_header = false;
+
+	Section section = Section::None;
+	bool has_objective_row = false;
+	bool in_integer_block = false;
+	IndexT qc_row = 0;
+	std::unordered_map<std::string_view, IndexT> row_map;
+	// MPS readers set the lower bound to -inf for a negative upper bound unless it is given
+	Vector<bool> has_lb;
+};
+
+void MPSReader::read()
+{
+	while (next_line())
+	{
+		if (is_header)
+		{
+			if (fields[0] == "ENDATA")
+			{
+				return;
+			}
+			read_header();
+			continue;
+		}
+
+		switch (section)
+		{
+		case Section::None:
+			error("data line outside of any section");
+		case Section::ObjSense:
+			if (fields[0] == "MAX" || fields[0] == "MAXIMIZE")
+			{
+				m.objective_sense = ObjectiveSense::Maximize;
+			}
+			else if (fields[0] == "MIN" || fields[0] == "MINIMIZE")
+			{
+				m.objective_sense = ObjectiveSense::Minimize;
+			}
+			else
+			{
+				error("unknown objective sense");
+			}
+			break;
+		case Section::Rows: {
+			if (n_fields < 2)
+			{
+				error("row type and name are expected");
+			}
+			auto type = fields[0];
+			auto name = fields[1];
+			IndexT row;
+			if (type == "N")
+			{
+				row = has_objective_row ? FREE_ROW : OBJECTIVE_ROW;
+				has_objective_row = true;
+			}
+			else if (type == "L")
+			{
+				row = m.add_row(name, ConstraintSense::LessEqual, 0.0);
+			}
+			else if (type == "G")
+			{
+				row = m.add_row(name, ConstraintSense::GreaterEqual, 0.0);
+			}
+			else if (type == "E")
+			{
+				row = m.add_row(name, ConstraintSense::Equal, 0.0);
+			}
+			else
+			{
+				error(fmt::format("unknown row type {}", type));
+			}
+			if (!row_map.emplace(name, row).second)
+			{
+				error(fmt::format("duplicate row {}", name));
+			}
+			break;
+		}
+		case Section::Columns: {
+			if (n_fields >= 3 && fields[1] == "'MARKER'")
+			{
+				if (fields[2] == "'INTORG'")
+				{
+					in_integer_block = true;
+				}
+				else if (fields[2] == "'INTEND'")
+				{
+					in_integer_block = false;
+				}
+				else
+				{
+					error("unknown marker");
+				}
+				break;
+			}
+			if (n_fields % 2 == 0)
+			{
+				error("a column and pairs of row and number are expected");
+			}
+			auto variable = m.variable(fields[0]);
+			if (in_integer_block)
+			{
+				m.variable_domains[variable] = VariableDomain::Integer;
+			}
+			for (size_t i = 1; i < n_fields; i += 2)
+			{
+				auto r = row(fields[i]);
+				auto coefficient = number(i + 1);
+				if (r == OBJECTIVE_ROW)
+				{
+					m.add_objective_term(variable, coefficient);
+				}
+				else if (r != FREE_ROW)
+				{
+					m.add_term(r, variable, coefficient);
+				}
+			}
+			break;
+		}
+		case Section::Rhs: {
+			// the name of the RHS vector is optional
+			size_t i = n_fields % 2;
+			for (; i + 1 < n_fields; i += 2)
+			{
+				auto r = row(fields[i]);
+				auto value = number(i + 1);
+				if (r == OBJECTIVE_ROW)
+				{
+					// the RHS of the objective row is the negative objective constant
+					m.objective_affine.constant = -value;
+				}
+				else if (r != FREE_ROW)
+				{
+					m.row_rhss[r] = value;
+				}
+			}
+			break;
+		}
+		case Section::Ranges:
+			error("RANGES are not supported");
+		case Section::Bounds:
+			read_bound();
+			break;
+		case Section::QuadObj:
+			// upper triangle of Q where the objective is x^T Q x / 2
+			add_quadratic_term(OBJECTIVE_ROW, 0, fields[0] == fields[1] ? 0.5 : 1.0);
+			break;
+		case Section::QMatrix:
+			// full symmetric Q where the objective is x^T Q x / 2
+			add_quadratic_term(OBJECTIVE_ROW, 0, 0.5);
+			break;
+		case Section::QCMatrix:
+			// full symmetric Q where the constraint is x^T Q x
+			add_quadratic_term(qc_row, 0, 1.0);
+			break;
+		case Section::SOS:
+			if (fields[0] == "S1" || fields[0] == "S2")
+			{
+				if (n_fields < 2 || fields[1] != "SOS")
+				{
+					error("S1 SOS or S2 SOS is expected");
+				}
+				m.sos_types.push_back(fields[0] == "S1" ? SOSType::SOS1 : SOSType::SOS2);
+				m.sos_names.push_back(n_fields >= 3 ? fields[2] : std::string_view{});
+				m.sos_starts.push_back(m.sos_starts.back());
+			}
+			else
+			{
+				if (m.sos_types.empty())
+				{
+					error("S1 SOS or S2 SOS is expected");
+				}
+				m.sos_variables.push_back(m.variable(fields[0]));
+				m.sos_weights.push_back(number(1));
+				m.sos_starts.back()++;
+			}
+			break;
+		}
+	}
+}
+
+void MPSReader::read_header()
+{
+	auto name = fields[0];
+	if (name == "NAME" || name == "OBJSENSE" || name == "OBJSENSE:")
+	{
+		section = name == "NAME" ? Section::None : Section::ObjSense;
+		// OBJSENSE MAX in one line
+		if (section == Section::ObjSense && n_fields >= 2 &&
+		    (fields[1] == "MAX" || fields[1] == "MAXIMIZE"))
+		{
+			m.objective_sense = ObjectiveSense::Maximize;
+		}
+	}
+	else if (name == "ROWS")
+	{
+		section = Section::Rows;
+	}
+	else if (name == "COLUMNS")
+	{
+		section = Section::Columns;
+	}
+	else if (name == "RHS")
+	{
+		section = Section::Rhs;
+	}
+	else if (name == "RANGES")
+	{
+		section = Section::Ranges;
+	}
+	else if (name == "BOUNDS")
+	{
+		section = Section::Bounds;
+	}
+	else if (name == "QUADOBJ")
+	{
+		section = Section::QuadObj;
+	}
+	else if (name == "QMATRIX")
+	{
+		section = Section::QMatrix;
+	}
+	else if (name == "QCMATRIX" || name == "QSECTION")
+	{
+		if (n_fields < 2)
+		{
+			error("the name of the row is expected");
+		}
+		qc_row = row(fields[1]);
+		if (qc_row < 0)
+		{
+			error("QCMATRIX of a free row");
+		}
+		section = Section::QCMatrix;
+	}
+	else if (name == "SOS")
+	{
+		section = Section::SOS;
+	}
+	else
+	{
+		error(fmt::format("unknown section {}", name));
+	}
+}
+
+void MPSReader::read_bound()
+{
+	if (n_fields < 2)
+	{
+		error("bound type and column are expected");
+	}
+	auto type = fields[0];
+	bool has_value = !(type == "FR" || type == "MI" || type == "PL" || type == "BV");
+	std::string_view column;
+	double value = 0.0;
+	if (!has_value)
+	{
+		// the name of the bound vector is optional
+		column = n_fields >= 3 ? fields[2] : fields[1];
+	}
+	else if (n_fields >= 4)
+	{
+		column = fields[2];
+		value = number(3);
+	}
+	else if (n_fields == 3)
+	{
+		if (type == "SC" && !parse_number(fields[2], value))
+		{
+			// SC without an upper bound
+			column = fields[2];
+			value = INF;
+		}
+		else
+		{
+			column = fields[1];
+			value = number(2);
+		}
+	}
+	else if (type == "SC")
+	{
+		column = fields[1];
+		value = INF;
+	}
+	else
+	{
+		error("a bound value is expected");
+	}
+
+	auto v = m.variable(column);
+	has_lb.resize(m.variable_names.size(), false);
+	auto &lb = m.variable_lbs[v];
+	auto &ub = m.variable_ubs[v];
+	auto &domain = m.variable_domains[v];
+	if (type == "UP")
+	{
+		ub = value;
+		if (value < 0.0 && lb == 0.0 && !has_lb[v])
+		{
+			lb = -INF;
+		}
+	}
+	else if (type == "LO")
+	{
+		lb = value;
+		has_lb[v] = true;
+	}
+	else if (type == "FX")
+	{
+		lb = value;
+		ub = value;
+		has_lb[v] = true;
+	}
+	else if (type == "FR")
+	{
+		lb = -INF;
+		ub = INF;
+		has_lb[v] = true;
+	}
+	else if (type == "MI")
+	{
+		lb = -INF;
+		has_lb[v] = true;
+	}
+	else if (type == "PL")
+	{
+		ub = INF;
+	}
+	else if (type == "BV")
+	{
+		domain = VariableDomain::Binary;
+		lb = 0.0;
+		ub = 1.0;
+	}
+	else if (type == "LI")
+	{
+		domain = VariableDomain::Integer;
+		lb = value;
+		has_lb[v] = true;
+	}
+	else if (type == "UI")
+	{
+		domain = VariableDomain::Integer;
+		ub = value;
+	}
+	else if (type == "SC")
+	{
+		domain = VariableDomain::SemiContinuous;
+		ub = value;
+	}
+	else
+	{
+		error(fmt::format("unknown bound type {}", type));
+	}
+}
+
+// CPLEX LP format
+class LPReader
+{
+  public:
+	LPReader(std::string_view buffer, ParsedModel &model) : buffer(buffer), m(model)
+	{
+	}
+
+	void read();
+
+  private:
+	enum class Section
+	{
+		None,
+		Objective,
+		Constraints,
+		Bounds,
+		General,
+		Binary,
+		SemiContinuous,
+		SOS,
+		End,
+	};
+
+	struct Token
+	{
+		enum Kind
+		{
+			Name,
+			Number,
+			Operator,
+			End,
+		};
+		Kind kind;
+		std::string_view text;
+		double value;
+		bool line_start;
+		size_t line;
+	};
+
+	// an affine expression with quadratic terms, the constant is on the left side
+	struct Expression
+	{
+		Vector<IndexT> variables;
+		Vector<CoeffT> coefficients;
+		Vector<IndexT> variable_1s;
+		Vector<IndexT> variable_2s;
+		Vector<CoeffT> quadratic_coefficients;
+		CoeffT constant = 0.0;
+	};
+
+	[[noreturn]] void error(std::string_view message) const
+	{
+		throw std::runtime_error(
+		    fmt::format("Invalid LP file at line {}: {}", peek().line, message));
+	}
+
+	void tokenize();
+
+	const Token &peek(size_t offset = 0) const
+	{
+		return tokens[std::min(i + offset, tokens.size() - 1)];
+	}
+
+	bool is_operator(size_t offset, std::string_view op) const
+	{
+		auto &token = peek(offset);
+		return token.kind == Token::Operator && token.text == op;
+	}
+
+	bool is_sense(size_t offset = 0) const
+	{
+		return is_operator(offset, "<=") || is_operator(offset, ">=") || is_operator(offset, "=");
+	}
+
+	bool is_infinity(const Token &token) const
+	{
+		return token.kind == Token::Name &&
+		       (iequals(token.text, "inf") || iequals(token.text, "infinity"));
+	}
+
+	// a section keyword at the start of a line, n_tokens is the length of the keyword
+	Section section_at(size_t &n_tokens) const;
+
+	bool at_section() const
+	{
+		size_t n_tokens;
+		return section_at(n_tokens) != Section::None;
+	}
+
+	void expect_operator(std::string_view op)
+	{
+		if (!is_operator(0, op))
+		{
+			error(fmt::format("{} is expected", op));
+		}
+		i++;
+	}
+
+	std::string_view expect_name()
+	{
+		if (peek().kind != Token::Name)
+		{
+			error("a name is expected");
+		}
+		return tokens[i++].text;
+	}
+
+	ConstraintSense expect_sense()
+	{
+		if (!is_sense())
+		{
+			error("<=, >= or = is expected");
+		}
+		auto text = tokens[i++].text;
+		if (text == "<=")
+		{
+			return ConstraintSense::LessEqual;
+		}
+		else if (text == ">=")
+		{
+			return ConstraintSense::GreaterEqual;
+		}
+		return ConstraintSense::Equal;
+	}
+
+	// a signed number or infinity
+	double expect_value()
+	{
+		double sign = 1.0;
+		while (is_operator(0, "+") || is_operator(0, "-"))
+		{
+			if (tokens[i].text == "-")
+			{
+				sign = -sign;
+			}
+			i++;
+		}
+		auto &token = peek();
+		if (token.kind == Token::Number)
+		{
+			i++;
+			return sign * token.value;
+		}
+		if (is_infinity(token))
+		{
+			i++;
+			return sign * INF;
+		}
+		error("a number is expected");
+	}
+
+	// a bound value starts with a sign, a number or infinity followed by a sense
+	bool at_value() const
+	{
+		auto &token = peek();
+		return (token.kind == Token::Operator && (token.text == "+" || token.text == "-")) ||
+		       token.kind == Token::Number || (is_infinity(token) && is_sense(1));
+	}
+
+	void parse_expression(Expression &expression);
+	void parse_quadratic(Expression &expression);
+	void parse_objective();
+	void parse_constraint();
+	void parse_bound();
+	void parse_sos();
+
+	std::string_view buffer;
+	ParsedModel &m;
+
+	Vector<Token> tokens;
+	size_t i = 0;
+};
+
+void LPReader::tokenize()
+{
+	constexpr std::string_view delimiters = "+-*^[]:<>=\\";
+	size_t line = 1;
+	bool line_start = true;
+	size_t p = 0;
+	const size_t n = buffer.size();
+	while (p < n)
+	{
+		char c = buffer[p];
+		if (c == '\n')
+		{
+			line++;
+			line_start = true;
+			p++;
+			continue;
+		}
+		if (std::isspace(static_cast<unsigned char>(c)))
+		{
+			p++;
+			continue;
+		}
+		if (c == '\\')
+		{
+			// comment until the end of line
+			while (p < n && buffer[p] != '\n')
+			{
+				p++;
+			}
+			continue;
+		}
+
+		Token token{Token::Operator, {}, 0.0, line_start, line};
+		line_start = false;
+		auto start = p;
+		if (c == '<' || c == '>' || c == '=')
+		{
+			// <, <=, =< are all <=, and >, >=, => are all >=
+			p++;
+			if (p < n && (buffer[p] == '=' || buffer[p] == '<' || buffer[p] == '>'))
+			{
+				p++;
+			}
+			auto text = buffer.substr(start, p - start);
+			if (text.find('<') != std::string_view::npos)
+			{
+				token.text = "<=";
+			}
+			else if (text.find('>') != std::string_view::npos)
+			{
+				token.text = ">=";
+			}
+			else
+			{
+				token.text = "=";
+			}
+		}
+		else if (c == '/' || delimiters.find(c) != std::string_view::npos)
+		{
+			p++;
+			token.text = buffer.substr(start, 1);
+		}
+		else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+		{
+			auto [ptr, ec] = std::from_chars(buffer.data() + p, buffer.data() + n, token.value);
+			if (ec != std::errc())
+			{
+				throw std::runtime_error(
+				    fmt::format("Invalid LP file at line {}: invalid number", line));
+			}
+			p = ptr - buffer.data();
+			token.kind = Token::Number;
+			token.text = buffer.substr(start, p - start);
+		}
+		else
+		{
+			while (p < n && !std::isspace(static_cast<unsigned char>(buffer[p])) &&
+			       delimiters.find(buffer[p]) == std::string_view::npos)
+			{
+				p++;
+			}
+			token.kind = Token::Name;
+			token.text = buffer.substr(start, p - start);
+		}
+		tokens.push_back(token);
+	}
+	tokens.push_back(Token{Token::End, {}, 0.0, true, line});
+}
+
+LPReader::Section LPReader::section_at(size_t &n_tokens) const
+{
+	auto &token = peek();
+	if (token.kind == Token::End)
+	{
+		n_tokens = 0;
+		return Section::End;
+	}
+	if (token.kind != Token::Name || !token.line_start)
+	{
+		return Section::None;
+	}
+	auto text = token.text;
+	n_tokens = 1;
+	if (iequals(text, "minimize") || iequals(text, "minimum") || iequals(text, "min") ||
+	    iequals(text, "maximize") || iequals(text, "maximum") || iequals(text, "max"))
+	{
+		return Section::Objective;
+	}
+	if ((iequals(text, "subject") && peek(1).kind == Token::Name && iequals(peek(1).text, "to")) ||
+	    (iequals(text, "such") && peek(1).kind == Token::Name && iequals(peek(1).text, "that")))
+	{
+		n_tokens = 2;
+		return Section::Constraints;
+	}
+	if (iequals(text, "st") || iequals(text, "s.t."))
+	{
+		return Section::Constraints;
+	}
+	if (iequals(text, "bounds") || iequals(text, "bound"))
+	{
+		return Section::Bounds;
+	}
+	if (iequals(text, "general") || iequals(text, "generals") || iequals(text, "gen"))
+	{
+		return Section::General;
+	}
+	if (iequals(text, "binary") || iequals(text, "binaries") || iequals(text, "bin"))
+	{
+		return Section::Binary;
+	}
+	if (iequals(text, "semi") && is_operator(1, "-") && peek(2).kind == Token::Name &&
+	    iequals(peek(2).text, "continuous"))
+	{
+		n_tokens = 3;
+		return Section::SemiContinuous;
+	}
+	if (iequals(text, "semi") || iequals(text, "semis"))
+	{
+		return Section::SemiContinuous;
+	}
+	if (iequals(text, "sos"))
+	{
+		return Section::SOS;
+	}
+	if (iequals(text, "end"))
+	{
+		return Section::End;
+	}
+	return Section::None;
+}
+
+void LPReader::read()
+{
+	tokenize();
+
+	size_t n_tokens;
+	auto section = section_at(n_tokens);
+	if (section != Section::Objective)
+	{
+		error("Minimize or Maximize is expected");
+	}
+	while (section != Section::End)
+	{
+		if (section == Section::None)
+		{
+			error("a section is expected");
+		}
+		if (section == Section::Objective)
+		{
+			auto text = tokens[i].text;
+			bool maximize = iequals(text.substr(0, 3), "max");
+			m.objective_sense = maximize ? ObjectiveSense::Maximize : ObjectiveSense::Minimize;
+		}
+		i += n_tokens;
+		while (!at_section())
+		{
+			switch (section)
+			{
+			case Section::Objective:
+				parse_objective();
+				break;
+			case Section::Constraints:
+				parse_constraint();
+				break;
+			case Section::Bounds:
+				parse_bound();
+				break;
+			case Section::General:
+				m.variable_domains[m.variable(expect_name())] = VariableDomain::Integer;
+				break;
+			case Section::Binary: {
+				auto v = m.variable(expect_name());
+				m.variable_domains[v] = VariableDomain::Binary;
+				m.variable_lbs[v] = 0.0;
+				m.variable_ubs[v] = 1.0;
+				break;
+			}
+			case Section::SemiContinuous:
+				m.variable_domains[m.variable(expect_name())] = VariableDomain::SemiContinuous;
+				break;
+			case Section::SOS:
+				parse_sos();
+				break;
+			default:
+				error("unexpected section");
+			}
+		}
+		section = section_at(n_tokens);
+	}
+}
+
+void LPReader::parse_expression(Expression &expression)
+{
+	while (!at_section() && !is_sense())
+	{
+		double sign = 1.0;
+		while (is_operator(0, "+") || is_operator(0, "-"))
+		{
+			if (tokens[i].text == "-")
+			{
+				sign = -sign;
+			}
+			i++;
+		}
+		if (is_operator(0, "["))
+		{
+			if (sign < 0.0)
+			{
+				error("- before [ is not supported");
+			}
+			parse_quadratic(expression);
+			continue;
+		}
+		double coefficient = 1.0;
+		bool has_coefficient = false;
+		if (peek().kind == Token::Number)
+		{
+			coefficient = tokens[i++].value;
+			has_coefficient = true;
+		}
+		if (peek().kind == Token::Name && !at_section())
+		{
+			expression.variables.push_back(m.variable(tokens[i++].text));
+			expression.coefficients.push_back(sign * coefficient);
+		}
+		else if (has_coefficient)
+		{
+			expression.constant += sign * coefficient;
+		}
+		else
+		{
+			error("a term is expected");
+		}
+	}
+}
+
+void LPReader::parse_quadratic(Expression &expression)
+{
+	expect_operator("[");
+	auto start = expression.quadratic_coefficients.size();
+	while (!is_operator(0, "]"))
+	{
+		double sign = 1.0;
+		while (is_operator(0, "+") || is_operator(0, "-"))
+		{
+			if (tokens[i].text == "-")
+			{
+				sign = -sign;
+			}
+			i++;
+		}
+		double coefficient = 1.0;
+		if (peek().kind == Token::Number)
+		{
+			coefficient = tokens[i++].value;
+		}
+		auto variable_1 = m.variable(expect_name());
+		IndexT variable_2;
+		if (is_operator(0, "^"))
+		{
+			i++;
+			if (peek().kind != Token::Number || peek().value != 2.0)
+			{
+				error("only ^ 2 is supported");
+			}
+			i++;
+			variable_2 = variable_1;
+		}
+		else
+		{
+			expect_operator("*");
+			variable_2 = m.variable(expect_name());
+		}
+		expression.variable_1s.push_back(variable_1);
+		expression.variable_2s.push_back(variable_2);
+		expression.quadratic_coefficients.push_back(sign * coefficient);
+	}
+	i++;
+	// [ ... ] / 2 in the objective
+	if (is_operator(0, "/"))
+	{
+		i++;
+		if (peek().kind != Token::Number)
+		{
+			error("a number is expected after /");
+		}
+		auto divisor = tokens[i++].value;
+		for (auto k = start; k < expression.quadratic_coefficients.size(); k++)
+		{
+			expression.quadratic_coefficients[k] /= divisor;
+		}
+	}
+}
+
+void LPReader::parse_objective()
+{
+	// the name of the objective is ignored
+	if (peek().kind == Token::Name && is_operator(1, ":"))
+	{
+		i += 2;
+	}
+	Expression expression;
+	parse_expression(expression);
+	if (is_sense())
+	{
+		error("unexpected sense in the objective");
+	}
+	for (size_t k = 0; k < expression.variables.size(); k++)
+	{
+		m.add_objective_term(expression.variables[k], expression.coefficients[k]);
+	}
+	for (size_t k = 0; k < expression.quadratic_coefficients.size(); k++)
+	{
+		m.add_objective_quadratic_term(expression.variable_1s[k], expression.variable_2s[k],
+		                               expression.quadratic_coefficients[k]);
+	}
+	if (expression.constant != 0.0)
+	{
+		m.objective_affine.constant = expression.constant;
+	}
+}
+
+void LPReader::parse_constraint()
+{
+	std::string_view name;
+	if (peek().kind == Token::Name && is_operator(1, ":"))
+	{
+		name = tokens[i].text;
+		i += 2;
+	}
+	Expression expression;
+	parse_expression(expression);
+	auto sense = expect_sense();
+	auto rhs = expect_value();
+	auto row = m.add_row(name, sense, rhs - expression.constant);
+	for (size_t k = 0; k < expression.variables.size(); k++)
+	{
+		m.add_term(row, expression.variables[k], expression.coefficients[k]);
+	}
+	for (size_t k = 0; k < expression.quadratic_coefficients.size(); k++)
+	{
+		m.add_quadratic_term(row, expression.variable_1s[k], expression.variable_2s[k],
+		                     expression.quadratic_coefficients[k]);
+	}
+}
+
+void LPReader::parse_bound()
+{
+	auto apply = [&](IndexT v, ConstraintSense sense, double value) {
+		if (sense != ConstraintSense::LessEqual)
+		{
+			m.variable_lbs[v] = value;
+		}
+		if (sense != ConstraintSense::GreaterEqual)
+		{
+			m.variable_ubs[v] = value;
+		}
+	};
+	auto flip = [](ConstraintSense sense) {
+		if (sense == ConstraintSense::LessEqual)
+		{
+			return ConstraintSense::GreaterEqual;
+		}
+		else if (sense == ConstraintSense::GreaterEqual)
+		{
+			return ConstraintSense::LessEqual;
+		}
+		return sense;
+	};
+
+	if (at_value())
+	{
+		// l <= x [<= u]
+		auto value = expect_value();
+		auto sense = expect_sense();
+		auto v = m.variable(expect_name());
+		apply(v, flip(sense), value);
+		if (is_sense())
+		{
+			sense = expect_sense();
+			apply(v, sense, expect_value());
+		}
+		return;
+	}
+
+	auto v = m.variable(expect_name());
+	if (peek().kind == Token::Name && iequals(peek().text, "free"))
+	{
+		i++;
+		m.variable_lbs[v] = -INF;
+		m.variable_ubs[v] = INF;
+		return;
+	}
+	auto sense = expect_sense();
+	apply(v, sense, expect_value());
+}
+
+void LPReader::parse_sos()
+{
+	auto is_sos_type = [&](size_t offset) {
+		auto &token = peek(offset);
+		return token.kind == Token::Name && (token.text == "S1" || token.text == "s1" ||
+		                                     token.text == "S2" || token.text == "s2");
+	};
+
+	std::string_view name;
+	if (peek().kind == Token::Name && is_operator(1, ":") && is_sos_type(2))
+	{
+		name = tokens[i].text;
+		i += 2;
+	}
+	if (!is_sos_type(0))
+	{
+		error("S1 or S2 is expected");
+	}
+	auto type = tokens[i++].text[1] == '1' ? SOSType::SOS1 : SOSType::SOS2;
+	expect_operator(":");
+	expect_operator(":");
+	m.sos_names.push_back(name);
+	m.sos_types.push_back(type);
+	while (!at_section() && peek().kind == Token::Name && is_operator(1, ":") &&
+	       peek(2).kind == Token::Number)
+	{
+		m.sos_variables.push_back(m.variable(tokens[i].text));
+		m.sos_weights.push_back(tokens[i + 2].value);
+		i += 3;
+	}
+	m.sos_starts.push_back(m.sos_variables.size());
+}
+} // namespace
+
+CacheModelFileHandles CacheModel::read(const std::string &filename)
+{
+	auto ends_with = [&](std::string_view suffix) {
+		return filename.size() >= suffix.size() &&
+		       filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	bool is_lp = ends_with(".lp");
+	bool is_mps = ends_with(".mps");
+	if (!is_lp && !is_mps)
+	{
+		throw std::runtime_error("Only .lp and .mps files are supported");
+	}
+
+	auto buffer = read_file(filename);
+	ParsedModel parsed;
+	if (is_lp)
+	{
+		LPReader(buffer, parsed).read();
+	}
+	else
+	{
+		MPSReader(buffer, parsed).read();
+	}
+
+	CacheModelFileHandles handles;
+	parsed.load(*this, handles);
+	return handles;
+}
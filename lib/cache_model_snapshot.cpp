@@ -0,0 +1,463 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "fmt/format.h"
+#include "pyoptinterface/cache_model.hpp"
+
+// Binary snapshot of CacheModel
+//
+// The file starts with a header:
+//   char[8] magic "POISNAP\0"
+//   uint32 version
+//   uint32 byte order mark 0x01020304, the arrays are written in the byte order of the writer
+// and is followed by the sections of variables, linear constraints, quadratic constraints, SOS
+// constraints, second order cone constraints and objective in the order of the members of
+// CacheModel. Every array is a uint64 length followed by its raw elements, enums are int32 and
+// bools are uint8. A list of strings is a string table: the uint64 offsets of the strings
+// (n + 1 elements) followed by the characters of all strings.
+//
+// The arrays are read directly into the vectors of CacheModel, so loading a snapshot is limited
+// by the I/O speed.
+namespace
+{
+constexpr char SNAPSHOT_MAGIC[8] = {'P', 'O', 'I', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(VariableDomain) == 4 && sizeof(ConstraintSense) == 4 &&
+                  sizeof(SOSType) == 4 && sizeof(ObjectiveSense) == 4,
+              "enums are written as int32");
+} // namespace
+
+class CacheModelSnapshot
+{
+  public:
+	static void save(const CacheModel &m, const std::string &filename);
+	static void load(CacheModel &m, const std::string &filename);
+
+  private:
+	class Writer
+	{
+	  public:
+		Writer(const std::string &filename) : file(filename, std::ios::binary)
+		{
+			if (!file)
+			{
+				throw std::runtime_error(fmt::format("Cannot open file {}", filename));
+			}
+		}
+
+		void raw(const void *data, std::size_t size)
+		{
+			file.write(static_cast<const char *>(data), size);
+		}
+
+		template <typename T>
+		void value(const T &v)
+		{
+			raw(&v, sizeof(T));
+		}
+
+		template <typename T>
+		void array(const Vector<T> &v)
+		{
+			value<std::uint64_t>(v.size());
+			raw(v.data(), v.size() * sizeof(T));
+		}
+
+		void array(const Vector<bool> &v)
+		{
+			Vector<std::uint8_t> bytes(v.begin(), v.end());
+			array(bytes);
+		}
+
+		void strings(const Vector<std::string> &v)
+		{
+			Vector<std::uint64_t> offsets(v.size() + 1, 0);
+			for (size_t i = 0; i < v.size(); i++)
+			{
+				offsets[i + 1] = offsets[i] + v[i].size();
+			}
+			array(offsets);
+			for (auto &s : v)
+			{
+				raw(s.data(), s.size());
+			}
+		}
+
+		// the active indices of an indexer with N indices
+		void active(const MonotoneIndexer<int> &indexer, std::size_t N)
+		{
+			Vector<std::uint8_t> flags(N);
+			for (size_t i = 0; i < N; i++)
+			{
+				flags[i] = indexer.has_index(i);
+			}
+			array(flags);
+		}
+
+		void close()
+		{
+			file.close();
+			if (!file)
+			{
+				throw std::runtime_error("Failed to write the snapshot");
+			}
+		}
+
+	  private:
+		std::ofstream file;
+	};
+
+	class Reader
+	{
+	  public:
+		Reader(const std::string &filename) : file(filename, std::ios::binary | std::ios::ate)
+		{
+			if (!file)
+			{
+				throw std::runtime_error(fmt::format("Cannot open file {}", filename));
+			}
+			file_size = file.tellg();
+			file.seekg(0);
+		}
+
+		// the lengths read from the file are checked against the rest of the file before any
+		// memory is allocated for them
+		void check_length(std::uint64_t n, std::size_t element_size)
+		{
+			std::uint64_t remaining = file_size - static_cast<std::uint64_t>(file.tellg());
+			if (n > remaining / element_size)
+			{
+				throw std::runtime_error(
+				    "The snapshot is corrupt: an array is longer than the file");
+			}
+		}
+
+		void raw(void *data, std::size_t size)
+		{
+			file.read(static_cast<char *>(data), size);
+			if (!file)
+			{
+				throw std::runtime_error("The snapshot is truncated");
+			}
+		}
+
+		template <typename T>
+		T value()
+		{
+			T v;
+			raw(&v, sizeof(T));
+			return v;
+		}
+
+		template <typename T>
+		void array(Vector<T> &v)
+		{
+			auto n = value<std::uint64_t>();
+			check_length(n, sizeof(T));
+			v.resize(n);
+			raw(v.data(), n * sizeof(T));
+		}
+
+		void array(Vector<bool> &v)
+		{
+			Vector<std::uint8_t> bytes;
+			array(bytes);
+			v.assign(bytes.begin(), bytes.end());
+		}
+
+		void strings(Vector<std::string> &v)
+		{
+			Vector<std::uint64_t> offsets;
+			array(offsets);
+			if (offsets.empty() || offsets[0] != 0 ||
+			    !std::is_sorted(offsets.begin(), offsets.end()))
+			{
+				throw std::runtime_error("Invalid string table in the snapshot");
+			}
+			check_length(offsets.back(), 1);
+			std::string buffer(offsets.back(), '\0');
+			raw(buffer.data(), buffer.size());
+			v.resize(offsets.size() - 1);
+			for (size_t i = 0; i + 1 < offsets.size(); i++)
+			{
+				v[i].assign(buffer, offsets[i], offsets[i + 1] - offsets[i]);
+			}
+		}
+
+		// rebuild an indexer from the active flags, returns the number of indices and the number
+		// of active indices
+		std::pair<std::size_t, std::size_t> active(MonotoneIndexer<int> &indexer)
+		{
+			Vector<std::uint8_t> flags;
+			array(flags);
+			std::size_t N = flags.size();
+			indexer.clear();
+			if (N == 0)
+			{
+				return {0, 0};
+			}
+			indexer.add_indices(N);
+			Vector<IndexT> inactive;
+			for (size_t i = 0; i < N; i++)
+			{
+				if (!flags[i])
+				{
+					inactive.push_back(i);
+				}
+			}
+			if (!inactive.empty())
+			{
+				indexer.delete_indices(inactive.data(), inactive.size());
+			}
+			return {N, N - inactive.size()};
+		}
+
+	  private:
+		std::ifstream file;
+		std::uint64_t file_size = 0;
+	};
+};
+
+void CacheModelSnapshot::save(const CacheModel &m, const std::string &filename)
+{
+	Writer w(filename);
+	w.raw(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	w.value(SNAPSHOT_VERSION);
+	w.value(SNAPSHOT_BYTE_ORDER);
+
+	const auto n_variables = m.m_variable_domains.size();
+	w.active(m.m_variable_index, n_variables);
+	w.array(m.m_variable_domains);
+	w.array(m.m_variable_lbs);
+	w.array(m.m_variable_ubs);
+	w.value<std::uint8_t>(m.m_has_variable_names);
+	w.strings(m.m_variable_names);
+
+	w.active(m.m_linear_constraint_index, m.m_linear_senses.size());
+	w.array(m.m_linear_row_starts);
+	w.array(m.m_linear_variables);
+	w.array(m.m_linear_coefficients);
+	w.array(m.m_linear_senses);
+	w.array(m.m_linear_rhss);
+	w.value<std::uint8_t>(m.m_has_linear_names);
+	w.strings(m.m_linear_names);
+
+	w.active(m.m_quadratic_constraint_index, m.m_quadratic_senses.size());
+	w.array(m.m_quadratic_starts);
+	w.array(m.m_quadratic_variable_1s);
+	w.array(m.m_quadratic_variable_2s);
+	w.array(m.m_quadratic_coefficients);
+	w.array(m.m_quadratic_affine_starts);
+	w.array(m.m_quadratic_affine_variables);
+	w.array(m.m_quadratic_affine_coefficients);
+	w.array(m.m_quadratic_senses);
+	w.array(m.m_quadratic_rhss);
+	w.strings(m.m_quadratic_names);
+
+	w.active(m.m_sos_constraint_index, m.m_sos_types.size());
+	w.array(m.m_sos_starts);
+	w.array(m.m_sos_variables);
+	w.array(m.m_sos_weights);
+	w.array(m.m_sos_types);
+
+	w.active(m.m_cone_constraint_index, m.m_cone_rotated.size());
+	w.array(m.m_cone_starts);
+	w.array(m.m_cone_variables);
+	w.array(m.m_cone_rotated);
+	w.strings(m.m_cone_names);
+
+	w.value(m.m_objective_sense);
+	w.value<std::uint8_t>(m.m_objective.has_value());
+	if (m.m_objective)
+	{
+		auto &f = m.m_objective.value();
+		w.array(f.variable_1s);
+		w.array(f.variable_2s);
+		w.array(f.coefficients);
+		w.value<std::uint8_t>(f.affine_part.has_value());
+		if (f.affine_part)
+		{
+			auto &affine = f.affine_part.value();
+			w.array(affine.variables);
+			w.array(affine.coefficients);
+			w.value<std::uint8_t>(affine.constant.has_value());
+			w.value(affine.constant.value_or(0.0));
+		}
+	}
+	w.close();
+}
+
+void CacheModelSnapshot::load(CacheModel &m, const std::string &filename)
+{
+	Reader r(filename);
+	char magic[sizeof(SNAPSHOT_MAGIC)];
+	r.raw(magic, sizeof(magic));
+	if (std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error(fmt::format("{} is not a model snapshot", filename));
+	}
+	auto version = r.value<std::uint32_t>();
+	if (version != SNAPSHOT_VERSION)
+	{
+		throw std::runtime_error(fmt::format("Unsupported snapshot version {}", version));
+	}
+	if (r.value<std::uint32_t>() != SNAPSHOT_BYTE_ORDER)
+	{
+		throw std::runtime_error("The snapshot was written with a different byte order");
+	}
+
+	// read into a new model so that m is unchanged if the snapshot is invalid
+	CacheModel model;
+	auto check_size = [](std::size_t size, std::size_t expected) {
+		if (size != expected)
+		{
+			throw std::runtime_error("Inconsistent number of elements in the snapshot");
+		}
+	};
+	// names are either empty or one per element
+	auto check_names = [&](const Vector<std::string> &names, std::size_t N) {
+		if (!names.empty())
+		{
+			check_size(names.size(), N);
+		}
+	};
+	// the starts of N blocks of the elements in an array of length n, they must not decrease so
+	// that every block lies inside the array
+	auto check_starts = [&](const Vector<IndexT> &starts, std::size_t N, std::size_t n) {
+		check_size(starts.size(), N + 1);
+		if (starts[0] != 0 || !std::is_sorted(starts.begin(), starts.end()) ||
+		    static_cast<std::size_t>(starts[N]) != n)
+		{
+			throw std::runtime_error("The snapshot is corrupt: invalid offsets");
+		}
+	};
+	auto check_variables = [&](const Vector<IndexT> &variables, std::size_t n_variables) {
+		for (auto v : variables)
+		{
+			if (v < 0 || static_cast<std::size_t>(v) >= n_variables)
+			{
+				throw std::runtime_error("Invalid variable in the snapshot");
+			}
+		}
+	};
+
+	auto [n_variables, n_active_variables] = r.active(model.m_variable_index);
+	model.m_n_variables = n_active_variables;
+	r.array(model.m_variable_domains);
+	r.array(model.m_variable_lbs);
+	r.array(model.m_variable_ubs);
+	model.m_has_variable_names = r.value<std::uint8_t>();
+	r.strings(model.m_variable_names);
+	check_size(model.m_variable_domains.size(), n_variables);
+	check_size(model.m_variable_lbs.size(), n_variables);
+	check_size(model.m_variable_ubs.size(), n_variables);
+	check_names(model.m_variable_names, n_variables);
+
+	auto [n_linear, n_active_linear] = r.active(model.m_linear_constraint_index);
+	model.m_n_linear_constraints = n_active_linear;
+	r.array(model.m_linear_row_starts);
+	r.array(model.m_linear_variables);
+	r.array(model.m_linear_coefficients);
+	r.array(model.m_linear_senses);
+	r.array(model.m_linear_rhss);
+	model.m_has_linear_names = r.value<std::uint8_t>();
+	r.strings(model.m_linear_names);
+	check_starts(model.m_linear_row_starts, n_linear, model.m_linear_variables.size());
+	check_size(model.m_linear_coefficients.size(), model.m_linear_variables.size());
+	check_size(model.m_linear_senses.size(), n_linear);
+	check_size(model.m_linear_rhss.size(), n_linear);
+	check_names(model.m_linear_names, n_linear);
+	check_variables(model.m_linear_variables, n_variables);
+
+	auto [n_quadratic, n_active_quadratic] = r.active(model.m_quadratic_constraint_index);
+	model.m_n_quadratic_constraints = n_active_quadratic;
+	r.array(model.m_quadratic_starts);
+	r.array(model.m_quadratic_variable_1s);
+	r.array(model.m_quadratic_variable_2s);
+	r.array(model.m_quadratic_coefficients);
+	r.array(model.m_quadratic_affine_starts);
+	r.array(model.m_quadratic_affine_variables);
+	r.array(model.m_quadratic_affine_coefficients);
+	r.array(model.m_quadratic_senses);
+	r.array(model.m_quadratic_rhss);
+	r.strings(model.m_quadratic_names);
+	check_starts(model.m_quadratic_starts, n_quadratic, model.m_quadratic_coefficients.size());
+	check_size(model.m_quadratic_variable_1s.size(), model.m_quadratic_coefficients.size());
+	check_size(model.m_quadratic_variable_2s.size(), model.m_quadratic_coefficients.size());
+	check_starts(model.m_quadratic_affine_starts, n_quadratic,
+	             model.m_quadratic_affine_variables.size());
+	check_size(model.m_quadratic_affine_coefficients.size(),
+	           model.m_quadratic_affine_variables.size());
+	check_size(model.m_quadratic_senses.size(), n_quadratic);
+	check_size(model.m_quadratic_rhss.size(), n_quadratic);
+	check_size(model.m_quadratic_names.size(), n_quadratic);
+	check_variables(model.m_quadratic_variable_1s, n_variables);
+	check_variables(model.m_quadratic_variable_2s, n_variables);
+	check_variables(model.m_quadratic_affine_variables, n_variables);
+
+	auto [n_sos, n_active_sos] = r.active(model.m_sos_constraint_index);
+	model.m_n_sos_constraints = n_active_sos;
+	r.array(model.m_sos_starts);
+	r.array(model.m_sos_variables);
+	r.array(model.m_sos_weights);
+	r.array(model.m_sos_types);
+	check_starts(model.m_sos_starts, n_sos, model.m_sos_variables.size());
+	check_size(model.m_sos_weights.size(), model.m_sos_variables.size());
+	check_size(model.m_sos_types.size(), n_sos);
+	check_variables(model.m_sos_variables, n_variables);
+
+	auto [n_cone, n_active_cone] = r.active(model.m_cone_constraint_index);
+	model.m_n_cone_constraints = n_active_cone;
+	r.array(model.m_cone_starts);
+	r.array(model.m_cone_variables);
+	r.array(model.m_cone_rotated);
+	r.strings(model.m_cone_names);
+	check_starts(model.m_cone_starts, n_cone, model.m_cone_variables.size());
+	check_size(model.m_cone_rotated.size(), n_cone);
+	check_size(model.m_cone_names.size(), n_cone);
+	check_variables(model.m_cone_variables, n_variables);
+
+	model.m_objective_sense = r.value<ObjectiveSense>();
+	if (r.value<std::uint8_t>())
+	{
+		ScalarQuadraticFunction f;
+		r.array(f.variable_1s);
+		r.array(f.variable_2s);
+		r.array(f.coefficients);
+		check_size(f.variable_1s.size(), f.coefficients.size());
+		check_size(f.variable_2s.size(), f.coefficients.size());
+		check_variables(f.variable_1s, n_variables);
+		check_variables(f.variable_2s, n_variables);
+		if (r.value<std::uint8_t>())
+		{
+			ScalarAffineFunction affine;
+			r.array(affine.variables);
+			r.array(affine.coefficients);
+			check_size(affine.coefficients.size(), affine.variables.size());
+			check_variables(affine.variables, n_variables);
+			bool has_constant = r.value<std::uint8_t>();
+			auto constant = r.value<CoeffT>();
+			if (has_constant)
+			{
+				affine.constant = constant;
+			}
+			f.affine_part = affine;
+		}
+		model.m_objective = f;
+	}
+
+	m = std::move(model);
+}
+
+void CacheModel::save_snapshot(const std::string &filename) const
+{
+	CacheModelSnapshot::save(*this, filename);
+}
+
+void CacheModel::load_snapshot(const std::string &filename)
+{
+	CacheModelSnapshot::load(*this, filename);
+}
@@ -0,0 +1,1001 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+
+#include "fmt/format.h"
+#include "fmt/os.h"
+#include "pyoptinterface/cache_model.hpp"
+#include "pyoptinterface/thread_pool.hpp"
+
+// Writes CacheModel as CPLEX LP or free MPS file
+// The output goes through fmt::ostream, which formats into a large buffer and writes it to the
+// file in chunks. Deleted variables and constraints are skipped, as well as the terms of deleted
+// variables.
+// The rows of LP files and the columns of MPS files are formatted in blocks, every thread of the
+// pool formats a range of the block into its own buffer and the buffers are written in order.
+class CacheModelWriter
+{
+  public:
+	CacheModelWriter(const CacheModel &model, fmt::ostream &out, ThreadPool *thread_pool)
+	    : m(model), out(out), m_thread_pool(thread_pool)
+	{
+		assign_names();
+		assign_lower_bounds();
+	}
+
+	void write_lp();
+	void write_mps();
+
+  private:
+	// one entry of a quadratic matrix
+	using QuadraticEntry = std::tuple<IndexT, IndexT, CoeffT>;
+
+	// a row of the MPS file
+	struct Row
+	{
+		ConstraintType type;
+		IndexT index;
+	};
+
+	bool is_active(IndexT v) const
+	{
+		return m_active[v];
+	}
+
+	// Unnamed items are named as prefix + index, "_" is appended while the name is used by
+	// another item, so the names in the file are unique as long as the given names are
+	static void assign_fallback_names(std::vector<std::string> &names,
+	                                  const std::vector<bool> &active, const char *prefix,
+	                                  Hashset<std::string> &used_names)
+	{
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			if (!active[i] || !names[i].empty())
+			{
+				continue;
+			}
+			auto name = fmt::format("{}{}", prefix, i);
+			while (used_names.contains(name))
+			{
+				name += '_';
+			}
+			used_names.insert(name);
+			names[i] = std::move(name);
+		}
+	}
+
+	// A name can be written if it is a single token for both formats: it does not start with a
+	// digit or '.', has no spaces or operators and is not a keyword of LP files
+	static bool is_valid_name(std::string_view name)
+	{
+		if (name.empty() || name.size() > 255)
+		{
+			return false;
+		}
+		if (std::isdigit(static_cast<unsigned char>(name[0])) || name[0] == '.')
+		{
+			return false;
+		}
+		constexpr std::string_view symbols = "_.!#$%&(),;?@{}|~";
+		for (char c : name)
+		{
+			if (!std::isalnum(static_cast<unsigned char>(c)) &&
+			    symbols.find(c) == std::string_view::npos)
+			{
+				return false;
+			}
+		}
+		constexpr std::string_view keywords[] = {
+		    "min", "minimum", "minimize", "max", "maximum", "maximize", "subject", "such", "st",
+		    "s.t.", "bound", "bounds", "gen", "general", "generals", "bin", "binary", "binaries",
+		    "semi", "semis", "sos", "end", "free", "inf", "infinity"};
+		auto equals_lower = [](char a, char b) {
+			return std::tolower(static_cast<unsigned char>(a)) == b;
+		};
+		for (auto keyword : keywords)
+		{
+			if (std::equal(name.begin(), name.end(), keyword.begin(), keyword.end(), equals_lower))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// copy the given names of the active items and collect them into used_names, the names that
+	// cannot be written are replaced by fallback names
+	template <typename Indexer>
+	static void collect_names(std::vector<std::string> &names, std::vector<bool> &active,
+	                          size_t N, const Vector<std::string> *given_names,
+	                          const Indexer &indexer, Hashset<std::string> &used_names)
+	{
+		names.assign(N, std::string());
+		active.resize(N);
+		for (size_t i = 0; i < N; i++)
+		{
+			active[i] = indexer.has_index(i);
+			if (active[i] && given_names && is_valid_name((*given_names)[i]))
+			{
+				names[i] = (*given_names)[i];
+				used_names.insert(names[i]);
+			}
+		}
+	}
+
+	void assign_names()
+	{
+		const size_t n_variables = m.m_variable_domains.size();
+		Hashset<std::string> used_variable_names;
+		collect_names(m_variable_names, m_active, n_variables,
+		              m.m_has_variable_names ? &m.m_variable_names : nullptr, m.m_variable_index,
+		              used_variable_names);
+		assign_fallback_names(m_variable_names, m_active, "x", used_variable_names);
+
+		// all kinds of rows share one namespace in the file
+		Hashset<std::string> used_row_names;
+		std::vector<bool> active_linear, active_quadratic, active_cone, active_sos;
+		collect_names(m_linear_names, active_linear, m.m_linear_senses.size(),
+		              m.m_has_linear_names ? &m.m_linear_names : nullptr,
+		              m.m_linear_constraint_index, used_row_names);
+		collect_names(m_quadratic_names, active_quadratic, m.m_quadratic_senses.size(),
+		              &m.m_quadratic_names, m.m_quadratic_constraint_index, used_row_names);
+		collect_names(m_cone_names, active_cone, m.m_cone_rotated.size(), &m.m_cone_names,
+		              m.m_cone_constraint_index, used_row_names);
+		collect_names(m_sos_names, active_sos, m.m_sos_types.size(), nullptr,
+		              m.m_sos_constraint_index, used_row_names);
+		assign_fallback_names(m_linear_names, active_linear, "c", used_row_names);
+		assign_fallback_names(m_quadratic_names, active_quadratic, "q", used_row_names);
+		assign_fallback_names(m_cone_names, active_cone, "soc", used_row_names);
+		assign_fallback_names(m_sos_names, active_sos, "sos", used_row_names);
+	}
+
+	// The cones are written as x^T x - t^2 <= 0 or x^T x - 2 t1 t2 <= 0, which equal the cones
+	// only if t, t1 and t2 are nonnegative, so their negative lower bounds are raised to 0
+	void assign_lower_bounds()
+	{
+		m_variable_lbs.assign(m.m_variable_lbs.begin(), m.m_variable_lbs.end());
+		const IndexT n_cone = m.m_cone_rotated.size();
+		for (IndexT i = 0; i < n_cone; i++)
+		{
+			if (!m.m_cone_constraint_index.has_index(i))
+			{
+				continue;
+			}
+			auto start = m.m_cone_starts[i];
+			auto end = std::min(m.m_cone_starts[i + 1], start + (m.m_cone_rotated[i] ? 2 : 1));
+			for (IndexT k = start; k < end; k++)
+			{
+				auto &lb = m_variable_lbs[m.m_cone_variables[k]];
+				lb = std::max(lb, 0.0);
+			}
+		}
+	}
+
+	const std::string &variable_name(IndexT v) const
+	{
+		return m_variable_names[v];
+	}
+
+	const std::string &constraint_name(ConstraintType type, IndexT i) const
+	{
+		switch (type)
+		{
+		case ConstraintType::Linear:
+			return m_linear_names[i];
+		case ConstraintType::Quadratic:
+			return m_quadratic_names[i];
+		case ConstraintType::Cone:
+			return m_cone_names[i];
+		case ConstraintType::SOS:
+			return m_sos_names[i];
+		default:
+			throw std::runtime_error("Unknown constraint type");
+		}
+	}
+
+	template <typename... Args>
+	static void print(fmt::memory_buffer &buffer, fmt::format_string<Args...> format,
+	                  Args &&...args)
+	{
+		fmt::format_to(std::back_inserter(buffer), format, std::forward<Args>(args)...);
+	}
+
+	void write_buffer(const fmt::memory_buffer &buffer)
+	{
+		out.print("{}", std::string_view(buffer.data(), buffer.size()));
+	}
+
+	// Formats items [0, n) by write_item(buffer, i) and writes them in order
+	template <typename F>
+	void write_items(IndexT n, const F &write_item)
+	{
+		const size_t n_threads = m_thread_pool ? m_thread_pool->size() : 1;
+		std::vector<fmt::memory_buffer> buffers(n_threads);
+		const IndexT block_size = ITEMS_PER_THREAD * n_threads;
+		for (IndexT block_start = 0; block_start < n; block_start += block_size)
+		{
+			IndexT n_block = std::min(block_size, n - block_start);
+			auto format_range = [&](size_t t) {
+				auto &buffer = buffers[t];
+				buffer.clear();
+				IndexT start = block_start + n_block * t / n_threads;
+				IndexT end = block_start + n_block * (t + 1) / n_threads;
+				for (IndexT i = start; i < end; i++)
+				{
+					write_item(buffer, i);
+				}
+			};
+			if (n_threads == 1)
+			{
+				format_range(0);
+			}
+			else
+			{
+				m_thread_pool->run(format_range);
+			}
+			for (auto &buffer : buffers)
+			{
+				write_buffer(buffer);
+			}
+		}
+	}
+
+	static const char *lp_sense(ConstraintSense sense)
+	{
+		switch (sense)
+		{
+		case ConstraintSense::LessEqual:
+			return "<=";
+		case ConstraintSense::GreaterEqual:
+			return ">=";
+		case ConstraintSense::Equal:
+			return "=";
+		default:
+			throw std::runtime_error("Only <=, >= and = constraints can be written");
+		}
+	}
+
+	static const char *mps_sense(ConstraintSense sense)
+	{
+		switch (sense)
+		{
+		case ConstraintSense::LessEqual:
+			return "L";
+		case ConstraintSense::GreaterEqual:
+			return "G";
+		case ConstraintSense::Equal:
+			return "E";
+		default:
+			throw std::runtime_error("Only <=, >= and = constraints can be written");
+		}
+	}
+
+	static void write_lp_coefficient(fmt::memory_buffer &buffer, CoeffT coef)
+	{
+		if (coef < 0.0)
+		{
+			print(buffer, " - {}", -coef);
+		}
+		else
+		{
+			print(buffer, " + {}", coef);
+		}
+	}
+
+	// returns the number of terms written
+	size_t write_lp_affine(fmt::memory_buffer &buffer, std::span<const IndexT> variables,
+	                       std::span<const CoeffT> coefficients) const
+	{
+		size_t n = 0;
+		for (size_t i = 0; i < variables.size(); i++)
+		{
+			auto v = variables[i];
+			if (!is_active(v))
+			{
+				continue;
+			}
+			write_lp_coefficient(buffer, coefficients[i]);
+			print(buffer, " {}", variable_name(v));
+			n++;
+		}
+		return n;
+	}
+
+	// returns the number of terms written
+	size_t write_lp_quadratic(fmt::memory_buffer &buffer,
+	                          const std::vector<QuadraticEntry> &entries) const
+	{
+		if (entries.empty())
+		{
+			return 0;
+		}
+		print(buffer, " + [");
+		for (auto &[v1, v2, coef] : entries)
+		{
+			write_lp_coefficient(buffer, coef);
+			if (v1 == v2)
+			{
+				print(buffer, " {} ^ 2", variable_name(v1));
+			}
+			else
+			{
+				print(buffer, " {} * {}", variable_name(v1), variable_name(v2));
+			}
+		}
+		print(buffer, " ]");
+		return entries.size();
+	}
+
+	// LP files need at least one term in every constraint
+	void write_lp_empty_row(fmt::memory_buffer &buffer) const
+	{
+		auto it = std::find(m_active.begin(), m_active.end(), true);
+		if (it == m_active.end())
+		{
+			throw std::runtime_error("Cannot write an empty row of a model without variables");
+		}
+		print(buffer, " 0 {}", variable_name(it - m_active.begin()));
+	}
+
+	// collect the terms between active variables, v1 <= v2 and the same pairs are merged
+	std::vector<QuadraticEntry> collect_quadratic(std::span<const IndexT> variable_1s,
+	                                              std::span<const IndexT> variable_2s,
+	                                              std::span<const CoeffT> coefficients) const
+	{
+		std::vector<QuadraticEntry> entries;
+		entries.reserve(coefficients.size());
+		for (size_t i = 0; i < coefficients.size(); i++)
+		{
+			auto v1 = variable_1s[i];
+			auto v2 = variable_2s[i];
+			if (!is_active(v1) || !is_active(v2))
+			{
+				continue;
+			}
+			if (v1 > v2)
+			{
+				std::swap(v1, v2);
+			}
+			entries.emplace_back(v1, v2, coefficients[i]);
+		}
+		std::sort(entries.begin(), entries.end());
+		size_t n = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (n > 0 && std::get<0>(entries[n - 1]) == std::get<0>(entries[i]) &&
+			    std::get<1>(entries[n - 1]) == std::get<1>(entries[i]))
+			{
+				std::get<2>(entries[n - 1]) += std::get<2>(entries[i]);
+			}
+			else
+			{
+				entries[n++] = entries[i];
+			}
+		}
+		entries.resize(n);
+		return entries;
+	}
+
+	// the quadratic part of a second order cone constraint in the form of x^T Q x <= 0
+	std::vector<QuadraticEntry> cone_quadratic(IndexT i) const
+	{
+		auto start = m.m_cone_starts[i];
+		auto end = m.m_cone_starts[i + 1];
+		std::vector<QuadraticEntry> entries;
+		IndexT first_x = start + 1;
+		if (m.m_cone_rotated[i])
+		{
+			// 2 * t1 * t2 >= sum x_i^2
+			auto t1 = m.m_cone_variables[start];
+			auto t2 = m.m_cone_variables[start + 1];
+			entries.emplace_back(std::min(t1, t2), std::max(t1, t2), -2.0);
+			first_x = start + 2;
+		}
+		else
+		{
+			// t^2 >= sum x_i^2
+			auto t = m.m_cone_variables[start];
+			entries.emplace_back(t, t, -1.0);
+		}
+		for (IndexT k = first_x; k < end; k++)
+		{
+			auto v = m.m_cone_variables[k];
+			entries.emplace_back(v, v, 1.0);
+		}
+		std::vector<IndexT> v1s, v2s;
+		std::vector<CoeffT> coefs;
+		for (auto &[v1, v2, coef] : entries)
+		{
+			v1s.push_back(v1);
+			v2s.push_back(v2);
+			coefs.push_back(coef);
+		}
+		return collect_quadratic(v1s, v2s, coefs);
+	}
+
+	std::vector<QuadraticEntry> quadratic_constraint_quadratic(IndexT i) const
+	{
+		auto start = m.m_quadratic_starts[i];
+		auto n = m.m_quadratic_starts[i + 1] - start;
+		return collect_quadratic(std::span(m.m_quadratic_variable_1s).subspan(start, n),
+		                         std::span(m.m_quadratic_variable_2s).subspan(start, n),
+		                         std::span(m.m_quadratic_coefficients).subspan(start, n));
+	}
+
+	std::vector<QuadraticEntry> objective_quadratic() const
+	{
+		if (!m.m_objective)
+		{
+			return {};
+		}
+		auto &f = m.m_objective.value();
+		return collect_quadratic(f.variable_1s, f.variable_2s, f.coefficients);
+	}
+
+	static void write_mps_column_entry(fmt::memory_buffer &buffer, const std::string &column,
+	                                   std::string_view row, CoeffT coef)
+	{
+		print(buffer, "    {} {} {}\n", column, row, coef);
+	}
+
+	void write_mps_quadratic_matrix(const std::vector<QuadraticEntry> &entries, bool upper,
+	                                double diagonal_scale, double offdiagonal_scale)
+	{
+		for (auto &[v1, v2, coef] : entries)
+		{
+			if (v1 == v2)
+			{
+				out.print("    {} {} {}\n", variable_name(v1), variable_name(v2),
+				          diagonal_scale * coef);
+			}
+			else
+			{
+				out.print("    {} {} {}\n", variable_name(v1), variable_name(v2),
+				          offdiagonal_scale * coef);
+				if (!upper)
+				{
+					out.print("    {} {} {}\n", variable_name(v2), variable_name(v1),
+					          offdiagonal_scale * coef);
+				}
+			}
+		}
+	}
+
+	// a thread formats at least this many items of a block
+	static constexpr IndexT ITEMS_PER_THREAD = 4096;
+
+	const CacheModel &m;
+	fmt::ostream &out;
+	ThreadPool *m_thread_pool;
+	std::vector<bool> m_active;
+	std::vector<double> m_variable_lbs;
+	std::vector<std::string> m_variable_names;
+	std::vector<std::string> m_linear_names, m_quadratic_names, m_cone_names, m_sos_names;
+};
+
+void CacheModelWriter::write_lp()
+{
+	out.print("\\ Problem written by PyOptInterface\n");
+	out.print("{}\n",
+	          m.m_objective_sense == ObjectiveSense::Minimize ? "Minimize" : "Maximize");
+	// an objective without terms is written as an empty expression
+	fmt::memory_buffer objective;
+	print(objective, " obj:");
+	if (m.m_objective)
+	{
+		auto &f = m.m_objective.value();
+		double objective_constant = 0.0;
+		if (f.affine_part)
+		{
+			auto &affine = f.affine_part.value();
+			write_lp_affine(objective, affine.variables, affine.coefficients);
+			objective_constant = affine.constant.value_or(0.0);
+		}
+		// LP files use [ x^T Q x ] / 2 in the objective
+		auto entries = objective_quadratic();
+		for (auto &entry : entries)
+		{
+			std::get<2>(entry) *= 2.0;
+		}
+		if (!entries.empty())
+		{
+			write_lp_quadratic(objective, entries);
+			print(objective, " / 2");
+		}
+		if (objective_constant != 0.0)
+		{
+			write_lp_coefficient(objective, objective_constant);
+		}
+	}
+	print(objective, "\n");
+	write_buffer(objective);
+
+	out.print("Subject To\n");
+	const IndexT n_linear = m.m_linear_senses.size();
+	write_items(n_linear, [&](fmt::memory_buffer &buffer, IndexT i) {
+		if (!m.m_linear_constraint_index.has_index(i))
+		{
+			return;
+		}
+		print(buffer, " {}:", constraint_name(ConstraintType::Linear, i));
+		auto start = m.m_linear_row_starts[i];
+		auto n = m.m_linear_row_starts[i + 1] - start;
+		auto n_terms =
+		    write_lp_affine(buffer, std::span(m.m_linear_variables).subspan(start, n),
+		                    std::span(m.m_linear_coefficients).subspan(start, n));
+		if (n_terms == 0)
+		{
+			write_lp_empty_row(buffer);
+		}
+		print(buffer, " {} {}\n", lp_sense(m.m_linear_senses[i]), m.m_linear_rhss[i]);
+	});
+
+	const IndexT n_quadratic = m.m_quadratic_senses.size();
+	write_items(n_quadratic, [&](fmt::memory_buffer &buffer, IndexT i) {
+		if (!m.m_quadratic_constraint_index.has_index(i))
+		{
+			return;
+		}
+		print(buffer, " {}:", constraint_name(ConstraintType::Quadratic, i));
+		auto start = m.m_quadratic_affine_starts[i];
+		auto n = m.m_quadratic_affine_starts[i + 1] - start;
+		auto n_terms =
+		    write_lp_affine(buffer, std::span(m.m_quadratic_affine_variables).subspan(start, n),
+		                    std::span(m.m_quadratic_affine_coefficients).subspan(start, n));
+		n_terms += write_lp_quadratic(buffer, quadratic_constraint_quadratic(i));
+		if (n_terms == 0)
+		{
+			write_lp_empty_row(buffer);
+		}
+		print(buffer, " {} {}\n", lp_sense(m.m_quadratic_senses[i]), m.m_quadratic_rhss[i]);
+	});
+
+	// second order cones are written as quadratic constraints, their t are nonnegative in Bounds
+	const IndexT n_cone = m.m_cone_rotated.size();
+	write_items(n_cone, [&](fmt::memory_buffer &buffer, IndexT i) {
+		if (!m.m_cone_constraint_index.has_index(i))
+		{
+			return;
+		}
+		print(buffer, " {}:", constraint_name(ConstraintType::Cone, i));
+		if (write_lp_quadratic(buffer, cone_quadratic(i)) == 0)
+		{
+			write_lp_empty_row(buffer);
+		}
+		print(buffer, " <= 0\n");
+	});
+
+	const IndexT n_variables = m.m_variable_domains.size();
+	out.print("Bounds\n");
+	for (IndexT v = 0; v < n_variables; v++)
+	{
+		if (!is_active(v))
+		{
+			continue;
+		}
+		auto domain = m.m_variable_domains[v];
+		if (domain == VariableDomain::Binary)
+		{
+			continue;
+		}
+		auto lb = m_variable_lbs[v];
+		auto ub = m.m_variable_ubs[v];
+		auto &name = variable_name(v);
+		bool lb_inf = std::isinf(lb);
+		bool ub_inf = std::isinf(ub);
+		if (lb_inf && ub_inf)
+		{
+			out.print(" {} free\n", name);
+		}
+		else if (lb == ub)
+		{
+			out.print(" {} = {}\n", name, lb);
+		}
+		else if (lb_inf)
+		{
+			out.print(" -inf <= {} <= {}\n", name, ub);
+		}
+		else if (ub_inf)
+		{
+			// [0, +inf) is the default bound
+			if (lb != 0.0)
+			{
+				out.print(" {} >= {}\n", name, lb);
+			}
+		}
+		else
+		{
+			out.print(" {} <= {} <= {}\n", lb, name, ub);
+		}
+	}
+
+	auto write_lp_domain = [&](VariableDomain domain, const char *section) {
+		bool has_section = false;
+		size_t n_in_line = 0;
+		for (IndexT v = 0; v < n_variables; v++)
+		{
+			if (!is_active(v) || m.m_variable_domains[v] != domain)
+			{
+				continue;
+			}
+			if (!has_section)
+			{
+				out.print("{}\n", section);
+				has_section = true;
+			}
+			out.print(" {}", variable_name(v));
+			if (++n_in_line == 16)
+			{
+				out.print("\n");
+				n_in_line = 0;
+			}
+		}
+		if (n_in_line > 0)
+		{
+			out.print("\n");
+		}
+	};
+	write_lp_domain(VariableDomain::Integer, "General");
+	write_lp_domain(VariableDomain::Binary, "Binary");
+	write_lp_domain(VariableDomain::SemiContinuous, "Semi-Continuous");
+
+	const IndexT n_sos = m.m_sos_types.size();
+	bool has_sos = false;
+	for (IndexT i = 0; i < n_sos; i++)
+	{
+		if (!m.m_sos_constraint_index.has_index(i))
+		{
+			continue;
+		}
+		if (!has_sos)
+		{
+			out.print("SOS\n");
+			has_sos = true;
+		}
+		out.print(" {}: {}::", constraint_name(ConstraintType::SOS, i),
+		          m.m_sos_types[i] == SOSType::SOS1 ? "S1" : "S2");
+		for (IndexT k = m.m_sos_starts[i]; k < m.m_sos_starts[i + 1]; k++)
+		{
+			auto v = m.m_sos_variables[k];
+			if (is_active(v))
+			{
+				out.print(" {}:{}", variable_name(v), m.m_sos_weights[k]);
+			}
+		}
+		out.print("\n");
+	}
+
+	out.print("End\n");
+}
+
+void CacheModelWriter::write_mps()
+{
+	const IndexT n_variables = m.m_variable_domains.size();
+	const IndexT n_linear = m.m_linear_senses.size();
+	const IndexT n_quadratic = m.m_quadratic_senses.size();
+	const IndexT n_cone = m.m_cone_rotated.size();
+
+	out.print("NAME PyOptInterface\n");
+	if (m.m_objective_sense == ObjectiveSense::Maximize)
+	{
+		out.print("OBJSENSE\n    MAX\n");
+	}
+
+	out.print("ROWS\n N  obj\n");
+	std::vector<Row> rows;
+	for (IndexT i = 0; i < n_linear; i++)
+	{
+		if (m.m_linear_constraint_index.has_index(i))
+		{
+			rows.push_back({ConstraintType::Linear, i});
+			out.print(" {}  {}\n", mps_sense(m.m_linear_senses[i]),
+			          constraint_name(ConstraintType::Linear, i));
+		}
+	}
+	for (IndexT i = 0; i < n_quadratic; i++)
+	{
+		if (m.m_quadratic_constraint_index.has_index(i))
+		{
+			rows.push_back({ConstraintType::Quadratic, i});
+			out.print(" {}  {}\n", mps_sense(m.m_quadratic_senses[i]),
+			          constraint_name(ConstraintType::Quadratic, i));
+		}
+	}
+	for (IndexT i = 0; i < n_cone; i++)
+	{
+		if (m.m_cone_constraint_index.has_index(i))
+		{
+			rows.push_back({ConstraintType::Cone, i});
+			out.print(" L  {}\n", constraint_name(ConstraintType::Cone, i));
+		}
+	}
+
+	// transpose the linear parts of rows to columns
+	// rows[0, n_rows) are the constraints and row n_rows is the objective
+	const IndexT n_rows = rows.size();
+	std::vector<IndexT> column_starts(n_variables + 1, 0);
+	auto for_each_term = [&](auto &&f) {
+		for (IndexT r = 0; r < n_rows; r++)
+		{
+			auto [type, i] = rows[r];
+			if (type == ConstraintType::Linear)
+			{
+				for (IndexT k = m.m_linear_row_starts[i]; k < m.m_linear_row_starts[i + 1]; k++)
+				{
+					f(r, m.m_linear_variables[k], m.m_linear_coefficients[k]);
+				}
+			}
+			else if (type == ConstraintType::Quadratic)
+			{
+				for (IndexT k = m.m_quadratic_affine_starts[i];
+				     k < m.m_quadratic_affine_starts[i + 1]; k++)
+				{
+					f(r, m.m_quadratic_affine_variables[k], m.m_quadratic_affine_coefficients[k]);
+				}
+			}
+		}
+		if (m.m_objective && m.m_objective->affine_part)
+		{
+			auto &affine = m.m_objective->affine_part.value();
+			for (size_t k = 0; k < affine.variables.size(); k++)
+			{
+				f(n_rows, affine.variables[k], affine.coefficients[k]);
+			}
+		}
+	};
+	for_each_term([&](IndexT, IndexT v, CoeffT) {
+		if (is_active(v))
+		{
+			column_starts[v + 1]++;
+		}
+	});
+	for (IndexT v = 0; v < n_variables; v++)
+	{
+		column_starts[v + 1] += column_starts[v];
+	}
+	std::vector<IndexT> column_rows(column_starts[n_variables]);
+	std::vector<CoeffT> column_coefficients(column_starts[n_variables]);
+	{
+		std::vector<IndexT> position(column_starts.begin(), column_starts.end() - 1);
+		for_each_term([&](IndexT r, IndexT v, CoeffT coef) {
+			if (is_active(v))
+			{
+				auto p = position[v]++;
+				column_rows[p] = r;
+				column_coefficients[p] = coef;
+			}
+		});
+	}
+
+	std::vector<std::string> row_names(n_rows + 1);
+	for (IndexT r = 0; r < n_rows; r++)
+	{
+		row_names[r] = constraint_name(rows[r].type, rows[r].index);
+	}
+	row_names[n_rows] = "obj";
+
+	// the integer markers depend on the previous active column, so they are decided beforehand
+	enum : std::uint8_t
+	{
+		NO_MARKER,
+		INTORG_MARKER,
+		INTEND_MARKER
+	};
+	std::vector<std::uint8_t> markers(n_variables, NO_MARKER);
+	bool in_integer_block = false;
+	for (IndexT v = 0; v < n_variables; v++)
+	{
+		if (!is_active(v))
+		{
+			continue;
+		}
+		auto domain = m.m_variable_domains[v];
+		bool is_integer = domain == VariableDomain::Integer || domain == VariableDomain::Binary;
+		if (is_integer != in_integer_block)
+		{
+			markers[v] = is_integer ? INTORG_MARKER : INTEND_MARKER;
+			in_integer_block = is_integer;
+		}
+	}
+
+	out.print("COLUMNS\n");
+	write_items(n_variables, [&](fmt::memory_buffer &buffer, IndexT v) {
+		if (!is_active(v))
+		{
+			return;
+		}
+		if (markers[v] != NO_MARKER)
+		{
+			print(buffer, "    MARKER 'MARKER' '{}'\n",
+			      markers[v] == INTORG_MARKER ? "INTORG" : "INTEND");
+		}
+		auto &name = variable_name(v);
+		auto start = column_starts[v];
+		auto end = column_starts[v + 1];
+		if (start == end)
+		{
+			// every column must appear in COLUMNS
+			write_mps_column_entry(buffer, name, row_names[n_rows], 0.0);
+		}
+		for (auto p = start; p < end; p++)
+		{
+			write_mps_column_entry(buffer, name, row_names[column_rows[p]],
+			                       column_coefficients[p]);
+		}
+	});
+	if (in_integer_block)
+	{
+		out.print("    MARKER 'MARKER' 'INTEND'\n");
+	}
+
+	out.print("RHS\n");
+	if (m.m_objective && m.m_objective->affine_part)
+	{
+		auto constant = m.m_objective->affine_part->constant.value_or(0.0);
+		if (constant != 0.0)
+		{
+			// the RHS of the objective row is the negative objective constant
+			out.print("    rhs obj {}\n", -constant);
+		}
+	}
+	for (IndexT r = 0; r < n_rows; r++)
+	{
+		auto [type, i] = rows[r];
+		CoeffT rhs = 0.0;
+		if (type == ConstraintType::Linear)
+		{
+			rhs = m.m_linear_rhss[i];
+		}
+		else if (type == ConstraintType::Quadratic)
+		{
+			rhs = m.m_quadratic_rhss[i];
+		}
+		if (rhs != 0.0)
+		{
+			out.print("    rhs {} {}\n", row_names[r], rhs);
+		}
+	}
+
+	out.print("BOUNDS\n");
+	for (IndexT v = 0; v < n_variables; v++)
+	{
+		if (!is_active(v))
+		{
+			continue;
+		}
+		auto domain = m.m_variable_domains[v];
+		auto &name = variable_name(v);
+		if (domain == VariableDomain::Binary)
+		{
+			out.print(" BV bnd {}\n", name);
+			continue;
+		}
+		auto lb = m_variable_lbs[v];
+		auto ub = m.m_variable_ubs[v];
+		bool lb_inf = std::isinf(lb);
+		bool ub_inf = std::isinf(ub);
+		if (domain == VariableDomain::SemiContinuous)
+		{
+			if (lb != 0.0)
+			{
+				out.print(" LO bnd {} {}\n", name, lb);
+			}
+			out.print(" SC bnd {} {}\n", name, ub);
+			continue;
+		}
+		if (lb_inf && ub_inf)
+		{
+			out.print(" FR bnd {}\n", name);
+			continue;
+		}
+		if (lb == ub)
+		{
+			out.print(" FX bnd {} {}\n", name, lb);
+			continue;
+		}
+		bool is_integer = domain == VariableDomain::Integer;
+		if (lb_inf)
+		{
+			out.print(" MI bnd {}\n", name);
+		}
+		else if (lb != 0.0 || is_integer || ub < 0.0)
+		{
+			// some readers change the lower bound to -inf for a negative upper bound
+			out.print(" LO bnd {} {}\n", name, lb);
+		}
+		if (!ub_inf)
+		{
+			out.print(" UP bnd {} {}\n", name, ub);
+		}
+		else if (is_integer)
+		{
+			// some readers use 1 as the default upper bound of integer variables
+			out.print(" PL bnd {}\n", name);
+		}
+	}
+
+	// QUADOBJ has the upper triangle of Q where the objective is x^T Q x / 2
+	auto objective_entries = objective_quadratic();
+	if (!objective_entries.empty())
+	{
+		out.print("QUADOBJ\n");
+		write_mps_quadratic_matrix(objective_entries, true, 2.0, 1.0);
+	}
+	// QCMATRIX has the full symmetric Q where the constraint is x^T Q x
+	for (IndexT r = 0; r < n_rows; r++)
+	{
+		auto [type, i] = rows[r];
+		std::vector<QuadraticEntry> entries;
+		if (type == ConstraintType::Quadratic)
+		{
+			entries = quadratic_constraint_quadratic(i);
+		}
+		else if (type == ConstraintType::Cone)
+		{
+			entries = cone_quadratic(i);
+		}
+		if (!entries.empty())
+		{
+			out.print("QCMATRIX {}\n", row_names[r]);
+			write_mps_quadratic_matrix(entries, false, 1.0, 0.5);
+		}
+	}
+
+	const IndexT n_sos = m.m_sos_types.size();
+	bool has_sos = false;
+	for (IndexT i = 0; i < n_sos; i++)
+	{
+		if (!m.m_sos_constraint_index.has_index(i))
+		{
+			continue;
+		}
+		if (!has_sos)
+		{
+			out.print("SOS\n");
+			has_sos = true;
+		}
+		out.print(" {} SOS {} 1\n", m.m_sos_types[i] == SOSType::SOS1 ? "S1" : "S2",
+		          constraint_name(ConstraintType::SOS, i));
+		for (IndexT k = m.m_sos_starts[i]; k < m.m_sos_starts[i + 1]; k++)
+		{
+			auto v = m.m_sos_variables[k];
+			if (is_active(v))
+			{
+				out.print("    {} {}\n", variable_name(v), m.m_sos_weights[k]);
+			}
+		}
+	}
+
+	out.print("ENDATA\n");
+}
+
+void CacheModel::write(const std::string &filename, int n_threads) const
+{
+	auto ends_with = [&](std::string_view suffix) {
+		return filename.size() >= suffix.size() &&
+		       filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	bool is_lp = ends_with(".lp");
+	bool is_mps = ends_with(".mps");
+	if (!is_lp && !is_mps)
+	{
+		throw std::runtime_error("Only .lp and .mps files are supported");
+	}
+
+	ThreadPool thread_pool;
+	thread_pool.resize(n_threads);
+	auto out = fmt::output_file(filename, fmt::buffer_size = 1 << 20);
+	CacheModelWriter writer(*this, out, &thread_pool);
+	if (is_lp)
+	{
+		writer.write_lp();
+	}
+	else
+	{
+		writer.write_mps();
+	}
+	out.close();
+}
@@ -203,6 +203,46 @@ VariableIndex COPTModel::add_variable(VariableDomain domain, double lb, double u
 	return variable;
 }
 
+VariableIndex COPTModel::add_variables(int N, const Vector<VariableDomain> &domains,
+                                       const Vector<double> &lbs, const Vector<double> &ubs,
+                                       const Vector<std::string> &names)
+{
+	check_batch_argument(domains, N, "domains");
+	check_batch_argument(lbs, N, "lbs");
+	check_batch_argument(ubs, N, "ubs");
+	check_batch_argument(names, N, "names");
+
+	std::vector<char> vtypes(N);
+	std::vector<double> lb(N), ub(N);
+	std::vector<const char *> colnames;
+	if (!names.empty())
+	{
+		colnames.resize(N);
+	}
+	const std::string empty_name;
+	for (int i = 0; i < N; i++)
+	{
+		vtypes[i] = copt_vtype(get_batch_argument(domains, i, VariableDomain::Continuous));
+		lb[i] = get_batch_argument(lbs, i, -COPT_INFINITY);
+		ub[i] = get_batch_argument(ubs, i, COPT_INFINITY);
+		if (!names.empty())
+		{
+			auto &name = get_batch_argument(names, i, empty_name);
+			colnames[i] = name.empty() ? nullptr : name.c_str();
+		}
+	}
+
+	int error = copt::COPT_AddCols(m_model.get(), N, NULL, NULL, NULL, NULL, NULL, vtypes.data(),
+	                               lb.data(), ub.data(),
+	                               colnames.empty() ? NULL : colnames.data());
+	check_error(error);
+
+	IndexT index = m_variable_index.add_indices(N);
+	VariableIndex variable(index);
+
+	return variable;
+}
+
 void COPTModel::delete_variable(const VariableIndex &variable)
 {
 	if (!is_variable_active(variable))
@@ -223,25 +263,20 @@ void COPTModel::delete_variables(const Vector<VariableIndex> &variables)
 	if (n_variables == 0)
 		return;
 
-	std::vector<int> columns;
-	columns.reserve(n_variables);
+	std::vector<IndexT> indices(n_variables);
 	for (int i = 0; i < n_variables; i++)
 	{
-		if (!is_variable_active(variables[i]))
-		{
-			continue;
-		}
-		auto column = _variable_index(variables[i]);
-		columns.push_back(column);
+		indices[i] = variables[i].index;
 	}
+	std::vector<int> columns(n_variables);
+	_variable_indices(indices, columns);
+	// skip the variables that are not active
+	std::erase_if(columns, [](int column) { return column < 0; });
 
 	int error = copt::COPT_DelCols(m_model.get(), columns.size(), columns.data());
 	check_error(error);
 
-	for (int i = 0; i < n_variables; i++)
-	{
-		m_variable_index.delete_index(variables[i].index);
-	}
+	m_variable_index.delete_indices(indices.data(), n_variables);
 }
 
 bool COPTModel::is_variable_active(const VariableIndex &variable)
@@ -254,6 +289,19 @@ double COPTModel::get_variable_value(const VariableIndex &variable)
 	return get_variable_info(variable, COPT_DBLINFO_VALUE);
 }
 
+void COPTModel::get_variable_values(std::span<const IndexT> variables, std::span<double> values)
+{
+	if (variables.size() != values.size())
+	{
+		throw std::runtime_error("variables and values must have the same length");
+	}
+	std::vector<int> columns(variables.size());
+	_checked_variable_indices(variables, columns);
+	int error = copt::COPT_GetColInfo(m_model.get(), COPT_DBLINFO_VALUE, columns.size(),
+	                                  columns.data(), values.data());
+	check_error(error);
+}
+
 std::string COPTModel::pprint_variable(const VariableIndex &variable)
 {
 	return get_variable_name(variable);
@@ -285,6 +333,52 @@ ConstraintIndex COPTModel::add_linear_constraint(const ScalarAffineFunction &fun
 	return constraint_index;
 }
 
+ConstraintIndex COPTModel::add_linear_constraints(std::span<const IndexT> row_starts,
+                                                  std::span<const IndexT> variables,
+                                                  std::span<const CoeffT> coefficients,
+                                                  const Vector<ConstraintSense> &senses,
+                                                  std::span<const CoeffT> rhss,
+                                                  const Vector<std::string> &names)
+{
+	CSRMatrixPtrForm<int, int, double> csr;
+	csr.make(this, row_starts, variables, coefficients);
+
+	int N = csr.numrows;
+	check_batch_argument(senses, N, "senses");
+	check_batch_argument(rhss, N, "rhss");
+	check_batch_argument(names, N, "names");
+
+	std::vector<int> counts(N);
+	std::vector<char> g_senses(N);
+	std::vector<double> g_rhss(N);
+	std::vector<const char *> rownames;
+	if (!names.empty())
+	{
+		rownames.resize(N);
+	}
+	for (int i = 0; i < N; i++)
+	{
+		counts[i] = csr.start[i + 1] - csr.start[i];
+		g_senses[i] = copt_con_sense(get_batch_argument(senses, i, ConstraintSense::Equal));
+		g_rhss[i] = get_batch_argument(rhss, i, 0.0);
+		if (!names.empty())
+		{
+			auto &name = get_batch_argument(names, i, names[0]);
+			rownames[i] = name.empty() ? nullptr : name.c_str();
+		}
+	}
+
+	int error = copt::COPT_AddRows(m_model.get(), N, csr.start, counts.data(), csr.index,
+	                               csr.value, g_senses.data(), g_rhss.data(), g_rhss.data(),
+	                               rownames.empty() ? NULL : rownames.data());
+	check_error(error);
+
+	IndexT index = m_linear_constraint_index.add_indices(N);
+	ConstraintIndex constraint_index(ConstraintType::Linear, index);
+
+	return constraint_index;
+}
+
 ConstraintIndex COPTModel::add_quadratic_constraint(const ScalarQuadraticFunction &function,
                                                     ConstraintSense sense, CoeffT rhs,
                                                     const char *name)
@@ -730,6 +824,22 @@ double COPTModel::get_constraint_info(const ConstraintIndex &constraint, const c
 	return retval;
 }
 
+void COPTModel::get_constraint_duals(std::span<const IndexT> constraints, std::span<double> values)
+{
+	if (constraints.size() != values.size())
+	{
+		throw std::runtime_error("constraints and values must have the same length");
+	}
+	std::vector<int> rows(constraints.size());
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		rows[i] = _checked_constraint_index({ConstraintType::Linear, constraints[i]});
+	}
+	int error = copt::COPT_GetRowInfo(m_model.get(), COPT_DBLINFO_DUAL, rows.size(), rows.data(),
+	                                  values.data());
+	check_error(error);
+}
+
 std::string COPTModel::get_constraint_name(const ConstraintIndex &constraint)
 {
 	int row = _checked_constraint_index(constraint);
@@ -946,6 +1056,24 @@ int COPTModel::_checked_variable_index(const VariableIndex &variable)
 	return column;
 }
 
+void COPTModel::_variable_indices(std::span<const IndexT> variables, std::span<int> columns)
+{
+	m_variable_index.get_indices(variables.data(), columns.data(), variables.size());
+}
+
+void COPTModel::_checked_variable_indices(std::span<const IndexT> variables,
+                                           std::span<int> columns)
+{
+	_variable_indices(variables, columns);
+	for (auto column : columns)
+	{
+		if (column < 0)
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+}
+
 int COPTModel::_constraint_index(const ConstraintIndex &constraint)
 {
 	switch (constraint.type)
@@ -4,6 +4,8 @@
 #include <nanobind/stl/function.h>
 
 #include "pyoptinterface/copt_model.hpp"
+#include "pyoptinterface/cache_model.hpp"
+#include "pyoptinterface/numpy_helper.hpp"
 
 namespace nb = nanobind;
 
@@ -36,6 +38,9 @@ NB_MODULE(copt_model_ext, m)
 	    .def("add_variable", &COPTModelMixin::add_variable,
 	         nb::arg("domain") = VariableDomain::Continuous, nb::arg("lb") = -COPT_INFINITY,
 	         nb::arg("ub") = COPT_INFINITY, nb::arg("name") = "")
+	    .def("add_variables_batch", &COPTModelMixin::add_variables, nb::arg("N"),
+	         nb::arg("domains") = Vector<VariableDomain>{}, nb::arg("lbs") = Vector<double>{},
+	         nb::arg("ubs") = Vector<double>{}, nb::arg("names") = Vector<std::string>{})
 	    // clang-format off
 	    BIND_F(delete_variable)
 	    BIND_F(delete_variables)
@@ -50,6 +55,14 @@ NB_MODULE(copt_model_ext, m)
 	                          &COPTModelMixin::get_expression_value))
 	    .def("get_value",
 	         nb::overload_cast<const ExprBuilder &>(&COPTModelMixin::get_expression_value))
+	    .def("get_variable_values", &get_variable_values_array<COPTModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_variable_values", &get_variable_values_list<COPTModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_constraint_duals", &get_constraint_duals_array<COPTModelMixin>,
+	         nb::arg("constraints"))
+	    .def("get_constraint_duals", &get_constraint_duals_list<COPTModelMixin>,
+	         nb::arg("constraints"))
 
 	    .def("pprint", &COPTModelMixin::pprint_variable)
 	    .def("pprint",
@@ -72,6 +85,18 @@ NB_MODULE(copt_model_ext, m)
 	         nb::overload_cast<const VariableIndex &, ConstraintSense, CoeffT, const char *>(
 	             &COPTModelMixin::add_linear_constraint_from_var),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraints_batch",
+	        [](COPTModelMixin &model, IndexArray row_starts, IndexArray variables,
+	           CoeffArray coefficients, const Vector<ConstraintSense> &senses, CoeffArray rhss,
+	           const Vector<std::string> &names) {
+		        return model.add_linear_constraints({row_starts.data(), row_starts.shape(0)},
+		                                            {variables.data(), variables.shape(0)},
+		                                            {coefficients.data(), coefficients.shape(0)},
+		                                            senses, {rhss.data(), rhss.shape(0)}, names);
+	        },
+	        nb::arg("row_starts"), nb::arg("variables"), nb::arg("coefficients"), nb::arg("senses"),
+	        nb::arg("rhss"), nb::arg("names") = Vector<std::string>{})
 	    .def("add_linear_constraint",
 	         nb::overload_cast<const ExprBuilder &, ConstraintSense, CoeffT, const char *>(
 	             &COPTModelMixin::add_linear_constraint_from_expr),
@@ -130,6 +155,11 @@ NB_MODULE(copt_model_ext, m)
 	             &COPTModelMixin::cb_add_user_cut),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"))
 
+	    .def(
+	        "load_cache",
+	        [](COPTModelMixin &model, const CacheModel &cache) { return cache.flush(model); },
+	        nb::arg("cache"))
+
 	    .def("optimize", &COPTModelMixin::optimize, nb::call_guard<nb::gil_scoped_release>())
 
 	    // clang-format off
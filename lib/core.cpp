@@ -1,5 +1,6 @@
 #include "pyoptinterface/core.hpp"
 #include <algorithm>
+#include <array>
 #include <stdexcept>
 
 #include "fmt/core.h"
@@ -57,25 +58,16 @@ size_t ScalarAffineFunction::size() const
 }
 void ScalarAffineFunction::canonicalize(CoeffT threshold)
 {
-	ExprBuilder t(*this);
+	FlatExprBuilder t(*this);
 	t.clean_nearzero_terms(threshold);
 
-	// *this = ScalarAffineFunction(t);
-	// sort coefficients and variable lock by lock with std::views::zip
-	// std::ranges::sort(std::views::zip(variables, coefficients));
-
-	variables.clear();
-	variables.reserve(t.affine_terms.size());
-	for (const auto &it : t.affine_terms)
-	{
-		variables.push_back(it.first);
-	}
-	std::sort(variables.begin(), variables.end());
-	coefficients.clear();
-	coefficients.reserve(variables.size());
-	for (const auto &it : variables)
+	auto N = t.affine_terms.size();
+	variables.resize(N);
+	coefficients.resize(N);
+	for (size_t i = 0; i < N; i++)
 	{
-		coefficients.push_back(t.affine_terms[it]);
+		variables[i] = t.affine_terms[i].variable;
+		coefficients[i] = t.affine_terms[i].coefficient;
 	}
 	constant = t.constant_term;
 }
@@ -133,37 +125,33 @@ size_t ScalarQuadraticFunction::size() const
 }
 void ScalarQuadraticFunction::canonicalize(CoeffT threshold)
 {
-	ExprBuilder t(*this);
+	FlatExprBuilder t(*this);
 	t.clean_nearzero_terms(threshold);
 
-	// *this = ScalarQuadraticFunction(t);
-	// std::ranges::sort(std::views::zip(variable_1s, variable_2s, coefficients));
-
 	auto N = t.quadratic_terms.size();
-	std::vector<VariablePair> varpairs;
-	varpairs.reserve(N);
-	for (const auto &it : t.quadratic_terms)
-	{
-		varpairs.emplace_back(it.first);
-	}
-	std::sort(varpairs.begin(), varpairs.end());
-	variable_1s.clear();
-	variable_1s.reserve(N);
-	variable_2s.clear();
-	variable_2s.reserve(N);
-	coefficients.clear();
-	coefficients.reserve(N);
-	for (const auto &it : varpairs)
+	variable_1s.resize(N);
+	variable_2s.resize(N);
+	coefficients.resize(N);
+	for (size_t i = 0; i < N; i++)
 	{
-		variable_1s.push_back(it.var_1);
-		variable_2s.push_back(it.var_2);
-		coefficients.push_back(t.quadratic_terms[it]);
+		const auto &term = t.quadratic_terms[i];
+		variable_1s[i] = term.variables.var_1;
+		variable_2s[i] = term.variables.var_2;
+		coefficients[i] = term.coefficient;
 	}
 
 	if (affine_part)
 	{
 		auto &affine_function = affine_part.value();
-		affine_function.canonicalize(threshold);
+		auto M = t.affine_terms.size();
+		affine_function.variables.resize(M);
+		affine_function.coefficients.resize(M);
+		for (size_t i = 0; i < M; i++)
+		{
+			affine_function.variables[i] = t.affine_terms[i].variable;
+			affine_function.coefficients[i] = t.affine_terms[i].coefficient;
+		}
+		affine_function.constant = t.constant_term;
 	}
 }
 
@@ -786,6 +774,443 @@ ExprBuilder& ExprBuilder::operator/=(CoeffT c)
 	return *this;
 }
 
+// LSD radix sort of the terms by their unsigned key, then the adjacent terms with the same key
+// are merged into one
+template <typename KeyT, typename T, typename KeyF>
+static void sort_and_merge_terms(Vector<T> &terms, KeyF key)
+{
+	auto N = terms.size();
+	if (N < 64)
+	{
+		std::stable_sort(terms.begin(), terms.end(),
+		                 [&](const T &a, const T &b) { return key(a) < key(b); });
+	}
+	else
+	{
+		constexpr size_t n_passes = sizeof(KeyT);
+		std::array<std::array<size_t, 256>, n_passes> counts{};
+		for (const auto &term : terms)
+		{
+			KeyT k = key(term);
+			for (size_t pass = 0; pass < n_passes; pass++)
+			{
+				counts[pass][(k >> (8 * pass)) & 0xFF]++;
+			}
+		}
+
+		Vector<T> buffer(N);
+		T *src = terms.data();
+		T *dst = buffer.data();
+		for (size_t pass = 0; pass < n_passes; pass++)
+		{
+			auto &count = counts[pass];
+			auto shift = 8 * pass;
+			// all keys have the same digit in this pass, skip it
+			if (count[(key(src[0]) >> shift) & 0xFF] == N)
+			{
+				continue;
+			}
+			size_t offset = 0;
+			for (auto &c : count)
+			{
+				auto n = c;
+				c = offset;
+				offset += n;
+			}
+			for (size_t i = 0; i < N; i++)
+			{
+				auto digit = (key(src[i]) >> shift) & 0xFF;
+				dst[count[digit]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		if (src != terms.data())
+		{
+			terms.swap(buffer);
+		}
+	}
+
+	size_t n_merged = 0;
+	for (size_t i = 0; i < N; i++)
+	{
+		if (n_merged > 0 && key(terms[n_merged - 1]) == key(terms[i]))
+		{
+			terms[n_merged - 1].coefficient += terms[i].coefficient;
+		}
+		else
+		{
+			terms[n_merged] = terms[i];
+			n_merged++;
+		}
+	}
+	terms.resize(n_merged);
+}
+
+static uint32_t affine_term_key(const FlatExprBuilder::AffineTerm &term)
+{
+	return static_cast<uint32_t>(term.variable);
+}
+
+static uint64_t quadratic_term_key(const FlatExprBuilder::QuadraticTerm &term)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(term.variables.var_1)) << 32) |
+	       static_cast<uint32_t>(term.variables.var_2);
+}
+
+FlatExprBuilder::FlatExprBuilder(CoeffT c)
+{
+	operator+=(c);
+}
+
+FlatExprBuilder::FlatExprBuilder(const VariableIndex &v)
+{
+	operator+=(v);
+}
+
+FlatExprBuilder::FlatExprBuilder(const ScalarAffineFunction &a)
+{
+	operator+=(a);
+}
+
+FlatExprBuilder::FlatExprBuilder(const ScalarQuadraticFunction &q)
+{
+	operator+=(q);
+}
+
+FlatExprBuilder::FlatExprBuilder(const ExprBuilder &t)
+{
+	operator+=(t);
+}
+
+bool FlatExprBuilder::empty() const
+{
+	return quadratic_terms.empty() && affine_terms.empty() && !constant_term;
+}
+
+int FlatExprBuilder::degree() const
+{
+	if (!quadratic_terms.empty())
+	{
+		return 2;
+	}
+	if (!affine_terms.empty())
+	{
+		return 1;
+	}
+	return 0;
+}
+
+void FlatExprBuilder::reserve_quadratic(size_t n)
+{
+	quadratic_terms.reserve(n);
+}
+
+void FlatExprBuilder::reserve_affine(size_t n)
+{
+	affine_terms.reserve(n);
+}
+
+void FlatExprBuilder::clear()
+{
+	quadratic_terms.clear();
+	affine_terms.clear();
+	constant_term.reset();
+	finalized = true;
+}
+
+void FlatExprBuilder::finalize()
+{
+	if (finalized)
+	{
+		return;
+	}
+	sort_and_merge_terms<uint64_t>(quadratic_terms, quadratic_term_key);
+	sort_and_merge_terms<uint32_t>(affine_terms, affine_term_key);
+	finalized = true;
+}
+
+void FlatExprBuilder::clean_nearzero_terms(CoeffT threshold)
+{
+	finalize();
+	std::erase_if(quadratic_terms,
+	              [=](const QuadraticTerm &term) { return std::abs(term.coefficient) < threshold; });
+	std::erase_if(affine_terms,
+	              [=](const AffineTerm &term) { return std::abs(term.coefficient) < threshold; });
+	if (constant_term && std::abs(*constant_term) < threshold)
+	{
+		constant_term.reset();
+	}
+}
+
+void FlatExprBuilder::_add_quadratic_term(IndexT i, IndexT j, CoeffT coeff)
+{
+	if (i > j)
+	{
+		std::swap(i, j);
+	}
+	quadratic_terms.push_back({{i, j}, coeff});
+	finalized = false;
+}
+
+void FlatExprBuilder::add_quadratic_term(const VariableIndex &i, const VariableIndex &j,
+                                         CoeffT coeff)
+{
+	_add_quadratic_term(i.index, j.index, coeff);
+}
+
+void FlatExprBuilder::_add_affine_term(IndexT i, CoeffT coeff)
+{
+	affine_terms.push_back({i, coeff});
+	finalized = false;
+}
+
+void FlatExprBuilder::add_affine_term(const VariableIndex &i, CoeffT coeff)
+{
+	_add_affine_term(i.index, coeff);
+}
+
+FlatExprBuilder &FlatExprBuilder::operator+=(CoeffT c)
+{
+	constant_term = constant_term.value_or(0.0) + c;
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator+=(const VariableIndex &v)
+{
+	_add_affine_term(v.index, 1.0);
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator+=(const ScalarAffineFunction &a)
+{
+	auto N = a.coefficients.size();
+	affine_terms.reserve(affine_terms.size() + N);
+	for (size_t i = 0; i < N; i++)
+	{
+		_add_affine_term(a.variables[i], a.coefficients[i]);
+	}
+
+	if (a.constant)
+	{
+		constant_term = constant_term.value_or(0.0) + a.constant.value();
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator+=(const ScalarQuadraticFunction &q)
+{
+	if (q.affine_part)
+	{
+		operator+=(q.affine_part.value());
+	}
+
+	auto N = q.coefficients.size();
+	quadratic_terms.reserve(quadratic_terms.size() + N);
+	for (size_t i = 0; i < N; i++)
+	{
+		_add_quadratic_term(q.variable_1s[i], q.variable_2s[i], q.coefficients[i]);
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator+=(const ExprBuilder &t)
+{
+	quadratic_terms.reserve(quadratic_terms.size() + t.quadratic_terms.size());
+	for (const auto &[varpair, c] : t.quadratic_terms)
+	{
+		_add_quadratic_term(varpair.var_1, varpair.var_2, c);
+	}
+	affine_terms.reserve(affine_terms.size() + t.affine_terms.size());
+	for (const auto &[v, c] : t.affine_terms)
+	{
+		_add_affine_term(v, c);
+	}
+	if (t.constant_term)
+	{
+		constant_term = constant_term.value_or(0.0) + t.constant_term.value();
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator+=(const FlatExprBuilder &t)
+{
+	if (!t.quadratic_terms.empty())
+	{
+		quadratic_terms.insert(quadratic_terms.end(), t.quadratic_terms.begin(),
+		                       t.quadratic_terms.end());
+		finalized = false;
+	}
+	if (!t.affine_terms.empty())
+	{
+		affine_terms.insert(affine_terms.end(), t.affine_terms.begin(), t.affine_terms.end());
+		finalized = false;
+	}
+	if (t.constant_term)
+	{
+		constant_term = constant_term.value_or(0.0) + t.constant_term.value();
+	}
+	return *this;
+}
+
+FlatExprBuilder &FlatExprBuilder::operator-=(CoeffT c)
+{
+	constant_term = constant_term.value_or(0.0) - c;
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator-=(const VariableIndex &v)
+{
+	_add_affine_term(v.index, -1.0);
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator-=(const ScalarAffineFunction &a)
+{
+	auto N = a.coefficients.size();
+	affine_terms.reserve(affine_terms.size() + N);
+	for (size_t i = 0; i < N; i++)
+	{
+		_add_affine_term(a.variables[i], -a.coefficients[i]);
+	}
+
+	if (a.constant)
+	{
+		constant_term = constant_term.value_or(0.0) - a.constant.value();
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator-=(const ScalarQuadraticFunction &q)
+{
+	if (q.affine_part)
+	{
+		operator-=(q.affine_part.value());
+	}
+
+	auto N = q.coefficients.size();
+	quadratic_terms.reserve(quadratic_terms.size() + N);
+	for (size_t i = 0; i < N; i++)
+	{
+		_add_quadratic_term(q.variable_1s[i], q.variable_2s[i], -q.coefficients[i]);
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator-=(const ExprBuilder &t)
+{
+	quadratic_terms.reserve(quadratic_terms.size() + t.quadratic_terms.size());
+	for (const auto &[varpair, c] : t.quadratic_terms)
+	{
+		_add_quadratic_term(varpair.var_1, varpair.var_2, -c);
+	}
+	affine_terms.reserve(affine_terms.size() + t.affine_terms.size());
+	for (const auto &[v, c] : t.affine_terms)
+	{
+		_add_affine_term(v, -c);
+	}
+	if (t.constant_term)
+	{
+		constant_term = constant_term.value_or(0.0) - t.constant_term.value();
+	}
+	return *this;
+}
+FlatExprBuilder &FlatExprBuilder::operator-=(const FlatExprBuilder &t)
+{
+	quadratic_terms.reserve(quadratic_terms.size() + t.quadratic_terms.size());
+	for (const auto &term : t.quadratic_terms)
+	{
+		_add_quadratic_term(term.variables.var_1, term.variables.var_2, -term.coefficient);
+	}
+	affine_terms.reserve(affine_terms.size() + t.affine_terms.size());
+	for (const auto &term : t.affine_terms)
+	{
+		_add_affine_term(term.variable, -term.coefficient);
+	}
+	if (t.constant_term)
+	{
+		constant_term = constant_term.value_or(0.0) - t.constant_term.value();
+	}
+	return *this;
+}
+
+FlatExprBuilder &FlatExprBuilder::operator*=(CoeffT c)
+{
+	for (auto &term : quadratic_terms)
+	{
+		term.coefficient *= c;
+	}
+	for (auto &term : affine_terms)
+	{
+		term.coefficient *= c;
+	}
+	if (constant_term)
+	{
+		constant_term = constant_term.value() * c;
+	}
+	return *this;
+}
+
+FlatExprBuilder &FlatExprBuilder::operator/=(CoeffT c)
+{
+	for (auto &term : quadratic_terms)
+	{
+		term.coefficient /= c;
+	}
+	for (auto &term : affine_terms)
+	{
+		term.coefficient /= c;
+	}
+	if (constant_term)
+	{
+		constant_term = constant_term.value() / c;
+	}
+	return *this;
+}
+
+ScalarAffineFunction FlatExprBuilder::to_affine()
+{
+	finalize();
+
+	ScalarAffineFunction f;
+	f.reserve(affine_terms.size());
+	for (const auto &term : affine_terms)
+	{
+		f.coefficients.push_back(term.coefficient);
+		f.variables.push_back(term.variable);
+	}
+	f.constant = constant_term;
+	return f;
+}
+
+ScalarQuadraticFunction FlatExprBuilder::to_quadratic()
+{
+	finalize();
+
+	ScalarQuadraticFunction f;
+	f.reserve_quadratic(quadratic_terms.size());
+	for (const auto &term : quadratic_terms)
+	{
+		f.coefficients.push_back(term.coefficient);
+		f.variable_1s.push_back(term.variables.var_1);
+		f.variable_2s.push_back(term.variables.var_2);
+	}
+	if (!affine_terms.empty() || constant_term)
+	{
+		f.affine_part = to_affine();
+	}
+	return f;
+}
+
+ExprBuilder FlatExprBuilder::to_expr_builder()
+{
+	finalize();
+
+	ExprBuilder t;
+	t.reserve_quadratic(quadratic_terms.size());
+	for (const auto &term : quadratic_terms)
+	{
+		t.quadratic_terms.emplace(term.variables, term.coefficient);
+	}
+	t.reserve_affine(affine_terms.size());
+	for (const auto &term : affine_terms)
+	{
+		t.affine_terms.emplace(term.variable, term.coefficient);
+	}
+	t.constant_term = constant_term;
+	return t;
+}
+
 // Operator overloading functions
 
 auto operator+(const VariableIndex &a, CoeffT b) -> ScalarAffineFunction
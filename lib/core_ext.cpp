@@ -1,14 +1,21 @@
 #include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
 #include <nanobind/operators.h>
+#include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 #include <nanobind/stl/pair.h>
+#include <nanobind/stl/unordered_map.h>
 #include <nanobind/stl/optional.h>
 
 #include "pyoptinterface/core.hpp"
 #include "pyoptinterface/container.hpp"
+#include "pyoptinterface/cache_model.hpp"
 
 namespace nb = nanobind;
 
+using IndexArray = nb::ndarray<const IndexT, nb::ndim<1>, nb::c_contig, nb::device::cpu>;
+using CoeffArray = nb::ndarray<const CoeffT, nb::ndim<1>, nb::c_contig, nb::device::cpu>;
+
 NB_MODULE(core_ext, m)
 {
 	// VariableDomain
@@ -199,11 +206,152 @@ NB_MODULE(core_ext, m)
 	    .def(ExprBuilder() * nb::self)
 	    .def(nb::self / CoeffT());
 
+	nb::class_<FlatExprBuilder>(m, "FlatExprBuilder")
+	    .def(nb::init<>())
+	    .def(nb::init<CoeffT>())
+	    .def(nb::init<const VariableIndex &>())
+	    .def(nb::init<const ScalarAffineFunction &>())
+	    .def(nb::init<const ScalarQuadraticFunction &>())
+	    .def(nb::init<const ExprBuilder &>())
+	    .def("empty", &FlatExprBuilder::empty)
+	    .def("degree", &FlatExprBuilder::degree)
+	    .def("reserve_quadratic", &FlatExprBuilder::reserve_quadratic)
+	    .def("reserve_affine", &FlatExprBuilder::reserve_affine)
+	    .def("clear", &FlatExprBuilder::clear)
+	    .def("finalize", &FlatExprBuilder::finalize)
+	    .def("clean_nearzero_terms", &FlatExprBuilder::clean_nearzero_terms,
+	         nb::arg("threshold") = COEFTHRESHOLD)
+	    .def("add_quadratic_term", &FlatExprBuilder::add_quadratic_term)
+	    .def("add_affine_term", &FlatExprBuilder::add_affine_term)
+	    .def("to_affine", &FlatExprBuilder::to_affine)
+	    .def("to_quadratic", &FlatExprBuilder::to_quadratic)
+	    .def("to_expr_builder", &FlatExprBuilder::to_expr_builder)
+	    .def(nb::self += CoeffT(), nb::rv_policy::none)
+	    .def(nb::self += VariableIndex(), nb::rv_policy::none)
+	    .def(nb::self += ScalarAffineFunction(), nb::rv_policy::none)
+	    .def(nb::self += ScalarQuadraticFunction(), nb::rv_policy::none)
+	    .def(nb::self += ExprBuilder(), nb::rv_policy::none)
+	    .def(nb::self += FlatExprBuilder(), nb::rv_policy::none)
+	    .def(nb::self -= CoeffT(), nb::rv_policy::none)
+	    .def(nb::self -= VariableIndex(), nb::rv_policy::none)
+	    .def(nb::self -= ScalarAffineFunction(), nb::rv_policy::none)
+	    .def(nb::self -= ScalarQuadraticFunction(), nb::rv_policy::none)
+	    .def(nb::self -= ExprBuilder(), nb::rv_policy::none)
+	    .def(nb::self -= FlatExprBuilder(), nb::rv_policy::none)
+	    .def(nb::self *= CoeffT(), nb::rv_policy::none)
+	    .def(nb::self /= CoeffT(), nb::rv_policy::none);
+
 	// We need to test the functionality of MonotoneIndexer
 	using IntMonotoneIndexer = MonotoneIndexer<int>;
 	nb::class_<IntMonotoneIndexer>(m, "IntMonotoneIndexer")
 	    .def(nb::init<>())
 	    .def("add_index", &IntMonotoneIndexer::add_index)
 	    .def("get_index", &IntMonotoneIndexer::get_index)
-	    .def("delete_index", &IntMonotoneIndexer::delete_index);
+	    .def("get_indices",
+	         [](IntMonotoneIndexer &indexer, const Vector<IndexT> &indices) {
+		         Vector<int> result(indices.size());
+		         indexer.get_indices(indices.data(), result.data(), indices.size());
+		         return result;
+	         })
+	    .def("delete_index", &IntMonotoneIndexer::delete_index)
+	    .def("delete_indices",
+	         [](IntMonotoneIndexer &indexer, const Vector<IndexT> &indices) {
+		         indexer.delete_indices(indices.data(), indices.size());
+	         })
+	    .def(
+	        "rebuild",
+	        [](IntMonotoneIndexer &indexer, int n_threads) {
+		        // the threads are kept for the next call
+		        static ThreadPool thread_pool;
+		        thread_pool.resize(n_threads);
+		        indexer.rebuild(thread_pool);
+	        },
+	        nb::arg("n_threads") = 1);
+
+	nb::class_<CacheModelFlushHandles>(m, "CacheModelFlushHandles")
+	    .def("variable", &CacheModelFlushHandles::variable, nb::arg("variable"))
+	    .def("constraint", &CacheModelFlushHandles::constraint, nb::arg("constraint"));
+
+	nb::class_<CacheModel>(m, "CacheModel")
+	    .def(nb::init<>())
+	    .def("add_variable", &CacheModel::add_variable,
+	         nb::arg("domain") = VariableDomain::Continuous, nb::arg("lb") = -CacheModel::INF,
+	         nb::arg("ub") = CacheModel::INF, nb::arg("name") = "")
+	    .def("add_variables_batch", &CacheModel::add_variables, nb::arg("N"),
+	         nb::arg("domains") = Vector<VariableDomain>{}, nb::arg("lbs") = Vector<double>{},
+	         nb::arg("ubs") = Vector<double>{}, nb::arg("names") = Vector<std::string>{})
+	    .def("delete_variable", &CacheModel::delete_variable)
+	    .def("is_variable_active", &CacheModel::is_variable_active)
+	    .def("number_of_variables", &CacheModel::number_of_variables)
+
+	    .def("add_linear_constraint", &CacheModel::add_linear_constraint, nb::arg("expr"),
+	         nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraint",
+	        [](CacheModel &model, const VariableIndex &variable, ConstraintSense sense, CoeffT rhs,
+	           const char *name) {
+		        return model.add_linear_constraint(ScalarAffineFunction(variable), sense, rhs, name);
+	        },
+	        nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraint",
+	        [](CacheModel &model, const ExprBuilder &function, ConstraintSense sense, CoeffT rhs,
+	           const char *name) {
+		        return model.add_linear_constraint(ScalarAffineFunction(function), sense, rhs, name);
+	        },
+	        nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraints_batch",
+	        [](CacheModel &model, IndexArray row_starts, IndexArray variables,
+	           CoeffArray coefficients, const Vector<ConstraintSense> &senses, CoeffArray rhss,
+	           const Vector<std::string> &names) {
+		        return model.add_linear_constraints({row_starts.data(), row_starts.shape(0)},
+		                                            {variables.data(), variables.shape(0)},
+		                                            {coefficients.data(), coefficients.shape(0)},
+		                                            senses, {rhss.data(), rhss.shape(0)}, names);
+	        },
+	        nb::arg("row_starts"), nb::arg("variables"), nb::arg("coefficients"), nb::arg("senses"),
+	        nb::arg("rhss"), nb::arg("names") = Vector<std::string>{})
+	    .def("add_quadratic_constraint", &CacheModel::add_quadratic_constraint, nb::arg("expr"),
+	         nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_quadratic_constraint",
+	        [](CacheModel &model, const ExprBuilder &function, ConstraintSense sense, CoeffT rhs,
+	           const char *name) {
+		        return model.add_quadratic_constraint(ScalarQuadraticFunction(function), sense, rhs,
+		                                              name);
+	        },
+	        nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def("add_sos_constraint", &CacheModel::add_sos_constraint, nb::arg("variables"),
+	         nb::arg("sos_type"), nb::arg("weights") = Vector<CoeffT>{})
+	    .def("add_second_order_cone_constraint", &CacheModel::add_second_order_cone_constraint,
+	         nb::arg("variables"), nb::arg("name") = "", nb::arg("rotated") = false)
+	    .def("delete_constraint", &CacheModel::delete_constraint)
+	    .def("is_constraint_active", &CacheModel::is_constraint_active)
+	    .def("number_of_constraints", &CacheModel::number_of_constraints)
+
+	    .def("set_objective",
+	         nb::overload_cast<const ScalarQuadraticFunction &, ObjectiveSense>(
+	             &CacheModel::set_objective),
+	         nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
+	    .def("set_objective",
+	         nb::overload_cast<const ScalarAffineFunction &, ObjectiveSense>(
+	             &CacheModel::set_objective),
+	         nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
+	    .def("set_objective",
+	         nb::overload_cast<const ExprBuilder &, ObjectiveSense>(&CacheModel::set_objective),
+	         nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
+	    .def(
+	        "set_objective",
+	        [](CacheModel &model, const VariableIndex &variable, ObjectiveSense sense) {
+		        model.set_objective(ScalarAffineFunction(variable), sense);
+	        },
+	        nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
+
+	    .def("clear", &CacheModel::clear)
+
+	    .def("write", &CacheModel::write, nb::arg("filename"), nb::arg("n_threads") = 1)
+	    .def("read", &CacheModel::read, nb::arg("filename"))
+	    .def("save_snapshot", &CacheModel::save_snapshot, nb::arg("filename"))
+	    .def("load_snapshot", &CacheModel::load_snapshot, nb::arg("filename"));
 }
@@ -149,6 +149,52 @@ VariableIndex GurobiModel::add_variable(VariableDomain domain, double lb, double
 	return variable;
 }
 
+VariableIndex GurobiModel::add_variables(int N, const Vector<VariableDomain> &domains,
+                                         const Vector<double> &lbs, const Vector<double> &ubs,
+                                         const Vector<std::string> &names)
+{
+	check_batch_argument(domains, N, "domains");
+	check_batch_argument(lbs, N, "lbs");
+	check_batch_argument(ubs, N, "ubs");
+	check_batch_argument(names, N, "names");
+
+	std::vector<char> vtypes(N);
+	std::vector<double> lb(N), ub(N);
+	for (int i = 0; i < N; i++)
+	{
+		vtypes[i] = gurobi_vtype(get_batch_argument(domains, i, VariableDomain::Continuous));
+		lb[i] = get_batch_argument(lbs, i, -GRB_INFINITY);
+		ub[i] = get_batch_argument(ubs, i, GRB_INFINITY);
+	}
+	// the names are only passed if some of them are given, the others are empty strings
+	std::vector<char *> varnames;
+	bool has_names = std::any_of(names.begin(), names.end(),
+	                             [](const std::string &name) { return !name.empty(); });
+	if (has_names)
+	{
+		const std::string empty_name;
+		varnames.resize(N);
+		for (int i = 0; i < N; i++)
+		{
+			auto &name = get_batch_argument(names, i, empty_name);
+			varnames[i] = const_cast<char *>(name.c_str());
+		}
+	}
+
+	// Create all Gurobi variables with one call
+	int error = gurobi::GRBaddvars(m_model.get(), N, 0, NULL, NULL, NULL, NULL, lb.data(),
+	                               ub.data(), vtypes.data(),
+	                               varnames.empty() ? NULL : varnames.data());
+	check_error(error);
+
+	IndexT index = m_variable_index.add_indices(N);
+	VariableIndex variable(index);
+
+	m_update_flag |= m_variable_creation;
+
+	return variable;
+}
+
 void GurobiModel::delete_variable(const VariableIndex &variable)
 {
 	if (!is_variable_active(variable))
@@ -172,25 +218,20 @@ void GurobiModel::delete_variables(const Vector<VariableIndex> &variables)
 	if (n_variables == 0)
 		return;
 
-	std::vector<int> columns;
-	columns.reserve(n_variables);
+	std::vector<IndexT> indices(n_variables);
 	for (int i = 0; i < n_variables; i++)
 	{
-		if (!is_variable_active(variables[i]))
-		{
-			continue;
-		}
-		auto column = _variable_index(variables[i]);
-		columns.push_back(column);
+		indices[i] = variables[i].index;
 	}
+	std::vector<int> columns(n_variables);
+	_variable_indices(indices, columns);
+	// skip the variables that are not active
+	std::erase_if(columns, [](int column) { return column < 0; });
 
 	int error = gurobi::GRBdelvars(m_model.get(), columns.size(), columns.data());
 	check_error(error);
 
-	for (int i = 0; i < n_variables; i++)
-	{
-		m_variable_index.delete_index(variables[i].index);
-	}
+	m_variable_index.delete_indices(indices.data(), n_variables);
 
 	m_update_flag |= m_variable_deletion;
 }
@@ -205,6 +246,20 @@ double GurobiModel::get_variable_value(const VariableIndex &variable)
 	return get_variable_raw_attribute_double(variable, GRB_DBL_ATTR_X);
 }
 
+void GurobiModel::get_variable_values(std::span<const IndexT> variables, std::span<double> values)
+{
+	if (variables.size() != values.size())
+	{
+		throw std::runtime_error("variables and values must have the same length");
+	}
+	_update_for_information();
+	std::vector<int> columns(variables.size());
+	_checked_variable_indices(variables, columns);
+	int error = gurobi::GRBgetdblattrlist(m_model.get(), GRB_DBL_ATTR_X, columns.size(),
+	                                      columns.data(), values.data());
+	check_error(error);
+}
+
 std::string GurobiModel::pprint_variable(const VariableIndex &variable)
 {
 	return get_variable_raw_attribute_string(variable, GRB_STR_ATTR_VARNAME);
@@ -263,6 +318,53 @@ ConstraintIndex GurobiModel::add_linear_constraint(const ScalarAffineFunction &f
 	return constraint_index;
 }
 
+ConstraintIndex GurobiModel::add_linear_constraints(std::span<const IndexT> row_starts,
+                                                    std::span<const IndexT> variables,
+                                                    std::span<const CoeffT> coefficients,
+                                                    const Vector<ConstraintSense> &senses,
+                                                    std::span<const CoeffT> rhss,
+                                                    const Vector<std::string> &names)
+{
+	CSRMatrixPtrForm<int, int, double> csr;
+	csr.make(this, row_starts, variables, coefficients);
+
+	int N = csr.numrows;
+	check_batch_argument(senses, N, "senses");
+	check_batch_argument(rhss, N, "rhss");
+	check_batch_argument(names, N, "names");
+
+	std::vector<char> g_senses(N);
+	std::vector<double> g_rhss(N);
+	std::vector<char *> constrnames;
+	if (!names.empty())
+	{
+		constrnames.resize(N);
+	}
+	for (int i = 0; i < N; i++)
+	{
+		g_senses[i] = gurobi_con_sense(get_batch_argument(senses, i, ConstraintSense::Equal));
+		g_rhss[i] = get_batch_argument(rhss, i, 0.0);
+		if (!names.empty())
+		{
+			auto &name = get_batch_argument(names, i, names[0]);
+			constrnames[i] = name.empty() ? nullptr : const_cast<char *>(name.c_str());
+		}
+	}
+
+	// Create all Gurobi linear constraints with one call
+	int error = gurobi::GRBaddconstrs(m_model.get(), N, csr.numnz, csr.start, csr.index,
+	                                  csr.value, g_senses.data(), g_rhss.data(),
+	                                  constrnames.empty() ? NULL : constrnames.data());
+	check_error(error);
+
+	IndexT index = m_linear_constraint_index.add_indices(N);
+	ConstraintIndex constraint_index(ConstraintType::Linear, index);
+
+	m_update_flag |= m_linear_constraint_creation;
+
+	return constraint_index;
+}
+
 ConstraintIndex GurobiModel::add_quadratic_constraint(const ScalarQuadraticFunction &function,
                                                       ConstraintSense sense, CoeffT rhs,
                                                       const char *name)
@@ -728,6 +830,25 @@ int GurobiModel::_checked_variable_index(const VariableIndex &variable)
 	return column;
 }
 
+void GurobiModel::_variable_indices(std::span<const IndexT> variables, std::span<int> columns)
+{
+	_update_for_variable_index();
+	m_variable_index.get_indices(variables.data(), columns.data(), variables.size());
+}
+
+void GurobiModel::_checked_variable_indices(std::span<const IndexT> variables,
+                                             std::span<int> columns)
+{
+	_variable_indices(variables, columns);
+	for (auto column : columns)
+	{
+		if (column < 0)
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+}
+
 void GurobiModel::set_constraint_raw_attribute_int(const ConstraintIndex &constraint,
                                                    const char *attr_name, int value)
 {
@@ -797,6 +918,24 @@ double GurobiModel::get_constraint_raw_attribute_double(const ConstraintIndex &c
 	return retval;
 }
 
+void GurobiModel::get_constraint_duals(std::span<const IndexT> constraints,
+                                       std::span<double> values)
+{
+	if (constraints.size() != values.size())
+	{
+		throw std::runtime_error("constraints and values must have the same length");
+	}
+	_update_for_information();
+	std::vector<int> rows(constraints.size());
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		rows[i] = _checked_constraint_index({ConstraintType::Linear, constraints[i]});
+	}
+	int error = gurobi::GRBgetdblattrlist(m_model.get(), GRB_DBL_ATTR_PI, rows.size(), rows.data(),
+	                                      values.data());
+	check_error(error);
+}
+
 std::string GurobiModel::get_constraint_raw_attribute_string(const ConstraintIndex &constraint,
                                                              const char *attr_name)
 {
@@ -4,6 +4,8 @@
 #include <nanobind/stl/function.h>
 
 #include "pyoptinterface/gurobi_model.hpp"
+#include "pyoptinterface/cache_model.hpp"
+#include "pyoptinterface/numpy_helper.hpp"
 
 namespace nb = nanobind;
 
@@ -45,6 +47,9 @@ NB_MODULE(gurobi_model_ext, m)
 	    .def("add_variable", &GurobiModelMixin::add_variable,
 	         nb::arg("domain") = VariableDomain::Continuous, nb::arg("lb") = -GRB_INFINITY,
 	         nb::arg("ub") = GRB_INFINITY, nb::arg("name") = "")
+	    .def("add_variables_batch", &GurobiModelMixin::add_variables, nb::arg("N"),
+	         nb::arg("domains") = Vector<VariableDomain>{}, nb::arg("lbs") = Vector<double>{},
+	         nb::arg("ubs") = Vector<double>{}, nb::arg("names") = Vector<std::string>{})
 	    // clang-format off
 	    BIND_F(delete_variable)
 	    BIND_F(delete_variables)
@@ -59,6 +64,14 @@ NB_MODULE(gurobi_model_ext, m)
 	                          &GurobiModelMixin::get_expression_value))
 	    .def("get_value",
 	         nb::overload_cast<const ExprBuilder &>(&GurobiModelMixin::get_expression_value))
+	    .def("get_variable_values", &get_variable_values_array<GurobiModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_variable_values", &get_variable_values_list<GurobiModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_constraint_duals", &get_constraint_duals_array<GurobiModelMixin>,
+	         nb::arg("constraints"))
+	    .def("get_constraint_duals", &get_constraint_duals_list<GurobiModelMixin>,
+	         nb::arg("constraints"))
 
 	    .def("pprint", &GurobiModelMixin::pprint_variable)
 	    .def("pprint",
@@ -86,6 +99,18 @@ NB_MODULE(gurobi_model_ext, m)
 	         nb::overload_cast<const VariableIndex &, ConstraintSense, CoeffT, const char *>(
 	             &GurobiModelMixin::add_linear_constraint_from_var),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraints_batch",
+	        [](GurobiModelMixin &model, IndexArray row_starts, IndexArray variables,
+	           CoeffArray coefficients, const Vector<ConstraintSense> &senses, CoeffArray rhss,
+	           const Vector<std::string> &names) {
+		        return model.add_linear_constraints({row_starts.data(), row_starts.shape(0)},
+		                                            {variables.data(), variables.shape(0)},
+		                                            {coefficients.data(), coefficients.shape(0)},
+		                                            senses, {rhss.data(), rhss.shape(0)}, names);
+	        },
+	        nb::arg("row_starts"), nb::arg("variables"), nb::arg("coefficients"), nb::arg("senses"),
+	        nb::arg("rhss"), nb::arg("names") = Vector<std::string>{})
 	    .def("add_linear_constraint",
 	         nb::overload_cast<const ExprBuilder &, ConstraintSense, CoeffT, const char *>(
 	             &GurobiModelMixin::add_linear_constraint_from_expr),
@@ -142,6 +167,11 @@ NB_MODULE(gurobi_model_ext, m)
 	             &GurobiModelMixin::cb_add_user_cut),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"))
 
+	    .def(
+	        "load_cache",
+	        [](GurobiModelMixin &model, const CacheModel &cache) { return cache.flush(model); },
+	        nb::arg("cache"))
+
 		.def("optimize", &GurobiModelMixin::optimize, nb::call_guard<nb::gil_scoped_release>())
 
 	    // clang-format off
@@ -162,6 +162,72 @@ VariableIndex POIHighsModel::add_variable(VariableDomain domain, double lb, doub
 	return variable;
 }
 
+VariableIndex POIHighsModel::add_variables(int N, const Vector<VariableDomain> &domains,
+                                           const Vector<double> &lbs, const Vector<double> &ubs,
+                                           const Vector<std::string> &names)
+{
+	check_batch_argument(domains, N, "domains");
+	check_batch_argument(lbs, N, "lbs");
+	check_batch_argument(ubs, N, "ubs");
+	check_batch_argument(names, N, "names");
+
+	std::vector<double> costs(N, 0.0);
+	std::vector<double> lb(N), ub(N);
+	std::vector<HighsInt> vtypes(N);
+	bool has_integer = false;
+	for (int i = 0; i < N; i++)
+	{
+		auto domain = get_batch_argument(domains, i, VariableDomain::Continuous);
+		lb[i] = get_batch_argument(lbs, i, -kHighsInf);
+		ub[i] = get_batch_argument(ubs, i, kHighsInf);
+		if (domain == VariableDomain::Binary)
+		{
+			lb[i] = 0.0;
+			ub[i] = 1.0;
+		}
+		vtypes[i] = highs_vtype(domain);
+		if (domain != VariableDomain::Continuous)
+		{
+			has_integer = true;
+		}
+	}
+
+	auto error = highs::Highs_addCols(m_model.get(), N, costs.data(), lb.data(), ub.data(), 0,
+	                                  nullptr, nullptr, nullptr);
+	check_error(error);
+
+	auto column = m_n_variables;
+	if (has_integer)
+	{
+		error = highs::Highs_changeColsIntegralityByRange(m_model.get(), column, column + N - 1,
+		                                                  vtypes.data());
+		check_error(error);
+	}
+
+	IndexT index = m_variable_index.add_indices(N);
+	VariableIndex variable(index);
+
+	const std::string empty_name;
+	for (int i = 0; i < N; i++)
+	{
+		if (get_batch_argument(domains, i, VariableDomain::Continuous) == VariableDomain::Binary)
+		{
+			binary_variables.insert(index + i);
+		}
+		if (!names.empty())
+		{
+			auto &name = get_batch_argument(names, i, empty_name);
+			if (!name.empty())
+			{
+				m_var_names.insert({index + i, name});
+			}
+		}
+	}
+
+	m_n_variables += N;
+	return variable;
+}
+
 void POIHighsModel::delete_variable(const VariableIndex &variable)
 {
 	if (!is_variable_active(variable))
@@ -186,26 +252,24 @@ void POIHighsModel::delete_variables(const Vector<VariableIndex> &variables)
 	if (n_variables == 0)
 		return;
 
-	std::vector<HighsInt> columns;
-	columns.reserve(n_variables);
+	std::vector<IndexT> indices(n_variables);
 	for (int i = 0; i < n_variables; i++)
 	{
-		if (!is_variable_active(variables[i]))
-		{
-			continue;
-		}
-		auto column = _variable_index(variables[i]);
-		columns.push_back(column);
+		indices[i] = variables[i].index;
 	}
+	std::vector<HighsInt> columns(n_variables);
+	_variable_indices(indices, columns);
+	// skip the variables that are not active
+	std::erase_if(columns, [](HighsInt column) { return column < 0; });
 
 	int error = highs::Highs_deleteColsBySet(m_model.get(), columns.size(), columns.data());
 	check_error(error);
 
 	for (int i = 0; i < n_variables; i++)
 	{
-		m_variable_index.delete_index(variables[i].index);
 		m_var_names.erase(variables[i].index);
 	}
+	m_variable_index.delete_indices(indices.data(), n_variables);
 	m_n_variables -= columns.size();
 }
 
@@ -224,6 +288,25 @@ double POIHighsModel::get_variable_value(const VariableIndex &variable)
 	throw std::runtime_error("No solution available");
 }
 
+void POIHighsModel::get_variable_values(std::span<const IndexT> variables,
+                                        std::span<double> values)
+{
+	if (variables.size() != values.size())
+	{
+		throw std::runtime_error("variables and values must have the same length");
+	}
+	if (m_solution.primal_solution_status == kHighsSolutionStatusNone)
+	{
+		throw std::runtime_error("No solution available");
+	}
+	std::vector<HighsInt> columns(variables.size());
+	_checked_variable_indices(variables, columns);
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		values[i] = m_solution.colvalue[columns[i]];
+	}
+}
+
 std::string POIHighsModel::pprint_variable(const VariableIndex &variable)
 {
 	return get_variable_name(variable);
@@ -279,6 +362,65 @@ ConstraintIndex POIHighsModel::add_linear_constraint(const ScalarAffineFunction
 	return constraint;
 }
 
+ConstraintIndex POIHighsModel::add_linear_constraints(std::span<const IndexT> row_starts,
+                                                      std::span<const IndexT> variables,
+                                                      std::span<const CoeffT> coefficients,
+                                                      const Vector<ConstraintSense> &senses,
+                                                      std::span<const CoeffT> rhss,
+                                                      const Vector<std::string> &names)
+{
+	CSRMatrixPtrForm<HighsInt, HighsInt, double> csr;
+	csr.make(this, row_starts, variables, coefficients);
+
+	HighsInt N = csr.numrows;
+	check_batch_argument(senses, N, "senses");
+	check_batch_argument(rhss, N, "rhss");
+	check_batch_argument(names, N, "names");
+
+	std::vector<double> lbs(N, -kHighsInf), ubs(N, kHighsInf);
+	for (HighsInt i = 0; i < N; i++)
+	{
+		auto sense = get_batch_argument(senses, i, ConstraintSense::Equal);
+		double g_rhs = get_batch_argument(rhss, i, 0.0);
+		switch (sense)
+		{
+		case ConstraintSense::LessEqual:
+			ubs[i] = g_rhs;
+			break;
+		case ConstraintSense::GreaterEqual:
+			lbs[i] = g_rhs;
+			break;
+		case ConstraintSense::Equal:
+			lbs[i] = g_rhs;
+			ubs[i] = g_rhs;
+			break;
+		}
+	}
+
+	auto error = highs::Highs_addRows(m_model.get(), N, lbs.data(), ubs.data(), csr.numnz,
+	                                  csr.start, csr.index, csr.value);
+	check_error(error);
+
+	IndexT index = m_linear_constraint_index.add_indices(N);
+	ConstraintIndex constraint(ConstraintType::Linear, index);
+
+	if (!names.empty())
+	{
+		for (HighsInt i = 0; i < N; i++)
+		{
+			auto &name = get_batch_argument(names, i, names[0]);
+			if (!name.empty())
+			{
+				m_con_names.insert({index + i, name});
+			}
+		}
+	}
+
+	m_n_constraints += N;
+
+	return constraint;
+}
+
 ConstraintIndex POIHighsModel::add_quadratic_constraint(const ScalarQuadraticFunction &function,
                                                         ConstraintSense sense, CoeffT rhs,
                                                         const char *name)
@@ -742,6 +884,24 @@ double POIHighsModel::get_constraint_dual(const ConstraintIndex &constraint)
 	throw std::runtime_error("No solution available");
 }
 
+void POIHighsModel::get_constraint_duals(std::span<const IndexT> constraints,
+                                         std::span<double> values)
+{
+	if (constraints.size() != values.size())
+	{
+		throw std::runtime_error("constraints and values must have the same length");
+	}
+	if (m_solution.primal_solution_status == kHighsSolutionStatusNone)
+	{
+		throw std::runtime_error("No solution available");
+	}
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		auto row = _checked_constraint_index({ConstraintType::Linear, constraints[i]});
+		values[i] = m_solution.rowdual[row];
+	}
+}
+
 ObjectiveSense POIHighsModel::get_obj_sense()
 {
 	HighsInt obj_sense;
@@ -779,6 +939,25 @@ HighsInt POIHighsModel::_checked_variable_index(const VariableIndex &variable)
 	return column;
 }
 
+void POIHighsModel::_variable_indices(std::span<const IndexT> variables,
+                                     std::span<HighsInt> columns)
+{
+	m_variable_index.get_indices(variables.data(), columns.data(), variables.size());
+}
+
+void POIHighsModel::_checked_variable_indices(std::span<const IndexT> variables,
+                                               std::span<HighsInt> columns)
+{
+	_variable_indices(variables, columns);
+	for (auto column : columns)
+	{
+		if (column < 0)
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+}
+
 HighsInt POIHighsModel::_constraint_index(const ConstraintIndex &constraint)
 {
 	switch (constraint.type)
@@ -3,6 +3,8 @@
 #include <nanobind/stl/vector.h>
 
 #include "pyoptinterface/highs_model.hpp"
+#include "pyoptinterface/cache_model.hpp"
+#include "pyoptinterface/numpy_helper.hpp"
 
 namespace nb = nanobind;
 
@@ -47,6 +49,9 @@ NB_MODULE(highs_model_ext, m)
 	    .def("add_variable", &HighsModelMixin::add_variable,
 	         nb::arg("domain") = VariableDomain::Continuous, nb::arg("lb") = -kHighsInf,
 	         nb::arg("ub") = kHighsInf, nb::arg("name") = "")
+	    .def("add_variables_batch", &HighsModelMixin::add_variables, nb::arg("N"),
+	         nb::arg("domains") = Vector<VariableDomain>{}, nb::arg("lbs") = Vector<double>{},
+	         nb::arg("ubs") = Vector<double>{}, nb::arg("names") = Vector<std::string>{})
 	    // clang-format off
 	    BIND_F(delete_variable)
 	    BIND_F(delete_variables)
@@ -61,6 +66,14 @@ NB_MODULE(highs_model_ext, m)
 	                          &HighsModelMixin::get_expression_value))
 	    .def("get_value",
 	         nb::overload_cast<const ExprBuilder &>(&HighsModelMixin::get_expression_value))
+	    .def("get_variable_values", &get_variable_values_array<HighsModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_variable_values", &get_variable_values_list<HighsModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_constraint_duals", &get_constraint_duals_array<HighsModelMixin>,
+	         nb::arg("constraints"))
+	    .def("get_constraint_duals", &get_constraint_duals_list<HighsModelMixin>,
+	         nb::arg("constraints"))
 
 	    .def("pprint", &HighsModelMixin::pprint_variable)
 	    .def("pprint",
@@ -83,6 +96,18 @@ NB_MODULE(highs_model_ext, m)
 	         nb::overload_cast<const VariableIndex &, ConstraintSense, CoeffT, const char *>(
 	             &HighsModelMixin::add_linear_constraint_from_var),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraints_batch",
+	        [](HighsModelMixin &model, IndexArray row_starts, IndexArray variables,
+	           CoeffArray coefficients, const Vector<ConstraintSense> &senses, CoeffArray rhss,
+	           const Vector<std::string> &names) {
+		        return model.add_linear_constraints({row_starts.data(), row_starts.shape(0)},
+		                                            {variables.data(), variables.shape(0)},
+		                                            {coefficients.data(), coefficients.shape(0)},
+		                                            senses, {rhss.data(), rhss.shape(0)}, names);
+	        },
+	        nb::arg("row_starts"), nb::arg("variables"), nb::arg("coefficients"), nb::arg("senses"),
+	        nb::arg("rhss"), nb::arg("names") = Vector<std::string>{})
 	    .def("add_linear_constraint",
 	         nb::overload_cast<const ExprBuilder &, ConstraintSense, CoeffT, const char *>(
 	             &HighsModelMixin::add_linear_constraint_from_expr),
@@ -106,6 +131,11 @@ NB_MODULE(highs_model_ext, m)
 	         nb::overload_cast<CoeffT, ObjectiveSense>(&HighsModelMixin::set_objective_as_constant),
 	         nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
 
+	    .def(
+	        "load_cache",
+	        [](HighsModelMixin &model, const CacheModel &cache) { return cache.flush(model); },
+	        nb::arg("cache"))
+
 	    .def("optimize", &HighsModelMixin::optimize, nb::call_guard<nb::gil_scoped_release>())
 
 	    // clang-format off
@@ -90,17 +90,20 @@ double IpoptModel::get_variable_ub(const VariableIndex &variable)
 void IpoptModel::set_variable_lb(const VariableIndex &variable, double lb)
 {
 	m_var_lb[variable.index] = lb;
+	m_bounds_changed = true;
 }
 
 void IpoptModel::set_variable_ub(const VariableIndex &variable, double ub)
 {
 	m_var_ub[variable.index] = ub;
+	m_bounds_changed = true;
 }
 
 void IpoptModel::set_variable_bounds(const VariableIndex &variable, double lb, double ub)
 {
 	m_var_lb[variable.index] = lb;
 	m_var_ub[variable.index] = ub;
+	m_bounds_changed = true;
 }
 
 double IpoptModel::get_variable_start(const VariableIndex &variable)
@@ -333,6 +336,24 @@ FunctionIndex IpoptModel::register_function(ADFunD &f, const std::string &name,
 	return m_function_model.register_function(f, name, x_values, p_values);
 }
 
+FunctionIndex IpoptModel::register_function_from_analysis(ADFunD &f, const std::string &name,
+                                                          const std::string &analysis)
+{
+	return m_function_model.register_function_from_analysis(f, name, analysis);
+}
+
+FunctionIndex IpoptModel::register_function_deferred(ADFunD &f, const std::string &name,
+                                                     const std::vector<double> &x_values,
+                                                     const std::vector<double> &p_values)
+{
+	return m_function_model.register_function_deferred(f, name, x_values, p_values);
+}
+
+void IpoptModel::initialize_deferred_functions()
+{
+	m_function_model.initialize_deferred_functions();
+}
+
 NLConstraintIndex IpoptModel::add_empty_nl_constraint(int dim, ConstraintSense sense,
                                                       const std::vector<double> &rhss)
 {
@@ -571,21 +592,55 @@ void IpoptModel::clear_nl_objective()
 	m_function_model.clear_nl_objective();
 }
 
+// every evaluation at a new x invalidates the cached values
+static void invalidate_evaluations(IpoptModel &model)
+{
+	model.m_eval_cache.new_x();
+	model.m_function_model.new_x();
+}
+
 static bool eval_f(ipindex n, ipnumber *x, bool new_x, ipnumber *obj_value, UserDataPtr user_data)
 {
 	IpoptModel &model = *static_cast<IpoptModel *>(user_data);
+	auto &cache = model.m_eval_cache;
+	if (new_x)
+		invalidate_evaluations(model);
+	if (cache.has_obj)
+	{
+		cache.hits++;
+		obj_value[0] = cache.obj;
+		return true;
+	}
+	cache.misses++;
 	obj_value[0] = 0.0;
 	model.m_function_model.eval_objective(x, obj_value);
 	model.m_lq_model.eval_objective(x, obj_value);
+	cache.obj = obj_value[0];
+	cache.has_obj = true;
 	return true;
 }
 
 static bool eval_grad_f(ipindex n, ipnumber *x, bool new_x, ipnumber *grad_f, UserDataPtr user_data)
 {
 	IpoptModel &model = *static_cast<IpoptModel *>(user_data);
+	auto &cache = model.m_eval_cache;
+	if (new_x)
+		invalidate_evaluations(model);
+	if (cache.has_grad)
+	{
+		cache.hits++;
+		std::copy(cache.grad.begin(), cache.grad.end(), grad_f);
+		return true;
+	}
+	cache.misses++;
 	std::fill(grad_f, grad_f + n, 0.0);
 	model.m_function_model.eval_objective_gradient(x, grad_f);
 	model.m_lq_model.eval_objective_gradient(x, grad_f);
+	if (cache.store_after_miss(cache.computed_grad))
+	{
+		cache.grad.assign(grad_f, grad_f + n);
+		cache.has_grad = true;
+	}
 	return true;
 }
 
@@ -593,9 +648,24 @@ static bool eval_g(ipindex n, ipnumber *x, bool new_x, ipindex m, ipnumber *g,
                    UserDataPtr user_data)
 {
 	IpoptModel &model = *static_cast<IpoptModel *>(user_data);
+	auto &cache = model.m_eval_cache;
+	if (new_x)
+		invalidate_evaluations(model);
+	if (cache.has_g)
+	{
+		cache.hits++;
+		std::copy(cache.g.begin(), cache.g.end(), g);
+		return true;
+	}
+	cache.misses++;
 	std::fill(g, g + m, 0.0);
 	model.m_function_model.eval_constraint(x, g);
 	model.m_lq_model.eval_constraint(x, g);
+	if (cache.store_after_miss(cache.computed_g))
+	{
+		cache.g.assign(g, g + m);
+		cache.has_g = true;
+	}
 	return true;
 }
 
@@ -612,9 +682,24 @@ static bool eval_jac_g(ipindex n, ipnumber *x, bool new_x, ipindex m, ipindex ne
 	}
 	else
 	{
-		std::fill(values, values + nele_jac, 0.0);
+		auto &cache = model.m_eval_cache;
+		if (new_x)
+			invalidate_evaluations(model);
+		if (cache.has_jacobian)
+		{
+			cache.hits++;
+			std::copy(cache.jacobian.begin(), cache.jacobian.end(), values);
+			return true;
+		}
+		cache.misses++;
+		// every nonzero of the jacobian is written exactly once, values is not zeroed
 		model.m_function_model.eval_constraint_jacobian(x, values);
 		model.m_lq_model.eval_constraint_jacobian(x, values);
+		if (cache.store_after_miss(cache.computed_jacobian))
+		{
+			cache.jacobian.assign(values, values + nele_jac);
+			cache.has_jacobian = true;
+		}
 	}
 	return true;
 }
@@ -633,41 +718,111 @@ static bool eval_h(ipindex n, ipnumber *x, bool new_x, ipnumber obj_factor, ipin
 	}
 	else
 	{
-		std::fill(values, values + nele_hess, 0.0);
+		// the hessian depends on lambda and obj_factor, it is not cached
+		if (new_x)
+			invalidate_evaluations(model);
+		// the nonlinear functions accumulate into [0, hessian_nnz), the quadratic part initializes
+		// the nonzeros only it touches
+		std::fill(values, values + model.m_function_model.hessian_nnz, 0.0);
 		model.m_function_model.eval_lagrangian_hessian(x, &obj_factor, lambda, values);
 		model.m_lq_model.eval_lagrangian_hessian(x, &obj_factor, lambda, values);
 	}
 	return true;
 }
 
-void IpoptModel::optimize()
+void IpoptModel::analyze_structure()
 {
-	// analyze structure
+	m_jacobian_nnz = 0;
+	m_jacobian_rows.clear();
+	m_jacobian_cols.clear();
+
 	m_function_model.analyze_active_functions();
 	m_function_model.analyze_dense_gradient_structure();
 	m_function_model.analyze_jacobian_structure(m_jacobian_nnz, m_jacobian_rows, m_jacobian_cols);
-	m_function_model.analyze_hessian_structure(m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-	                                           m_hessian_index_map, HessianSparsityType::Lower);
+	m_function_model.analyze_fused_structure();
 
 	m_lq_model.analyze_dense_gradient_structure();
 	m_lq_model.analyze_jacobian_structure(m_jacobian_nnz, m_jacobian_rows, m_jacobian_cols);
-	m_lq_model.analyze_hessian_structure(m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-	                                     m_hessian_index_map, HessianSparsityType::Lower);
 
-	/*fmt::print("Problem has {} variables and {} constraints\n", n_variables, n_constraints);
-	fmt::print("Jacobian has {} nonzeros\n", m_jacobian_nnz);
-	fmt::print("Jacobian rows : {}\n", m_jacobian_rows);
-	fmt::print("Jacobian cols : {}\n", m_jacobian_cols);
-	fmt::print("Hessian has {} nonzeros\n", m_hessian_nnz);
-	fmt::print("Hessian rows : {}\n", m_hessian_rows);
-	fmt::print("Hessian cols : {}\n", m_hessian_cols);*/
+	// the entries of both parts are collected first and merged at once
+	HessianStructureBuilder hessian_builder(HessianSparsityType::Lower);
+	m_function_model.analyze_hessian_structure(hessian_builder);
+	size_t n_nl_hessian_entries = hessian_builder.keys.size();
+	m_lq_model.analyze_hessian_structure(hessian_builder);
+	hessian_builder.build(m_function_model.thread_pool.get(), m_hessian_nnz, m_hessian_rows,
+	                      m_hessian_cols);
+	m_lq_model.partition_hessian_structure(hessian_builder, n_nl_hessian_entries, m_hessian_rows,
+	                                       m_hessian_cols);
+	m_function_model.assign_hessian_indices(hessian_builder);
+	m_lq_model.assign_hessian_indices(hessian_builder);
+
+	m_structure_analyzed = true;
+	m_analyzed_nl_version = m_function_model.structure_version;
+	m_analyzed_lq_version = m_lq_model.structure_version;
+	m_analyzed_n_variables = n_variables;
+	m_analyzed_n_constraints = n_constraints;
+}
+
+bool IpoptModel::prepare_structure()
+{
+	m_function_model.initialize_deferred_functions();
+
+	// Only parameters, bounds and starting points change between the solves of a parametric
+	// problem, the sparsity patterns and m_problem of the previous solve are reused then
+	bool structure_changed = !m_structure_analyzed ||
+	                         m_analyzed_nl_version != m_function_model.structure_version ||
+	                         m_analyzed_lq_version != m_lq_model.structure_version ||
+	                         m_analyzed_n_variables != n_variables ||
+	                         m_analyzed_n_constraints != n_constraints;
+	if (structure_changed)
+	{
+		analyze_structure();
+		m_eval_cache.reset();
+		// m_problem has the sizes of the old structure
+		m_problem.reset();
+	}
+	return structure_changed;
+}
+
+void IpoptModel::optimize()
+{
+	prepare_structure();
+	m_eval_cache.reset();
 
-	auto problem_ptr =
-	    ipopt::CreateIpoptProblem(n_variables, m_var_lb.data(), m_var_ub.data(), n_constraints,
-	                              m_con_lb.data(), m_con_ub.data(), m_jacobian_nnz, m_hessian_nnz,
-	                              0, &eval_f, &eval_g, &eval_grad_f, &eval_jac_g, &eval_h);
+	if (m_bounds_changed || !m_problem)
+	{
+		/*fmt::print("Problem has {} variables and {} constraints\n", n_variables, n_constraints);
+		fmt::print("Jacobian has {} nonzeros\n", m_jacobian_nnz);
+		fmt::print("Jacobian rows : {}\n", m_jacobian_rows);
+		fmt::print("Jacobian cols : {}\n", m_jacobian_cols);
+		fmt::print("Hessian has {} nonzeros\n", m_hessian_nnz);
+		fmt::print("Hessian rows : {}\n", m_hessian_rows);
+		fmt::print("Hessian cols : {}\n", m_hessian_cols);*/
+
+		auto problem_ptr = ipopt::CreateIpoptProblem(
+		    n_variables, m_var_lb.data(), m_var_ub.data(), n_constraints, m_con_lb.data(),
+		    m_con_ub.data(), m_jacobian_nnz, m_hessian_nnz, 0, &eval_f, &eval_g, &eval_grad_f,
+		    &eval_jac_g, &eval_h);
+
+		m_problem = std::unique_ptr<IpoptProblemInfo, IpoptfreeproblemT>(problem_ptr);
+		m_bounds_changed = false;
+	}
+	auto problem_ptr = m_problem.get();
 
-	m_problem = std::unique_ptr<IpoptProblemInfo, IpoptfreeproblemT>(problem_ptr);
+	// warm_start_init_point set by the user takes precedence over set_warm_start, and the starting
+	// point is only kept if there is one
+	bool warm_start = m_warm_start;
+	auto warm_start_option = m_options_str.find("warm_start_init_point");
+	if (warm_start_option != m_options_str.end())
+	{
+		warm_start = warm_start_option->second == "yes";
+	}
+	else
+	{
+		ipopt::AddIpoptStrOption(problem_ptr, (char *)"warm_start_init_point",
+		                         (char *)(warm_start && m_has_warm_start_point ? "yes" : "no"));
+	}
+	warm_start = warm_start && m_has_warm_start_point;
 
 	// set options
 	for (auto &[key, value] : m_options_int)
@@ -696,16 +851,102 @@ void IpoptModel::optimize()
 		}
 	}
 
-	// initialize the solution
+	// initialize the solution, a warm start keeps the values of the previous point
+	size_t n_start_variables = warm_start ? std::min(m_result.x.size(), n_variables) : 0;
+	size_t n_start_constraints = warm_start ? std::min(m_result.mult_g.size(), n_constraints) : 0;
 	m_result.x.resize(n_variables);
-	std::copy(m_var_init.begin(), m_var_init.end(), m_result.x.begin());
+	std::copy(m_var_init.begin() + n_start_variables, m_var_init.end(),
+	          m_result.x.begin() + n_start_variables);
 	m_result.mult_x_L.resize(n_variables);
 	m_result.mult_x_U.resize(n_variables);
+	std::fill(m_result.mult_x_L.begin() + n_start_variables, m_result.mult_x_L.end(), 0.0);
+	std::fill(m_result.mult_x_U.begin() + n_start_variables, m_result.mult_x_U.end(), 0.0);
 	m_result.g.resize(n_constraints);
 	m_result.mult_g.resize(n_constraints);
+	std::fill(m_result.mult_g.begin() + n_start_constraints, m_result.mult_g.end(), 0.0);
 	m_status = ipopt::IpoptSolve(problem_ptr, m_result.x.data(), m_result.g.data(),
 	                             &m_result.obj_val, m_result.mult_g.data(),
 	                             m_result.mult_x_L.data(), m_result.mult_x_U.data(), (void *)this);
+	// the point of a failed solve is not a good start for the next one
+	m_has_warm_start_point = m_status == ApplicationReturnStatus::Solve_Succeeded ||
+	                         m_status == ApplicationReturnStatus::Solved_To_Acceptable_Level ||
+	                         m_status == ApplicationReturnStatus::Feasible_Point_Found;
+}
+
+static void check_evaluation_point(const IpoptModel &model, const std::vector<double> &x)
+{
+	if (x.size() != model.n_variables)
+	{
+		throw std::runtime_error(
+		    fmt::format("x must have {} elements, got {}", model.n_variables, x.size()));
+	}
+}
+
+double IpoptModel::eval_objective(const std::vector<double> &x, bool new_x)
+{
+	check_evaluation_point(*this, x);
+	prepare_structure();
+	double obj_value;
+	eval_f(n_variables, (ipnumber *)x.data(), new_x, &obj_value, this);
+	return obj_value;
+}
+
+std::vector<double> IpoptModel::eval_objective_gradient(const std::vector<double> &x, bool new_x)
+{
+	check_evaluation_point(*this, x);
+	prepare_structure();
+	std::vector<double> grad_f(n_variables);
+	eval_grad_f(n_variables, (ipnumber *)x.data(), new_x, grad_f.data(), this);
+	return grad_f;
+}
+
+std::vector<double> IpoptModel::eval_constraints(const std::vector<double> &x, bool new_x)
+{
+	check_evaluation_point(*this, x);
+	prepare_structure();
+	std::vector<double> g(n_constraints);
+	eval_g(n_variables, (ipnumber *)x.data(), new_x, n_constraints, g.data(), this);
+	return g;
+}
+
+std::vector<double> IpoptModel::eval_constraint_jacobian(const std::vector<double> &x, bool new_x)
+{
+	check_evaluation_point(*this, x);
+	prepare_structure();
+	std::vector<double> values(m_jacobian_nnz);
+	eval_jac_g(n_variables, (ipnumber *)x.data(), new_x, n_constraints, m_jacobian_nnz, nullptr,
+	           nullptr, values.data(), this);
+	return values;
+}
+
+std::vector<double> IpoptModel::eval_lagrangian_hessian(const std::vector<double> &x,
+                                                        double obj_factor,
+                                                        const std::vector<double> &lambda,
+                                                        bool new_x)
+{
+	check_evaluation_point(*this, x);
+	if (lambda.size() != n_constraints)
+	{
+		throw std::runtime_error(
+		    fmt::format("lambda must have {} elements, got {}", n_constraints, lambda.size()));
+	}
+	prepare_structure();
+	std::vector<double> values(m_hessian_nnz);
+	eval_h(n_variables, (ipnumber *)x.data(), new_x, obj_factor, n_constraints,
+	       (ipnumber *)lambda.data(), true, m_hessian_nnz, nullptr, nullptr, values.data(), this);
+	return values;
+}
+
+std::tuple<std::vector<size_t>, std::vector<size_t>> IpoptModel::get_jacobian_structure()
+{
+	prepare_structure();
+	return {m_jacobian_rows, m_jacobian_cols};
+}
+
+std::tuple<std::vector<size_t>, std::vector<size_t>> IpoptModel::get_hessian_structure()
+{
+	prepare_structure();
+	return {m_hessian_rows, m_hessian_cols};
 }
 
 void IpoptModel::set_raw_option_int(const std::string &name, int value)
@@ -722,3 +963,76 @@ void IpoptModel::set_raw_option_string(const std::string &name, const std::strin
 {
 	m_options_str[name] = value;
 }
+
+int IpoptModel::get_n_threads() const
+{
+	return m_function_model.get_n_threads();
+}
+
+void IpoptModel::set_compensated_objective_sum(bool enable)
+{
+	m_function_model.compensated_objective_sum = enable;
+}
+
+bool IpoptModel::get_compensated_objective_sum() const
+{
+	return m_function_model.compensated_objective_sum;
+}
+
+void IpoptModel::set_warm_start(bool enable)
+{
+	m_warm_start = enable;
+}
+
+bool IpoptModel::get_warm_start() const
+{
+	return m_warm_start;
+}
+
+std::tuple<std::vector<double>, std::vector<double>, std::vector<double>, std::vector<double>>
+IpoptModel::get_warm_start_point() const
+{
+	return {m_result.x, m_result.mult_g, m_result.mult_x_L, m_result.mult_x_U};
+}
+
+void IpoptModel::set_warm_start_point(const std::vector<double> &x,
+                                      const std::vector<double> &mult_g,
+                                      const std::vector<double> &mult_x_L,
+                                      const std::vector<double> &mult_x_U)
+{
+	if (x.size() != n_variables || mult_x_L.size() != n_variables ||
+	    mult_x_U.size() != n_variables)
+	{
+		throw std::runtime_error(
+		    fmt::format("The warm start point must have {} variables", n_variables));
+	}
+	if (mult_g.size() != n_constraints)
+	{
+		throw std::runtime_error(
+		    fmt::format("The warm start point must have {} constraints", n_constraints));
+	}
+	m_result.x = x;
+	m_result.mult_g = mult_g;
+	m_result.mult_x_L = mult_x_L;
+	m_result.mult_x_U = mult_x_U;
+	m_has_warm_start_point = true;
+}
+
+size_t IpoptModel::get_eval_cache_hits() const
+{
+	return m_eval_cache.hits;
+}
+
+size_t IpoptModel::get_eval_cache_misses() const
+{
+	return m_eval_cache.misses;
+}
+
+void IpoptModel::set_n_threads(int n_threads)
+{
+	if (n_threads < 1)
+	{
+		throw std::runtime_error("The number of threads must be positive");
+	}
+	m_function_model.set_n_threads(n_threads);
+}
@@ -1,6 +1,7 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/vector.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/tuple.h>
 
 namespace nb = nanobind;
 
@@ -159,6 +160,16 @@ NB_MODULE(ipopt_model_ext, m)
 
 	    .def("_register_function", &IpoptModel::register_function, nb::arg("f"), nb::arg("name"),
 	         nb::arg("var"), nb::arg("param"))
+	    .def(
+	        "_register_function_from_analysis",
+	        [](IpoptModel &m, ADFunD &f, const std::string &name, nb::bytes analysis) {
+		        return m.register_function_from_analysis(
+		            f, name, std::string(analysis.c_str(), analysis.size()));
+	        },
+	        nb::arg("f"), nb::arg("name"), nb::arg("analysis"))
+	    .def("_register_function_deferred", &IpoptModel::register_function_deferred, nb::arg("f"),
+	         nb::arg("name"), nb::arg("var"), nb::arg("param"))
+	    .def("_initialize_deferred_functions", &IpoptModel::initialize_deferred_functions)
 
 	    .def("add_empty_nl_constraint",
 	         nb::overload_cast<int, ConstraintSense, const std::vector<double> &>(
@@ -220,7 +231,30 @@ NB_MODULE(ipopt_model_ext, m)
 	         nb::arg("constraint"), nb::arg("f"), nb::arg("var"))
 
 	    .def("_optimize", &IpoptModel::optimize, nb::call_guard<nb::gil_scoped_release>())
+	    .def("eval_objective", &IpoptModel::eval_objective, nb::arg("x"), nb::arg("new_x") = true)
+	    .def("eval_objective_gradient", &IpoptModel::eval_objective_gradient, nb::arg("x"),
+	         nb::arg("new_x") = true)
+	    .def("eval_constraints", &IpoptModel::eval_constraints, nb::arg("x"),
+	         nb::arg("new_x") = true)
+	    .def("eval_constraint_jacobian", &IpoptModel::eval_constraint_jacobian, nb::arg("x"),
+	         nb::arg("new_x") = true)
+	    .def("eval_lagrangian_hessian", &IpoptModel::eval_lagrangian_hessian, nb::arg("x"),
+	         nb::arg("obj_factor"), nb::arg("lambda"), nb::arg("new_x") = true)
+	    .def("get_jacobian_structure", &IpoptModel::get_jacobian_structure)
+	    .def("get_hessian_structure", &IpoptModel::get_hessian_structure)
 	    .def("set_raw_option_int", &IpoptModel::set_raw_option_int)
 	    .def("set_raw_option_double", &IpoptModel::set_raw_option_double)
-	    .def("set_raw_option_string", &IpoptModel::set_raw_option_string);
+	    .def("set_raw_option_string", &IpoptModel::set_raw_option_string)
+
+	    .def("get_n_threads", &IpoptModel::get_n_threads)
+	    .def("set_n_threads", &IpoptModel::set_n_threads)
+	    .def("set_compensated_objective_sum", &IpoptModel::set_compensated_objective_sum)
+	    .def("get_compensated_objective_sum", &IpoptModel::get_compensated_objective_sum)
+	    .def("set_warm_start", &IpoptModel::set_warm_start)
+	    .def("get_warm_start", &IpoptModel::get_warm_start)
+	    .def("get_warm_start_point", &IpoptModel::get_warm_start_point)
+	    .def("set_warm_start_point", &IpoptModel::set_warm_start_point, nb::arg("x"),
+	         nb::arg("mult_g"), nb::arg("mult_x_L"), nb::arg("mult_x_U"))
+	    .def("get_eval_cache_hits", &IpoptModel::get_eval_cache_hits)
+	    .def("get_eval_cache_misses", &IpoptModel::get_eval_cache_misses);
 }
@@ -56,22 +56,15 @@ void QuadraticFunctionPtrForm<MSKint32t, MSKint32t, MSKrealt>::make<MOSEKModel>(
 	numnz = f_numnz;
 	row_storage.resize(numnz);
 	col_storage.resize(numnz);
+	model->_variable_indices(function.variable_1s, row_storage);
+	model->_variable_indices(function.variable_2s, col_storage);
 	for (int i = 0; i < numnz; ++i)
 	{
-		auto v1 = model->_variable_index(function.variable_1s[i]);
-		auto v2 = v1;
-		if (function.variable_1s[i] != function.variable_2s[i])
+		// MOSEK only accepts the lower triangle (i >= j)
+		if (row_storage[i] < col_storage[i])
 		{
-			v2 = model->_variable_index(function.variable_2s[i]);
-			// MOSEK only accepts the lower triangle (i >= j)
-			if (v1 < v2)
-			{
-				std::swap(v1, v2);
-			}
+			std::swap(row_storage[i], col_storage[i]);
 		}
-
-		row_storage[i] = v1;
-		col_storage[i] = v2;
 	}
 	row = row_storage.data();
 	col = col_storage.data();
@@ -246,63 +239,85 @@ VariableIndex MOSEKModel::add_variable(VariableDomain domain, double lb, double
 	return variable;
 }
 
-// VariableIndex MOSEKModel::add_variables(int N, VariableDomain domain, double lb, double ub)
-//{
-//	IndexT index = m_variable_index.add_indices(N);
-//	VariableIndex variable(index);
-//
-//	auto error = MSK_appendvars(m_model.get(), N);
-//	check_error(error);
-//
-//	MSKint32t column;
-//	error = MSK_getnumvar(m_model.get(), &column);
-//	check_error(error);
-//	// 0-based indexing
-//	column -= N;
-//	std::vector<MSKint32t> columns(N);
-//	for (int i = 0; i < N; i++)
-//	{
-//		columns[i] = column + i;
-//	}
-//
-//	MSKvariabletypee vtype = mosek_vtype(domain);
-//	std::vector<MSKvariabletypee> vtypes(N, vtype);
-//	error = MSK_putvartypelist(m_model.get(), N, columns.data(), vtypes.data());
-//	check_error(error);
-//
-//	MSKboundkeye bk;
-//	if (domain == VariableDomain::Binary)
-//	{
-//		bk = MSK_BK_RA;
-//		lb = 0.0;
-//		ub = 1.0;
-//		for (int i = 0; i < N; i++)
-//		{
-//			binary_variables.insert(index + i);
-//		}
-//	}
-//	else
-//	{
-//		bool lb_inf = lb < 1.0 - MSK_INFINITY;
-//		bool ub_inf = ub > MSK_INFINITY - 1.0;
-//		if (lb_inf && ub_inf)
-//			bk = MSK_BK_FR;
-//		else if (lb_inf)
-//			bk = MSK_BK_UP;
-//		else if (ub_inf)
-//			bk = MSK_BK_LO;
-//		else
-//			bk = MSK_BK_RA;
-//	}
-//	std::vector<MSKboundkeye> bks(N, bk);
-//	std::vector<MSKrealt> lbs(N, lb);
-//	std::vector<MSKrealt> ubs(N, ub);
-//	error =
-//	    MSK_putvarboundlist(m_model.get(), N, columns.data(), bks.data(), lbs.data(), ubs.data());
-//	check_error(error);
-//
-//	return variable;
-// }
+VariableIndex MOSEKModel::add_variables(int N, const Vector<VariableDomain> &domains,
+                                        const Vector<double> &lbs, const Vector<double> &ubs,
+                                        const Vector<std::string> &names)
+{
+	check_batch_argument(domains, N, "domains");
+	check_batch_argument(lbs, N, "lbs");
+	check_batch_argument(ubs, N, "ubs");
+	check_batch_argument(names, N, "names");
+
+	auto error = mosek::MSK_appendvars(m_model.get(), N);
+	check_error(error);
+
+	MSKint32t column;
+	error = mosek::MSK_getnumvar(m_model.get(), &column);
+	check_error(error);
+	// 0-based indexing
+	column -= N;
+
+	IndexT index = m_variable_index.add_indices(N);
+	VariableIndex variable(index);
+
+	std::vector<MSKint32t> columns(N);
+	std::vector<MSKvariabletypee> vtypes(N);
+	std::vector<MSKboundkeye> bks(N);
+	std::vector<MSKrealt> bls(N), bus(N);
+	for (int i = 0; i < N; i++)
+	{
+		auto domain = get_batch_argument(domains, i, VariableDomain::Continuous);
+		double lb = get_batch_argument(lbs, i, -MSK_INFINITY);
+		double ub = get_batch_argument(ubs, i, MSK_INFINITY);
+
+		columns[i] = column + i;
+		vtypes[i] = mosek_vtype(domain);
+		if (domain == VariableDomain::Binary)
+		{
+			bks[i] = MSK_BK_RA;
+			lb = 0.0;
+			ub = 1.0;
+			binary_variables.insert(index + i);
+		}
+		else
+		{
+			bool lb_inf = lb < 1.0 - MSK_INFINITY;
+			bool ub_inf = ub > MSK_INFINITY - 1.0;
+			if (lb_inf && ub_inf)
+				bks[i] = MSK_BK_FR;
+			else if (lb_inf)
+				bks[i] = MSK_BK_UP;
+			else if (ub_inf)
+				bks[i] = MSK_BK_LO;
+			else
+				bks[i] = MSK_BK_RA;
+		}
+		bls[i] = lb;
+		bus[i] = ub;
+	}
+
+	error = mosek::MSK_putvartypelist(m_model.get(), N, columns.data(), vtypes.data());
+	check_error(error);
+
+	error = mosek::MSK_putvarboundslice(m_model.get(), column, column + N, bks.data(), bls.data(),
+	                                    bus.data());
+	check_error(error);
+
+	if (!names.empty())
+	{
+		for (int i = 0; i < N; i++)
+		{
+			auto &name = get_batch_argument(names, i, names[0]);
+			if (!name.empty())
+			{
+				error = mosek::MSK_putvarname(m_model.get(), column + i, name.c_str());
+				check_error(error);
+			}
+		}
+	}
+
+	return variable;
+}
 
 void MOSEKModel::delete_variable(const VariableIndex &variable)
 {
@@ -325,25 +340,20 @@ void MOSEKModel::delete_variables(const Vector<VariableIndex> &variables)
 	if (n_variables == 0)
 		return;
 
-	std::vector<MSKint32t> columns;
-	columns.reserve(n_variables);
+	std::vector<IndexT> indices(n_variables);
 	for (int i = 0; i < n_variables; i++)
 	{
-		if (!is_variable_active(variables[i]))
-		{
-			continue;
-		}
-		auto column = _variable_index(variables[i]);
-		columns.push_back(column);
+		indices[i] = variables[i].index;
 	}
+	std::vector<MSKint32t> columns(n_variables);
+	_variable_indices(indices, columns);
+	// skip the variables that are not active
+	std::erase_if(columns, [](MSKint32t column) { return column < 0; });
 
 	auto error = mosek::MSK_removevars(m_model.get(), columns.size(), columns.data());
 	check_error(error);
 
-	for (int i = 0; i < n_variables; i++)
-	{
-		m_variable_index.delete_index(variables[i].index);
-	}
+	m_variable_index.delete_indices(indices.data(), n_variables);
 }
 
 bool MOSEKModel::is_variable_active(const VariableIndex &variable)
@@ -361,6 +371,30 @@ double MOSEKModel::get_variable_value(const VariableIndex &variable)
 	return retval;
 }
 
+void MOSEKModel::get_variable_values(std::span<const IndexT> variables, std::span<double> values)
+{
+	if (variables.size() != values.size())
+	{
+		throw std::runtime_error("variables and values must have the same length");
+	}
+	MSKint32t numvar;
+	auto error = mosek::MSK_getnumvar(m_model.get(), &numvar);
+	check_error(error);
+
+	// fetch the whole solution once and gather the values
+	std::vector<MSKrealt> xx(numvar);
+	auto soltype = get_current_solution();
+	error = mosek::MSK_getxxslice(m_model.get(), soltype, 0, numvar, xx.data());
+	check_error(error);
+
+	std::vector<MSKint32t> columns(variables.size());
+	_checked_variable_indices(variables, columns);
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		values[i] = xx[columns[i]];
+	}
+}
+
 std::string MOSEKModel::pprint_variable(const VariableIndex &variable)
 {
 	return get_variable_name(variable);
@@ -409,6 +443,64 @@ ConstraintIndex MOSEKModel::add_linear_constraint(const ScalarAffineFunction &fu
 	return constraint_index;
 }
 
+ConstraintIndex MOSEKModel::add_linear_constraints(std::span<const IndexT> row_starts,
+                                                   std::span<const IndexT> variables,
+                                                   std::span<const CoeffT> coefficients,
+                                                   const Vector<ConstraintSense> &senses,
+                                                   std::span<const CoeffT> rhss,
+                                                   const Vector<std::string> &names)
+{
+	CSRMatrixPtrForm<MSKint32t, MSKint32t, MSKrealt> csr;
+	csr.make(this, row_starts, variables, coefficients);
+
+	MSKint32t N = csr.numrows;
+	check_batch_argument(senses, N, "senses");
+	check_batch_argument(rhss, N, "rhss");
+	check_batch_argument(names, N, "names");
+
+	std::vector<MSKboundkeye> bks(N);
+	std::vector<MSKrealt> g_rhss(N);
+	for (MSKint32t i = 0; i < N; i++)
+	{
+		bks[i] = mosek_con_sense(get_batch_argument(senses, i, ConstraintSense::Equal));
+		g_rhss[i] = get_batch_argument(rhss, i, 0.0);
+	}
+
+	auto error = mosek::MSK_appendcons(m_model.get(), N);
+	check_error(error);
+
+	MSKint32t row;
+	error = mosek::MSK_getnumcon(m_model.get(), &row);
+	check_error(error);
+	// 0-based indexing
+	row -= N;
+
+	error = mosek::MSK_putarowslice(m_model.get(), row, row + N, csr.start, csr.start + 1,
+	                                csr.index, csr.value);
+	check_error(error);
+	error = mosek::MSK_putconboundslice(m_model.get(), row, row + N, bks.data(), g_rhss.data(),
+	                                    g_rhss.data());
+	check_error(error);
+
+	if (!names.empty())
+	{
+		for (MSKint32t i = 0; i < N; i++)
+		{
+			auto &name = get_batch_argument(names, i, names[0]);
+			if (!name.empty())
+			{
+				error = mosek::MSK_putconname(m_model.get(), row + i, name.c_str());
+				check_error(error);
+			}
+		}
+	}
+
+	IndexT index = m_linear_quadratic_constraint_index.add_indices(N);
+	ConstraintIndex constraint_index(ConstraintType::Linear, index);
+
+	return constraint_index;
+}
+
 ConstraintIndex MOSEKModel::add_quadratic_constraint(const ScalarQuadraticFunction &function,
                                                      ConstraintSense sense, CoeffT rhs,
                                                      const char *name)
@@ -1084,7 +1176,7 @@ double MOSEKModel::get_constraint_dual(const ConstraintIndex &constraint)
 	{
 	case ConstraintType::Linear:
 	case ConstraintType::Quadratic:
-		error = mosek::MSK_getyslice(m_model.get(), soltype, num, num + 1, &retval);
+		error = mosek::MSK_getyslice(m_model.get(), soltype, row, row + 1, &retval);
 		break;
 	default:
 		throw std::runtime_error("Unknown constraint type");
@@ -1093,6 +1185,30 @@ double MOSEKModel::get_constraint_dual(const ConstraintIndex &constraint)
 	return retval;
 }
 
+void MOSEKModel::get_constraint_duals(std::span<const IndexT> constraints,
+                                      std::span<double> values)
+{
+	if (constraints.size() != values.size())
+	{
+		throw std::runtime_error("constraints and values must have the same length");
+	}
+	MSKint32t numcon;
+	auto error = mosek::MSK_getnumcon(m_model.get(), &numcon);
+	check_error(error);
+
+	// fetch the whole solution once and gather the values
+	std::vector<MSKrealt> y(numcon);
+	auto soltype = get_current_solution();
+	error = mosek::MSK_getyslice(m_model.get(), soltype, 0, numcon, y.data());
+	check_error(error);
+
+	for (size_t i = 0; i < constraints.size(); i++)
+	{
+		auto row = _checked_constraint_index({ConstraintType::Linear, constraints[i]});
+		values[i] = y[row];
+	}
+}
+
 std::string MOSEKModel::get_constraint_name(const ConstraintIndex &constraint)
 {
 	auto row = _checked_constraint_index(constraint);
@@ -1300,6 +1416,24 @@ MSKint32t MOSEKModel::_checked_variable_index(const VariableIndex &variable)
 	return column;
 }
 
+void MOSEKModel::_variable_indices(std::span<const IndexT> variables, std::span<MSKint32t> columns)
+{
+	m_variable_index.get_indices(variables.data(), columns.data(), variables.size());
+}
+
+void MOSEKModel::_checked_variable_indices(std::span<const IndexT> variables,
+                                            std::span<MSKint32t> columns)
+{
+	_variable_indices(variables, columns);
+	for (auto column : columns)
+	{
+		if (column < 0)
+		{
+			throw std::runtime_error("Variable does not exist");
+		}
+	}
+}
+
 MSKint32t MOSEKModel::_constraint_index(const ConstraintIndex &constraint)
 {
 	switch (constraint.type)
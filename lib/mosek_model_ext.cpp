@@ -3,6 +3,8 @@
 #include <nanobind/stl/vector.h>
 
 #include "pyoptinterface/mosek_model.hpp"
+#include "pyoptinterface/cache_model.hpp"
+#include "pyoptinterface/numpy_helper.hpp"
 
 namespace nb = nanobind;
 
@@ -35,6 +37,9 @@ NB_MODULE(mosek_model_ext, m)
 	    .def("add_variable", &MOSEKModelMixin::add_variable,
 	         nb::arg("domain") = VariableDomain::Continuous, nb::arg("lb") = -MSK_INFINITY,
 	         nb::arg("ub") = MSK_INFINITY, nb::arg("name") = "")
+	    .def("add_variables_batch", &MOSEKModelMixin::add_variables, nb::arg("N"),
+	         nb::arg("domains") = Vector<VariableDomain>{}, nb::arg("lbs") = Vector<double>{},
+	         nb::arg("ubs") = Vector<double>{}, nb::arg("names") = Vector<std::string>{})
 	    // clang-format off
 	    BIND_F(delete_variable)
 	    BIND_F(delete_variables)
@@ -49,6 +54,14 @@ NB_MODULE(mosek_model_ext, m)
 	                          &MOSEKModelMixin::get_expression_value))
 	    .def("get_value",
 	         nb::overload_cast<const ExprBuilder &>(&MOSEKModelMixin::get_expression_value))
+	    .def("get_variable_values", &get_variable_values_array<MOSEKModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_variable_values", &get_variable_values_list<MOSEKModelMixin>,
+	         nb::arg("variables"))
+	    .def("get_constraint_duals", &get_constraint_duals_array<MOSEKModelMixin>,
+	         nb::arg("constraints"))
+	    .def("get_constraint_duals", &get_constraint_duals_list<MOSEKModelMixin>,
+	         nb::arg("constraints"))
 
 	    .def("pprint", &MOSEKModelMixin::pprint_variable)
 	    .def("pprint",
@@ -71,6 +84,18 @@ NB_MODULE(mosek_model_ext, m)
 	         nb::overload_cast<const VariableIndex &, ConstraintSense, CoeffT, const char *>(
 	             &MOSEKModelMixin::add_linear_constraint_from_var),
 	         nb::arg("expr"), nb::arg("sense"), nb::arg("rhs"), nb::arg("name") = "")
+	    .def(
+	        "add_linear_constraints_batch",
+	        [](MOSEKModelMixin &model, IndexArray row_starts, IndexArray variables,
+	           CoeffArray coefficients, const Vector<ConstraintSense> &senses, CoeffArray rhss,
+	           const Vector<std::string> &names) {
+		        return model.add_linear_constraints({row_starts.data(), row_starts.shape(0)},
+		                                            {variables.data(), variables.shape(0)},
+		                                            {coefficients.data(), coefficients.shape(0)},
+		                                            senses, {rhss.data(), rhss.shape(0)}, names);
+	        },
+	        nb::arg("row_starts"), nb::arg("variables"), nb::arg("coefficients"), nb::arg("senses"),
+	        nb::arg("rhss"), nb::arg("names") = Vector<std::string>{})
 	    .def("add_linear_constraint",
 	         nb::overload_cast<const ExprBuilder &, ConstraintSense, CoeffT, const char *>(
 	             &MOSEKModelMixin::add_linear_constraint_from_expr),
@@ -108,6 +133,11 @@ NB_MODULE(mosek_model_ext, m)
 	         nb::overload_cast<CoeffT, ObjectiveSense>(&MOSEKModelMixin::set_objective_as_constant),
 	         nb::arg("expr"), nb::arg("sense") = ObjectiveSense::Minimize)
 
+	    .def(
+	        "load_cache",
+	        [](MOSEKModelMixin &model, const CacheModel &cache) { return cache.flush(model); },
+	        nb::arg("cache"))
+
 	    .def("optimize", &MOSEKModelMixin::optimize, nb::call_guard<nb::gil_scoped_release>())
 
 	    // clang-format off
@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <numeric>
+
 #include "pyoptinterface/nlcore.hpp"
 
 void NonlinearFunction::init(ADFunD &f_, const std::string &name_,
@@ -47,6 +54,10 @@ void NonlinearFunction::init(ADFunD &f_, const std::string &name_,
 		has_jacobian = true;
 		ADFunD jacobian = sparse_jacobian(f_, sparsity.jacobian, x_values, p_values);
 		jacobian.to_graph(jacobian_graph);
+
+		has_fused = true;
+		ADFunD fused = sparse_function_jacobian(f_, sparsity.jacobian, x_values, p_values);
+		fused.to_graph(fused_graph);
 	}
 
 	if (m_hessian_nnz > 0)
@@ -90,127 +101,119 @@ void NonlinearFunction::assign_evaluators(uintptr_t fp, uintptr_t jp, uintptr_t
 
 void LinearQuadraticModel::add_linear_constraint(const ScalarAffineFunction &f, size_t y)
 {
-	linear_constraints.push_back(f);
+	linear_variables.insert(linear_variables.end(), f.variables.begin(), f.variables.end());
+	linear_coefficients.insert(linear_coefficients.end(), f.coefficients.begin(),
+	                           f.coefficients.end());
+	linear_row_starts.push_back(linear_variables.size());
+	linear_constants.push_back(f.constant.value_or(0.0));
 	linear_constraint_indices.push_back(y);
+	structure_version++;
 }
 
 void LinearQuadraticModel::add_quadratic_constraint(const ScalarQuadraticFunction &f, size_t y)
 {
-	quadratic_constraints.push_back(f);
+	quadratic_variable_1s.insert(quadratic_variable_1s.end(), f.variable_1s.begin(),
+	                             f.variable_1s.end());
+	quadratic_variable_2s.insert(quadratic_variable_2s.end(), f.variable_2s.begin(),
+	                             f.variable_2s.end());
+	quadratic_coefficients.insert(quadratic_coefficients.end(), f.coefficients.begin(),
+	                              f.coefficients.end());
+	quadratic_starts.push_back(quadratic_coefficients.size());
+
+	double constant = 0.0;
+	if (f.affine_part)
+	{
+		auto &af = f.affine_part.value();
+		quadratic_affine_variables.insert(quadratic_affine_variables.end(), af.variables.begin(),
+		                                  af.variables.end());
+		quadratic_affine_coefficients.insert(quadratic_affine_coefficients.end(),
+		                                     af.coefficients.begin(), af.coefficients.end());
+		constant = af.constant.value_or(0.0);
+	}
+	quadratic_affine_starts.push_back(quadratic_affine_coefficients.size());
+	quadratic_constants.push_back(constant);
 	quadratic_constraint_indices.push_back(y);
+	structure_version++;
 }
 
 void LinearQuadraticModel::analyze_jacobian_structure(size_t &m_jacobian_nnz,
                                                       std::vector<size_t> &m_jacobian_rows,
                                                       std::vector<size_t> &m_jacobian_cols)
 {
-	// analyze linear constraints
-	jacobian_constants.clear();
-	for (int i = 0; i < linear_constraints.size(); i++)
+	// the constant nonzeros come first, they are in the same order as linear_coefficients and
+	// quadratic_affine_coefficients
+	constant_jacobian_start = m_jacobian_nnz;
+	for (size_t i = 0; i < linear_constraint_indices.size(); i++)
 	{
-		auto &f = linear_constraints[i];
-		auto N = f.size();
 		auto row = linear_constraint_indices[i];
-		for (size_t j = 0; j < N; j++)
+		for (size_t j = linear_row_starts[i]; j < linear_row_starts[i + 1]; j++)
+		{
+			m_jacobian_rows.push_back(row);
+			m_jacobian_cols.push_back(linear_variables[j]);
+		}
+	}
+	m_jacobian_nnz += linear_coefficients.size();
+	for (size_t i = 0; i < quadratic_constraint_indices.size(); i++)
+	{
+		auto row = quadratic_constraint_indices[i];
+		for (size_t j = quadratic_affine_starts[i]; j < quadratic_affine_starts[i + 1]; j++)
 		{
 			m_jacobian_rows.push_back(row);
-			m_jacobian_cols.push_back(f.variables[j]);
-			jacobian_constants.emplace_back(f.coefficients[j], m_jacobian_nnz + j);
+			m_jacobian_cols.push_back(quadratic_affine_variables[j]);
 		}
-		m_jacobian_nnz += N;
 	}
+	m_jacobian_nnz += quadratic_affine_coefficients.size();
 
-	// analyze quadratic constraints
+	// the quadratic terms are linear in x
 	jacobian_linear_terms.clear();
-	for (int i = 0; i < quadratic_constraints.size(); i++)
+	for (size_t i = 0; i < quadratic_constraint_indices.size(); i++)
 	{
-		auto &f = quadratic_constraints[i];
 		auto row = quadratic_constraint_indices[i];
-		auto N = f.size();
-		for (size_t j = 0; j < N; j++)
+		for (size_t j = quadratic_starts[i]; j < quadratic_starts[i + 1]; j++)
 		{
-			auto x1 = f.variable_1s[j];
-			auto x2 = f.variable_2s[j];
+			auto x1 = quadratic_variable_1s[j];
+			auto x2 = quadratic_variable_2s[j];
+			auto c = quadratic_coefficients[j];
 			if (x1 == x2)
 			{
 				m_jacobian_rows.push_back(row);
 				m_jacobian_cols.push_back(x1);
-				jacobian_linear_terms.emplace_back(2.0 * f.coefficients[j], x1, m_jacobian_nnz);
+				jacobian_linear_terms.emplace_back(2.0 * c, x1, m_jacobian_nnz);
 				m_jacobian_nnz += 1;
 			}
 			else
 			{
 				m_jacobian_rows.push_back(row);
 				m_jacobian_cols.push_back(x1);
-				jacobian_linear_terms.emplace_back(f.coefficients[j], x2, m_jacobian_nnz);
+				jacobian_linear_terms.emplace_back(c, x2, m_jacobian_nnz);
 				m_jacobian_nnz += 1;
 				m_jacobian_rows.push_back(row);
 				m_jacobian_cols.push_back(x2);
-				jacobian_linear_terms.emplace_back(f.coefficients[j], x1, m_jacobian_nnz);
+				jacobian_linear_terms.emplace_back(c, x1, m_jacobian_nnz);
 				m_jacobian_nnz += 1;
 			}
 		}
-		if (f.affine_part)
-		{
-			ScalarAffineFunction &af = f.affine_part.value();
-			auto N = af.size();
-			for (size_t j = 0; j < N; j++)
-			{
-				m_jacobian_rows.push_back(row);
-				m_jacobian_cols.push_back(af.variables[j]);
-				jacobian_constants.emplace_back(af.coefficients[j], m_jacobian_nnz + j);
-			}
-			m_jacobian_nnz += N;
-		}
 	}
 }
 
 void LinearQuadraticModel::analyze_dense_gradient_structure()
 {
-	gradient_constants.clear();
-	gradient_linear_terms.clear();
-	// quadratic part
-	{
-		auto &terms = lq_objective.quadratic_terms;
-		for (const auto &[varpair, c] : terms)
-		{
-			auto x1 = varpair.var_1;
-			auto x2 = varpair.var_2;
-
-			if (x1 == x2)
-			{
-				size_t grad_index = x1;
-				gradient_linear_terms.emplace_back(2.0 * c, x1, grad_index);
-			}
-			else
-			{
-				size_t grad_index = x1;
-				gradient_linear_terms.emplace_back(c, x2, grad_index);
-				grad_index = x2;
-				gradient_linear_terms.emplace_back(c, x1, grad_index);
-			}
-		}
-	}
-	// linear part
-	{
-		auto &terms = lq_objective.affine_terms;
-		for (const auto &[x, c] : terms)
-		{
-			size_t grad_index = x;
-			gradient_constants.emplace_back(c, grad_index);
-		}
-	}
-}
+	// the objective is frozen into flat arrays sorted by variables, so the evaluation streams
+	// through them instead of iterating over the buckets of the hashmaps
+	objective_diagonal_variables.clear();
+	objective_diagonal_coefficients.clear();
+	objective_variable_1s.clear();
+	objective_variable_2s.clear();
+	objective_quadratic_coefficients.clear();
+	objective_affine_variables.clear();
+	objective_affine_coefficients.clear();
 
-void LinearQuadraticModel::analyze_sparse_gradient_structure(
-    size_t &gradient_nnz, std::vector<size_t> &gradient_cols,
-    Hashmap<size_t, size_t> &gradient_index_map)
-{
-	gradient_constants.clear();
-	gradient_linear_terms.clear();
 	// quadratic part
 	{
-		auto &terms = lq_objective.quadratic_terms;
+		std::vector<std::pair<VariablePair, double>> terms(lq_objective.quadratic_terms.begin(),
+		                                                   lq_objective.quadratic_terms.end());
+		std::sort(terms.begin(), terms.end(),
+		          [](const auto &a, const auto &b) { return a.first < b.first; });
 		for (const auto &[varpair, c] : terms)
 		{
 			auto x1 = varpair.var_1;
@@ -218,63 +221,60 @@ void LinearQuadraticModel::analyze_sparse_gradient_structure(
 
 			if (x1 == x2)
 			{
-				size_t grad_index =
-				    add_gradient_column(x1, gradient_nnz, gradient_cols, gradient_index_map);
-				gradient_linear_terms.emplace_back(2.0 * c, x1, grad_index);
+				objective_diagonal_variables.push_back(x1);
+				objective_diagonal_coefficients.push_back(c);
 			}
 			else
 			{
-				size_t grad_index =
-				    add_gradient_column(x1, gradient_nnz, gradient_cols, gradient_index_map);
-				;
-				gradient_linear_terms.emplace_back(c, x2, grad_index);
-				grad_index =
-				    add_gradient_column(x2, gradient_nnz, gradient_cols, gradient_index_map);
-				gradient_linear_terms.emplace_back(c, x1, grad_index);
+				objective_variable_1s.push_back(x1);
+				objective_variable_2s.push_back(x2);
+				objective_quadratic_coefficients.push_back(c);
 			}
 		}
 	}
 	// linear part
 	{
-		auto &terms = lq_objective.affine_terms;
+		std::vector<std::pair<IndexT, double>> terms(lq_objective.affine_terms.begin(),
+		                                             lq_objective.affine_terms.end());
+		std::sort(terms.begin(), terms.end(),
+		          [](const auto &a, const auto &b) { return a.first < b.first; });
 		for (const auto &[x, c] : terms)
 		{
-			size_t grad_index =
-			    add_gradient_column(x, gradient_nnz, gradient_cols, gradient_index_map);
-			gradient_constants.emplace_back(c, grad_index);
+			objective_affine_variables.push_back(x);
+			objective_affine_coefficients.push_back(c);
 		}
 	}
+	// constant part
+	objective_constant = lq_objective.constant_term.value_or(0.0);
 }
 
-void LinearQuadraticModel::analyze_hessian_structure(
-    size_t &m_hessian_nnz, std::vector<size_t> &m_hessian_rows, std::vector<size_t> &m_hessian_cols,
-    Hashmap<VariablePair, size_t> &m_hessian_index_map, HessianSparsityType hessian_sparsity_type)
+void LinearQuadraticModel::analyze_hessian_structure(HessianStructureBuilder &builder)
 {
 	// quadratic constraints
 	constraint_hessian_linear_terms.clear();
-	for (int i = 0; i < quadratic_constraints.size(); i++)
+	for (size_t i = 0; i < quadratic_constraint_indices.size(); i++)
 	{
-		auto &f = quadratic_constraints[i];
 		auto row = quadratic_constraint_indices[i];
-		auto N = f.size();
 
 		// hessian part
-		for (size_t j = 0; j < N; j++)
-		{
-			auto x1 = f.variable_1s[j];
-			auto x2 = f.variable_2s[j];
-			auto hessian_index =
-			    add_hessian_index(x1, x2, m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-			                      m_hessian_index_map, hessian_sparsity_type);
-			double coef = f.coefficients[j];
+		for (size_t j = quadratic_starts[i]; j < quadratic_starts[i + 1]; j++)
+		{
+			auto x1 = quadratic_variable_1s[j];
+			auto x2 = quadratic_variable_2s[j];
+			auto entry = builder.add(x1, x2);
+			double coef = quadratic_coefficients[j];
 			if (x1 == x2)
 				coef *= 2.0;
-			constraint_hessian_linear_terms.emplace_back(coef, row, hessian_index);
+			constraint_hessian_linear_terms.emplace_back(coef, row, entry);
 		}
 	}
 
 	// quadratic objective
 	objective_hessian_linear_terms.clear();
+	objective_hessian_values.clear();
+	objective_hessian_start = 0;
+	constraint_hessian_start = 0;
+	constraint_hessian_end = 0;
 	{
 		auto &terms = lq_objective.quadratic_terms;
 		for (const auto &[varpair, c] : terms)
@@ -282,43 +282,109 @@ void LinearQuadraticModel::analyze_hessian_structure(
 			auto x1 = varpair.var_1;
 			auto x2 = varpair.var_2;
 
-			size_t hessian_index =
-			    add_hessian_index(x1, x2, m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-			                      m_hessian_index_map, hessian_sparsity_type);
+			size_t entry = builder.add(x1, x2);
 			double coef = c;
 			if (x1 == x2)
 				coef *= 2.0;
-			objective_hessian_linear_terms.emplace_back(coef, hessian_index);
+			objective_hessian_linear_terms.emplace_back(coef, entry);
 		}
 	}
 }
 
-void LinearQuadraticModel::eval_objective(const double *restrict x, double *restrict y)
+void LinearQuadraticModel::partition_hessian_structure(HessianStructureBuilder &builder,
+                                                       size_t n_shared_entries,
+                                                       std::vector<size_t> &m_hessian_rows,
+                                                       std::vector<size_t> &m_hessian_cols)
 {
-	double obj = 0.0;
-	// linear and quadratic objective terms
+	enum : std::uint8_t
 	{
-		auto &terms = lq_objective.quadratic_terms;
-		for (const auto &[varpair, c] : terms)
-		{
-			auto x1 = varpair.var_1;
-			auto x2 = varpair.var_2;
+		SHARED,
+		OBJECTIVE,
+		CONSTRAINT
+	};
+	auto nnz = builder.nnz;
+	std::vector<std::uint8_t> kinds(nnz, OBJECTIVE);
+	for (const auto &term : constraint_hessian_linear_terms)
+	{
+		kinds[builder.entry_index[term.yi]] = CONSTRAINT;
+	}
+	for (size_t id = 0; id < n_shared_entries; id++)
+	{
+		kinds[builder.entry_index[id]] = SHARED;
+	}
 
-			obj += c * x[x1] * x[x2];
-		}
+	size_t starts[3] = {0, 0, 0};
+	for (auto kind : kinds)
+	{
+		if (kind == SHARED)
+			starts[OBJECTIVE]++;
+		else if (kind == OBJECTIVE)
+			starts[CONSTRAINT]++;
 	}
-	// linear part
+	starts[CONSTRAINT] += starts[OBJECTIVE];
+	objective_hessian_start = starts[OBJECTIVE];
+	constraint_hessian_start = starts[CONSTRAINT];
+	constraint_hessian_end = nnz;
+
+	// the nonzeros of each kind keep their order
+	std::vector<size_t> order(nnz);
+	for (size_t i = 0; i < nnz; i++)
+	{
+		order[starts[kinds[i]]++] = i;
+	}
+	builder.permute(order, m_hessian_rows, m_hessian_cols);
+}
+
+void LinearQuadraticModel::assign_hessian_indices(const HessianStructureBuilder &builder)
+{
+	for (auto &term : constraint_hessian_linear_terms)
 	{
-		auto &terms = lq_objective.affine_terms;
-		for (const auto &[xi, c] : terms)
+		term.yi = builder.entry_index[term.yi];
+	}
+
+	// the terms of nonzeros only touched by the objective are summed into objective_hessian_values
+	objective_hessian_values.assign(constraint_hessian_start - objective_hessian_start, 0.0);
+	size_t n_shared_terms = 0;
+	for (const auto &term : objective_hessian_linear_terms)
+	{
+		auto index = builder.entry_index[term.yi];
+		if (index >= objective_hessian_start && index < constraint_hessian_start)
+		{
+			objective_hessian_values[index - objective_hessian_start] += term.c;
+		}
+		else
 		{
-			obj += c * x[xi];
+			objective_hessian_linear_terms[n_shared_terms++] = ConstantDelta(term.c, index);
 		}
 	}
-	// constant part
-	if (lq_objective.constant_term)
+	objective_hessian_linear_terms.resize(n_shared_terms);
+}
+
+void LinearQuadraticModel::eval_objective(const double *restrict x, double *restrict y)
+{
+	double obj = objective_constant;
+
+	const IndexT *restrict diagonal_variables = objective_diagonal_variables.data();
+	const double *restrict diagonal_coefficients = objective_diagonal_coefficients.data();
+	for (size_t i = 0; i < objective_diagonal_variables.size(); i++)
+	{
+		double xi = x[diagonal_variables[i]];
+		obj += diagonal_coefficients[i] * xi * xi;
+	}
+
+	const IndexT *restrict variable_1s = objective_variable_1s.data();
+	const IndexT *restrict variable_2s = objective_variable_2s.data();
+	const double *restrict quadratic_coefficients = objective_quadratic_coefficients.data();
+	for (size_t i = 0; i < objective_variable_1s.size(); i++)
+	{
+		obj += quadratic_coefficients[i] * x[variable_1s[i]] * x[variable_2s[i]];
+	}
+
+	const IndexT *restrict affine_variables = objective_affine_variables.data();
+	const double *restrict affine_coefficients = objective_affine_coefficients.data();
+	for (size_t i = 0; i < objective_affine_variables.size(); i++)
 	{
-		obj += lq_objective.constant_term.value();
+		obj += affine_coefficients[i] * x[affine_variables[i]];
 	}
 
 	y[0] += obj;
@@ -326,74 +392,86 @@ void LinearQuadraticModel::eval_objective(const double *restrict x, double *rest
 
 void LinearQuadraticModel::eval_objective_gradient(const double *restrict x, double *restrict grad)
 {
-	// linear and quadratic modification
-	for (const auto &linear : gradient_linear_terms)
+	// the same arrays as eval_objective, the gradient is dense and indexed by variables
+	const IndexT *restrict diagonal_variables = objective_diagonal_variables.data();
+	const double *restrict diagonal_coefficients = objective_diagonal_coefficients.data();
+	for (size_t i = 0; i < objective_diagonal_variables.size(); i++)
+	{
+		auto xi = diagonal_variables[i];
+		grad[xi] += 2.0 * diagonal_coefficients[i] * x[xi];
+	}
+
+	const IndexT *restrict variable_1s = objective_variable_1s.data();
+	const IndexT *restrict variable_2s = objective_variable_2s.data();
+	const double *restrict quadratic_coefficients = objective_quadratic_coefficients.data();
+	for (size_t i = 0; i < objective_variable_1s.size(); i++)
 	{
-		grad[linear.yi] += linear.c * x[linear.xi];
+		auto x1 = variable_1s[i];
+		auto x2 = variable_2s[i];
+		auto c = quadratic_coefficients[i];
+		grad[x1] += c * x[x2];
+		grad[x2] += c * x[x1];
 	}
-	for (const auto &constant : gradient_constants)
+
+	const IndexT *restrict affine_variables = objective_affine_variables.data();
+	const double *restrict affine_coefficients = objective_affine_coefficients.data();
+	for (size_t i = 0; i < objective_affine_variables.size(); i++)
 	{
-		grad[constant.yi] += constant.c;
+		grad[affine_variables[i]] += affine_coefficients[i];
 	}
 }
 
 void LinearQuadraticModel::eval_constraint(const double *restrict x, double *restrict con)
 {
-	// linear and quadratic part
-	for (size_t i = 0; i < linear_constraints.size(); i++)
+	// sparse matrix-vector products, the terms of a row are contiguous and the sum of a row stays
+	// in a register
+	const size_t *restrict starts = linear_row_starts.data();
+	const IndexT *restrict variables = linear_variables.data();
+	const double *restrict coefficients = linear_coefficients.data();
+	for (size_t i = 0; i < linear_constraint_indices.size(); i++)
 	{
-		auto &f = linear_constraints[i];
-		auto N = f.size();
-		auto row = linear_constraint_indices[i];
-		double sum = 0.0;
-		for (size_t j = 0; j < N; j++)
+		double sum = linear_constants[i];
+		for (size_t j = starts[i]; j < starts[i + 1]; j++)
 		{
-			sum += f.coefficients[j] * x[f.variables[j]];
+			sum += coefficients[j] * x[variables[j]];
 		}
-		if (f.constant)
-		{
-			sum += f.constant.value();
-		}
-		con[row] += sum;
+		con[linear_constraint_indices[i]] += sum;
 	}
-	for (size_t i = 0; i < quadratic_constraints.size(); i++)
+
+	const size_t *restrict q_starts = quadratic_starts.data();
+	const IndexT *restrict variable_1s = quadratic_variable_1s.data();
+	const IndexT *restrict variable_2s = quadratic_variable_2s.data();
+	const double *restrict q_coefficients = quadratic_coefficients.data();
+	const size_t *restrict a_starts = quadratic_affine_starts.data();
+	const IndexT *restrict a_variables = quadratic_affine_variables.data();
+	const double *restrict a_coefficients = quadratic_affine_coefficients.data();
+	for (size_t i = 0; i < quadratic_constraint_indices.size(); i++)
 	{
-		auto &f = quadratic_constraints[i];
-		auto N = f.size();
-		auto row = quadratic_constraint_indices[i];
-		double sum = 0.0;
-		for (size_t j = 0; j < N; j++)
+		double sum = quadratic_constants[i];
+		for (size_t j = q_starts[i]; j < q_starts[i + 1]; j++)
 		{
-			sum += f.coefficients[j] * x[f.variable_1s[j]] * x[f.variable_2s[j]];
+			sum += q_coefficients[j] * x[variable_1s[j]] * x[variable_2s[j]];
 		}
-		if (f.affine_part)
+		for (size_t j = a_starts[i]; j < a_starts[i + 1]; j++)
 		{
-			ScalarAffineFunction &af = f.affine_part.value();
-			auto N = af.size();
-			for (size_t j = 0; j < N; j++)
-			{
-				sum += af.coefficients[j] * x[af.variables[j]];
-			}
-			if (af.constant)
-			{
-				sum += af.constant.value();
-			}
+			sum += a_coefficients[j] * x[a_variables[j]];
 		}
-		con[row] += sum;
+		con[quadratic_constraint_indices[i]] += sum;
 	}
 }
 
 void LinearQuadraticModel::eval_constraint_jacobian(const double *restrict x,
                                                     double *restrict jacobian)
 {
-	// linear and quadratic modification
-	for (const auto &constant : jacobian_constants)
-	{
-		jacobian[constant.yi] += constant.c;
-	}
+	// every nonzero is written once, the constant ones are a contiguous copy of the coefficients
+	double *constants = jacobian + constant_jacobian_start;
+	constants = std::copy(linear_coefficients.begin(), linear_coefficients.end(), constants);
+	std::copy(quadratic_affine_coefficients.begin(), quadratic_affine_coefficients.end(),
+	          constants);
+
 	for (const auto &linear : jacobian_linear_terms)
 	{
-		jacobian[linear.yi] += linear.c * x[linear.xi];
+		jacobian[linear.yi] = linear.c * x[linear.xi];
 	}
 }
 
@@ -402,6 +480,16 @@ void LinearQuadraticModel::eval_lagrangian_hessian(const double *restrict x,
                                                    const double *restrict lambda,
                                                    double *restrict hessian)
 {
+	// the nonzeros only touched by this model are initialized here, the others are accumulated
+	double s = *sigma;
+	const double *restrict objective_values = objective_hessian_values.data();
+	double *restrict objective_hessian = hessian + objective_hessian_start;
+	for (size_t i = 0; i < objective_hessian_values.size(); i++)
+	{
+		objective_hessian[i] = s * objective_values[i];
+	}
+	std::fill(hessian + constraint_hessian_start, hessian + constraint_hessian_end, 0.0);
+
 	// linear and quadratic modification
 	for (const auto &linear : constraint_hessian_linear_terms)
 	{
@@ -409,8 +497,98 @@ void LinearQuadraticModel::eval_lagrangian_hessian(const double *restrict x,
 	}
 	for (const auto &constant : objective_hessian_linear_terms)
 	{
-		hessian[constant.yi] += (*sigma) * constant.c;
+		hessian[constant.yi] += s * constant.c;
+	}
+}
+
+void NonlinearFunction::assign_batch_evaluators(uintptr_t fp, uintptr_t jp, uintptr_t ajp,
+                                                uintptr_t hp)
+{
+	if (has_parameter)
+	{
+		f_batch_eval.p = (f_batch_funcptr)fp;
+		if (has_jacobian)
+		{
+			jacobian_batch_eval.p = (jacobian_batch_funcptr)jp;
+			grad_batch_eval.p = (additive_grad_batch_funcptr)ajp;
+		}
+		if (has_hessian)
+		{
+			hessian_batch_eval.p = (hessian_batch_funcptr)hp;
+		}
+	}
+	else
+	{
+		f_batch_eval.nop = (f_batch_funcptr_noparam)fp;
+		if (has_jacobian)
+		{
+			jacobian_batch_eval.nop = (jacobian_batch_funcptr_noparam)jp;
+			grad_batch_eval.nop = (additive_grad_batch_funcptr_noparam)ajp;
+		}
+		if (has_hessian)
+		{
+			hessian_batch_eval.nop = (hessian_batch_funcptr_noparam)hp;
+		}
+	}
+}
+
+void NonlinearFunction::assign_sum_evaluator(uintptr_t sp)
+{
+	if (ny != 1)
+		return;
+	if (has_parameter)
+	{
+		f_sum_eval.p = (f_sum_funcptr)sp;
+	}
+	else
+	{
+		f_sum_eval.nop = (f_sum_funcptr_noparam)sp;
+	}
+}
+
+void NonlinearFunction::assign_fused_evaluators(uintptr_t fp, uintptr_t fbp)
+{
+	if (!has_fused)
+		return;
+	if (has_parameter)
+	{
+		fused_eval.p = (jacobian_funcptr)fp;
+		fused_batch_eval.p = (jacobian_batch_funcptr)fbp;
+	}
+	else
+	{
+		fused_eval.nop = (jacobian_funcptr_noparam)fp;
+		fused_batch_eval.nop = (jacobian_batch_funcptr_noparam)fbp;
+	}
+}
+
+void FunctionInstances::add_instance(const std::vector<VariableIndex> &x,
+                                     const std::vector<ParameterIndex> &p, size_t y)
+{
+	assert(x.size() == nx);
+	assert(p.size() == np);
+	for (auto &v : x)
+	{
+		xs.push_back(v.index);
+	}
+	for (auto &v : p)
+	{
+		ps.push_back(v.index);
 	}
+	y_starts.push_back(y);
+	eval_y_starts.push_back(y);
+}
+
+void FunctionInstances::clear()
+{
+	xs.clear();
+	ps.clear();
+	y_starts.clear();
+	eval_y_starts.clear();
+	jacobian_starts.clear();
+	hessian_indices.clear();
+	grad_indices.clear();
+	fused_starts.clear();
 }
 
 ParameterIndex NonlinearFunctionModel::add_parameter(double value)
@@ -434,12 +612,144 @@ FunctionIndex NonlinearFunctionModel::register_function(ADFunD &f, const std::st
 	NonlinearFunction kernel;
 	kernel.init(f, name, x_values, p_values);
 	nl_functions.push_back(kernel);
-	constraint_function_instances.emplace_back();
-	objective_function_instances.emplace_back();
+	constraint_function_instances.emplace_back(kernel.nx, kernel.np);
+	objective_function_instances.emplace_back(kernel.nx, kernel.np);
+	structure_version++;
+
+	return idx;
+}
+
+FunctionIndex NonlinearFunctionModel::register_function_from_analysis(ADFunD &f,
+                                                                      const std::string &name,
+                                                                      const std::string &analysis)
+{
+	FunctionIndex idx;
+	idx.index = nl_functions.size();
+	NonlinearFunction kernel;
+	kernel.init_from_analysis(f, name, analysis);
+	nl_functions.push_back(kernel);
+	constraint_function_instances.emplace_back(kernel.nx, kernel.np);
+	objective_function_instances.emplace_back(kernel.nx, kernel.np);
+	structure_version++;
+
+	return idx;
+}
+
+FunctionIndex NonlinearFunctionModel::register_function_deferred(
+    ADFunD &f, const std::string &name, const std::vector<double> &x_values,
+    const std::vector<double> &p_values)
+{
+	FunctionIndex idx;
+	idx.index = nl_functions.size();
+	NonlinearFunction kernel;
+	kernel.nx = f.Domain();
+	kernel.np = f.size_dyn_ind();
+	kernel.ny = f.Range();
+	kernel.has_parameter = kernel.np > 0;
+	kernel.name = name;
+	nl_functions.push_back(kernel);
+	constraint_function_instances.emplace_back(kernel.nx, kernel.np);
+	objective_function_instances.emplace_back(kernel.nx, kernel.np);
+	structure_version++;
+
+	// f belongs to the caller, the deferred function works on its own copy
+	auto &deferred = deferred_functions.emplace_back();
+	deferred.index = idx.index;
+	deferred.f = f;
+	deferred.x_values = x_values;
+	deferred.p_values = p_values;
 
 	return idx;
 }
 
+namespace
+{
+// CppAD asks these functions whether it runs in parallel and which thread calls it
+std::atomic<bool> cppad_in_parallel = false;
+thread_local size_t cppad_thread_num = 0;
+
+bool cppad_get_in_parallel()
+{
+	return cppad_in_parallel;
+}
+
+size_t cppad_get_thread_num()
+{
+	return cppad_thread_num;
+}
+} // namespace
+
+void NonlinearFunctionModel::initialize_deferred_functions()
+{
+	size_t N = deferred_functions.size();
+	if (N == 0)
+		return;
+
+	auto init = [&](size_t i) {
+		auto &deferred = deferred_functions[i];
+		auto &kernel = nl_functions[deferred.index];
+		auto name = kernel.name;
+		kernel.init(deferred.f, name, deferred.x_values, deferred.p_values);
+	};
+
+	size_t n_threads = thread_pool ? thread_pool->size() : 1;
+	n_threads = std::min({n_threads, N, size_t(CPPAD_MAX_NUM_THREADS)});
+	if (n_threads <= 1)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			init(i);
+		}
+	}
+	else
+	{
+		// the statics of CppAD must be initialized in sequential mode
+		CppAD::thread_alloc::parallel_setup(n_threads, cppad_get_in_parallel,
+		                                    cppad_get_thread_num);
+		CppAD::parallel_ad<double>();
+
+		// the functions differ a lot in size, so every thread takes the next one when it is done
+		std::atomic<size_t> next = 0;
+		std::vector<std::exception_ptr> errors(n_threads);
+		cppad_in_parallel = true;
+		thread_pool->run([&](size_t t) {
+			if (t >= n_threads)
+				return;
+			cppad_thread_num = t;
+			try
+			{
+				for (size_t i = next++; i < N; i = next++)
+				{
+					init(i);
+				}
+			}
+			catch (...)
+			{
+				errors[t] = std::current_exception();
+			}
+		});
+		cppad_in_parallel = false;
+
+		CppAD::thread_alloc::parallel_setup(1, nullptr, nullptr);
+		for (size_t t = 1; t < n_threads; t++)
+		{
+			CppAD::thread_alloc::free_available(t);
+		}
+
+		for (auto &error : errors)
+		{
+			if (error)
+			{
+				deferred_functions.clear();
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	deferred_functions.clear();
+	structure_version++;
+}
+
 NLConstraintIndex NonlinearFunctionModel::add_nl_constraint(const FunctionIndex &k,
                                                             const std::vector<VariableIndex> &xs,
                                                             const std::vector<ParameterIndex> &ps,
@@ -451,25 +761,9 @@ NLConstraintIndex NonlinearFunctionModel::add_nl_constraint(const FunctionIndex
 
 	auto ny = kernel.ny;
 
-	std::vector<size_t> x_indices(xs.size());
-	std::vector<size_t> p_indices(ps.size());
-	for (size_t i = 0; i < xs.size(); i++)
-	{
-		x_indices[i] = xs[i].index;
-	}
-	for (size_t i = 0; i < ps.size(); i++)
-	{
-		p_indices[i] = ps[i].index;
-	}
-
-	FunctionInstance inst;
-	inst.xs = x_indices;
-	inst.ps = p_indices;
-	inst.y_start = y;
-	inst.eval_y_start = y;
-
 	auto &inst_vec = constraint_function_instances[k.index];
-	inst_vec.push_back(inst);
+	inst_vec.add_instance(xs, ps, y);
+	structure_version++;
 
 	NLConstraintIndex con;
 	con.index = y;
@@ -482,29 +776,16 @@ void NonlinearFunctionModel::add_nl_objective(const FunctionIndex &k,
                                               const std::vector<VariableIndex> &xs,
                                               const std::vector<ParameterIndex> &ps)
 {
-	auto &kernel = nl_functions[k.index];
+	[[maybe_unused]] auto &kernel = nl_functions[k.index];
 	assert(xs.size() == kernel.nx);
 	assert(ps.size() == kernel.np);
 
 	assert(kernel.ny == 1);
 
-	std::vector<size_t> x_indices(xs.size());
-	std::vector<size_t> p_indices(ps.size());
-	for (size_t i = 0; i < xs.size(); i++)
-	{
-		x_indices[i] = xs[i].index;
-	}
-	for (size_t i = 0; i < ps.size(); i++)
-	{
-		p_indices[i] = ps[i].index;
-	}
-
-	FunctionInstance inst;
-	inst.xs = x_indices;
-	inst.ps = p_indices;
-
+	// the weight of objective in hessian is sigma[0]
 	auto &inst_vec = objective_function_instances[k.index];
-	inst_vec.push_back(inst);
+	inst_vec.add_instance(xs, ps, 0);
+	structure_version++;
 }
 
 void NonlinearFunctionModel::clear_nl_objective()
@@ -513,6 +794,7 @@ void NonlinearFunctionModel::clear_nl_objective()
 	{
 		inst_vec.clear();
 	}
+	structure_version++;
 }
 
 size_t add_gradient_column(size_t column, size_t &gradient_nnz, std::vector<size_t> &gradient_cols,
@@ -534,32 +816,172 @@ size_t add_gradient_column(size_t column, size_t &gradient_nnz, std::vector<size
 	return gradient_index;
 }
 
-size_t add_hessian_index(size_t x1, size_t x2, size_t &m_hessian_nnz,
-                         std::vector<size_t> &m_hessian_rows, std::vector<size_t> &m_hessian_cols,
-                         Hashmap<VariablePair, size_t> &m_hessian_index_map,
-                         HessianSparsityType hessian_sparsity_type)
+size_t HessianStructureBuilder::add(size_t x1, size_t x2)
 {
 	if (hessian_sparsity_type == HessianSparsityType::Upper && x1 > x2)
 		std::swap(x1, x2);
 	if (hessian_sparsity_type == HessianSparsityType::Lower && x1 < x2)
 		std::swap(x1, x2);
 
-	size_t hessian_index;
-	VariablePair varpair(x1, x2);
-	auto iter = m_hessian_index_map.find(varpair);
-	if (iter != m_hessian_index_map.end())
+	keys.push_back((static_cast<std::uint64_t>(x1) << 32) | static_cast<std::uint64_t>(x2));
+	return keys.size() - 1;
+}
+
+void HessianStructureBuilder::build(ThreadPool *thread_pool, size_t &m_hessian_nnz,
+                                    std::vector<size_t> &m_hessian_rows,
+                                    std::vector<size_t> &m_hessian_cols)
+{
+	size_t N = keys.size();
+	size_t n_threads = thread_pool ? thread_pool->size() : 1;
+
+	// f(t, begin, end) is called for the t-th of n_threads contiguous parts of the entries
+	auto run = [&](const std::function<void(size_t, size_t, size_t)> &f) {
+		auto part = [&](size_t t) { f(t, N * t / n_threads, N * (t + 1) / n_threads); };
+		if (thread_pool)
+			thread_pool->run(part);
+		else
+			part(0);
+	};
+
+	// sorted_keys[i] = keys[ids[i]], entries with the same key keep the order of their ids
+	std::vector<std::uint64_t> sorted_keys;
+	std::vector<size_t> ids(N);
+	std::iota(ids.begin(), ids.end(), 0);
+
+	constexpr size_t RADIX_BITS = 16;
+	constexpr size_t RADIX = size_t(1) << RADIX_BITS;
+	if (N < RADIX)
 	{
-		hessian_index = iter->second;
+		// the histograms of radix sort are larger than the input
+		std::stable_sort(ids.begin(), ids.end(),
+		                 [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+		sorted_keys.resize(N);
+		for (size_t i = 0; i < N; i++)
+		{
+			sorted_keys[i] = keys[ids[i]];
+		}
 	}
 	else
 	{
-		hessian_index = m_hessian_nnz;
-		m_hessian_index_map[varpair] = m_hessian_nnz;
-		m_hessian_rows.push_back(x1);
-		m_hessian_cols.push_back(x2);
-		m_hessian_nnz += 1;
+		sorted_keys = keys;
+
+		// digits that are equal in all keys are skipped
+		std::vector<std::uint64_t> varying_bits(n_threads, 0);
+		run([&](size_t t, size_t begin, size_t end) {
+			std::uint64_t bits = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				bits |= keys[i] ^ keys[0];
+			}
+			varying_bits[t] = bits;
+		});
+		std::uint64_t bits = 0;
+		for (auto b : varying_bits)
+		{
+			bits |= b;
+		}
+
+		// least significant digit first, every pass is stable
+		std::vector<std::uint64_t> temp_keys(N);
+		std::vector<size_t> temp_ids(N);
+		std::vector<size_t> counts(n_threads * RADIX);
+		for (size_t shift = 0; shift < 64; shift += RADIX_BITS)
+		{
+			if (((bits >> shift) & (RADIX - 1)) == 0)
+				continue;
+
+			run([&](size_t t, size_t begin, size_t end) {
+				size_t *count = counts.data() + t * RADIX;
+				std::fill(count, count + RADIX, 0);
+				for (size_t i = begin; i < end; i++)
+				{
+					count[(sorted_keys[i] >> shift) & (RADIX - 1)]++;
+				}
+			});
+			// the entries of thread t with digit d go after those of all smaller digits and
+			// those of the threads before t with digit d
+			size_t offset = 0;
+			for (size_t d = 0; d < RADIX; d++)
+			{
+				for (size_t t = 0; t < n_threads; t++)
+				{
+					auto &count = counts[t * RADIX + d];
+					auto n = count;
+					count = offset;
+					offset += n;
+				}
+			}
+			run([&](size_t t, size_t begin, size_t end) {
+				size_t *position = counts.data() + t * RADIX;
+				for (size_t i = begin; i < end; i++)
+				{
+					auto pos = position[(sorted_keys[i] >> shift) & (RADIX - 1)]++;
+					temp_keys[pos] = sorted_keys[i];
+					temp_ids[pos] = ids[i];
+				}
+			});
+			std::swap(sorted_keys, temp_keys);
+			std::swap(ids, temp_ids);
+		}
+	}
+
+	// a nonzero starts at every position whose key differs from the previous one
+	std::vector<size_t> starts(n_threads + 1, 0);
+	run([&](size_t t, size_t begin, size_t end) {
+		size_t n = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			if (i == 0 || sorted_keys[i] != sorted_keys[i - 1])
+				n++;
+		}
+		starts[t + 1] = n;
+	});
+	for (size_t t = 0; t < n_threads; t++)
+	{
+		starts[t + 1] += starts[t];
+	}
+
+	nnz = starts[n_threads];
+	m_hessian_nnz = nnz;
+	m_hessian_rows.resize(nnz);
+	m_hessian_cols.resize(nnz);
+	entry_index.resize(N);
+	run([&](size_t t, size_t begin, size_t end) {
+		// the index of the next nonzero, the entries before the first new key of this part
+		// belong to the last nonzero of the previous part
+		size_t next = starts[t];
+		for (size_t i = begin; i < end; i++)
+		{
+			auto key = sorted_keys[i];
+			if (i == 0 || key != sorted_keys[i - 1])
+			{
+				m_hessian_rows[next] = key >> 32;
+				m_hessian_cols[next] = key & 0xFFFFFFFF;
+				next++;
+			}
+			entry_index[ids[i]] = next - 1;
+		}
+	});
+}
+
+void HessianStructureBuilder::permute(const std::vector<size_t> &order,
+                                      std::vector<size_t> &m_hessian_rows,
+                                      std::vector<size_t> &m_hessian_cols)
+{
+	std::vector<size_t> new_index(nnz);
+	std::vector<size_t> rows(nnz), cols(nnz);
+	for (size_t i = 0; i < nnz; i++)
+	{
+		new_index[order[i]] = i;
+		rows[i] = m_hessian_rows[order[i]];
+		cols[i] = m_hessian_cols[order[i]];
 	}
-	return hessian_index;
+	for (auto &index : entry_index)
+	{
+		index = new_index[index];
+	}
+	m_hessian_rows = std::move(rows);
+	m_hessian_cols = std::move(cols);
 }
 
 void NonlinearFunctionModel::analyze_active_functions()
@@ -593,9 +1015,9 @@ void NonlinearFunctionModel::analyze_compact_constraint_index(size_t &n_nlcon,
 
 		auto ny = kernel.ny;
 
-		for (auto &inst : inst_vec)
+		for (size_t i = 0; i < inst_vec.size(); i++)
 		{
-			inst.eval_y_start = N;
+			inst_vec.eval_y_starts[i] = N;
 			for (size_t j = 0; j < ny; j++)
 			{
 				ys.push_back(N + j);
@@ -615,18 +1037,19 @@ void NonlinearFunctionModel::analyze_jacobian_structure(size_t &m_jacobian_nnz,
 		auto &kernel = nl_functions[k];
 		auto &inst_vec = constraint_function_instances[k];
 
-		for (auto &inst : inst_vec)
+		inst_vec.jacobian_starts.resize(inst_vec.size());
+		for (size_t i = 0; i < inst_vec.size(); i++)
 		{
-			auto &x_indices = inst.xs;
+			auto x_indices = inst_vec.x_indices(i);
 
 			for (size_t j = 0; j < kernel.m_jacobian_nnz; j++)
 			{
-				auto row = inst.y_start + kernel.m_jacobian_rows[j];
+				auto row = inst_vec.y_starts[i] + kernel.m_jacobian_rows[j];
 				m_jacobian_rows.push_back(row);
 				auto column = x_indices[kernel.m_jacobian_cols[j]];
 				m_jacobian_cols.push_back(column);
 			}
-			inst.jacobian_start = m_jacobian_nnz;
+			inst_vec.jacobian_starts[i] = m_jacobian_nnz;
 			m_jacobian_nnz += kernel.m_jacobian_nnz;
 		}
 	}
@@ -639,17 +1062,17 @@ void NonlinearFunctionModel::analyze_dense_gradient_structure()
 		auto &kernel = nl_functions[k];
 		auto &inst_vec = objective_function_instances[k];
 
-		for (auto &inst : inst_vec)
+		auto &grad_indices = inst_vec.grad_indices;
+		grad_indices.resize(inst_vec.size() * kernel.m_jacobian_nnz);
+		for (size_t i = 0; i < inst_vec.size(); i++)
 		{
-			auto &x_indices = inst.xs;
+			auto x_indices = inst_vec.x_indices(i);
 
-			auto &grad_indices = inst.grad_indices;
-			grad_indices.resize(kernel.m_jacobian_nnz);
 			for (size_t j = 0; j < kernel.m_jacobian_nnz; j++)
 			{
 				auto column = x_indices[kernel.m_jacobian_cols[j]];
 				size_t grad_index = column;
-				grad_indices[j] = grad_index;
+				grad_indices[i * kernel.m_jacobian_nnz + j] = grad_index;
 			}
 		}
 	}
@@ -664,289 +1087,701 @@ void NonlinearFunctionModel::analyze_sparse_gradient_structure(
 		auto &kernel = nl_functions[k];
 		auto &inst_vec = objective_function_instances[k];
 
-		for (auto &inst : inst_vec)
+		auto &grad_indices = inst_vec.grad_indices;
+		grad_indices.resize(inst_vec.size() * kernel.m_jacobian_nnz);
+		for (size_t i = 0; i < inst_vec.size(); i++)
 		{
-			auto &x_indices = inst.xs;
+			auto x_indices = inst_vec.x_indices(i);
 
-			auto &grad_indices = inst.grad_indices;
-			grad_indices.resize(kernel.m_jacobian_nnz);
 			for (size_t j = 0; j < kernel.m_jacobian_nnz; j++)
 			{
 				auto column = x_indices[kernel.m_jacobian_cols[j]];
 				size_t grad_index =
 				    add_gradient_column(column, gradient_nnz, gradient_cols, gradient_index_map);
-				grad_indices[j] = grad_index;
+				grad_indices[i * kernel.m_jacobian_nnz + j] = grad_index;
 			}
 		}
 	}
 }
 
-void NonlinearFunctionModel::analyze_hessian_structure(
-    size_t &m_hessian_nnz, std::vector<size_t> &m_hessian_rows, std::vector<size_t> &m_hessian_cols,
-    Hashmap<VariablePair, size_t> &m_hessian_index_map, HessianSparsityType hessian_sparsity_type)
+void NonlinearFunctionModel::analyze_hessian_structure(HessianStructureBuilder &builder)
 {
-	for (size_t k : active_constraint_function_indices)
-	{
-		auto &kernel = nl_functions[k];
-		auto &inst_vec = constraint_function_instances[k];
-
-		for (auto &inst : inst_vec)
+	auto analyze = [&](const NonlinearFunction &kernel, FunctionInstances &inst_vec) {
+		auto &hessian_indices = inst_vec.hessian_indices;
+		hessian_indices.resize(inst_vec.size() * kernel.m_hessian_nnz);
+		for (size_t i = 0; i < inst_vec.size(); i++)
 		{
-			auto &x_indices = inst.xs;
+			auto x_indices = inst_vec.x_indices(i);
 
-			auto &hessian_indices = inst.hessian_indices;
-			hessian_indices.resize(kernel.m_hessian_nnz);
 			for (size_t j = 0; j < kernel.m_hessian_nnz; j++)
 			{
 				auto x1 = x_indices[kernel.m_hessian_rows[j]];
 				auto x2 = x_indices[kernel.m_hessian_cols[j]];
 
-				auto hessian_index =
-				    add_hessian_index(x1, x2, m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-				                      m_hessian_index_map, hessian_sparsity_type);
-				hessian_indices[j] = hessian_index;
+				hessian_indices[i * kernel.m_hessian_nnz + j] = builder.add(x1, x2);
 			}
 		}
-	}
+	};
+
+	for (size_t k : active_constraint_function_indices)
+	{
+		analyze(nl_functions[k], constraint_function_instances[k]);
+	}
 
 	for (size_t k : active_objective_function_indices)
 	{
-		auto &kernel = nl_functions[k];
-		auto &inst_vec = objective_function_instances[k];
+		analyze(nl_functions[k], objective_function_instances[k]);
+	}
+}
 
-		for (auto &inst : inst_vec)
+void NonlinearFunctionModel::assign_hessian_indices(const HessianStructureBuilder &builder)
+{
+	// the buffers of threads cover [0, hessian_nnz), the nonzeros only touched by the other parts
+	// of the model are placed behind those of nonlinear functions
+	hessian_nnz = 0;
+	auto assign = [&](FunctionInstances &inst_vec) {
+		for (auto &index : inst_vec.hessian_indices)
 		{
-			auto &x_indices = inst.xs;
+			index = builder.entry_index[index];
+			hessian_nnz = std::max(hessian_nnz, index + 1);
+		}
+	};
 
-			auto &hessian_indices = inst.hessian_indices;
-			hessian_indices.resize(kernel.m_hessian_nnz);
-			for (size_t j = 0; j < kernel.m_hessian_nnz; j++)
-			{
-				auto x1 = x_indices[kernel.m_hessian_rows[j]];
-				auto x2 = x_indices[kernel.m_hessian_cols[j]];
+	for (size_t k : active_constraint_function_indices)
+	{
+		assign(constraint_function_instances[k]);
+	}
 
-				auto hessian_index =
-				    add_hessian_index(x1, x2, m_hessian_nnz, m_hessian_rows, m_hessian_cols,
-				                      m_hessian_index_map, hessian_sparsity_type);
-				hessian_indices[j] = hessian_index;
+	for (size_t k : active_objective_function_indices)
+	{
+		assign(objective_function_instances[k]);
+	}
+}
+
+void NonlinearFunctionModel::analyze_fused_structure()
+{
+	auto analyze = [&](std::vector<FunctionInstances> &instances,
+	                   const std::vector<size_t> &active_function_indices,
+	                   std::vector<double> &values) {
+		size_t N = 0;
+		for (size_t k : active_function_indices)
+		{
+			auto &kernel = nl_functions[k];
+			auto &inst_vec = instances[k];
+			inst_vec.fused_starts.clear();
+			if (!kernel.has_fused_evaluator())
+				continue;
+			inst_vec.fused_starts.resize(inst_vec.size());
+			for (size_t i = 0; i < inst_vec.size(); i++)
+			{
+				inst_vec.fused_starts[i] = N;
+				N += kernel.fused_size();
 			}
 		}
-	}
+		values.assign(N, 0.0);
+	};
+
+	analyze(constraint_function_instances, active_constraint_function_indices,
+	        constraint_fused_values);
+	analyze(objective_function_instances, active_objective_function_indices,
+	        objective_fused_values);
+	new_x();
 }
 
-void NonlinearFunctionModel::eval_objective(const double *x, double *y)
+void NonlinearFunctionModel::new_x()
 {
-	double obj = 0.0;
-	double temp = 0.0;
+	constraint_fused_valid = false;
+	objective_fused_valid = false;
+}
 
-	double *p = this->p.data();
+namespace
+{
+// The instances of the active kernels are split into n_threads contiguous parts with the same
+// number of instances, f(k, begin, end) is called for the instances [begin, end) of kernel k in
+// the part of thread t
+template <typename F>
+void for_each_instance_range(const std::vector<FunctionInstances> &function_instances,
+                             const std::vector<size_t> &active_function_indices, size_t t,
+                             size_t n_threads, F &&f)
+{
+	size_t N = 0;
+	for (auto k : active_function_indices)
+	{
+		N += function_instances[k].size();
+	}
+	size_t begin = N * t / n_threads;
+	size_t end = N * (t + 1) / n_threads;
 
-	// nonlinear objective terms
-	for (auto k : active_objective_function_indices)
+	size_t offset = 0;
+	for (auto k : active_function_indices)
 	{
-		auto &kernel = nl_functions[k];
-		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = objective_function_instances[k];
+		if (offset >= end)
+		{
+			break;
+		}
+		size_t n = function_instances[k].size();
+		size_t lo = std::max(begin, offset);
+		size_t hi = std::min(end, offset + n);
+		if (lo < hi)
+		{
+			f(k, lo - offset, hi - offset);
+		}
+		offset += n;
+	}
+}
 
-		if (has_parameter)
+// The fused values are copied if they are given. Otherwise the batched evaluators are called once
+// for the instances [begin, end) if they are assigned, or the instances are evaluated one by one
+void eval_constraint_range(const NonlinearFunction &kernel, const FunctionInstances &inst_vec,
+                           size_t begin, size_t end, const double *x, const double *p,
+                           const double *fused_values, double *con)
+{
+	if (fused_values && kernel.has_fused_evaluator())
+	{
+		auto ny = kernel.ny;
+		for (size_t i = begin; i < end; i++)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &p_indices = inst.ps;
-				kernel.f_eval.p(x, p, &temp, x_indices.data(), p_indices.data());
-			}
+			const double *v = fused_values + inst_vec.fused_starts[i];
+			std::copy(v, v + ny, con + inst_vec.eval_y_starts[i]);
 		}
-		else
+		return;
+	}
+
+	auto n = end - begin;
+	auto y_starts = inst_vec.eval_y_starts.data() + begin;
+	if (kernel.has_parameter)
+	{
+		if (kernel.f_batch_eval.p)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				kernel.f_eval.nop(x, &temp, x_indices.data());
-			}
+			kernel.f_batch_eval.p(n, x, p, con, inst_vec.x_indices(begin),
+			                      inst_vec.p_indices(begin), y_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *y = con + inst_vec.eval_y_starts[i];
+			kernel.f_eval.p(x, p, y, inst_vec.x_indices(i), inst_vec.p_indices(i));
+		}
+	}
+	else
+	{
+		if (kernel.f_batch_eval.nop)
+		{
+			kernel.f_batch_eval.nop(n, x, con, inst_vec.x_indices(begin), y_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *y = con + inst_vec.eval_y_starts[i];
+			kernel.f_eval.nop(x, y, inst_vec.x_indices(i));
 		}
-		obj += temp;
 	}
+}
 
-	y[0] += obj;
+void eval_constraint_jacobian_range(const NonlinearFunction &kernel,
+                                    const FunctionInstances &inst_vec, size_t begin, size_t end,
+                                    const double *x, const double *p, const double *fused_values,
+                                    double *jacobian)
+{
+	if (!kernel.has_jacobian)
+		return;
+
+	if (kernel.has_fused_evaluator())
+	{
+		auto ny = kernel.ny;
+		auto jacobian_nnz = kernel.m_jacobian_nnz;
+		for (size_t i = begin; i < end; i++)
+		{
+			const double *v = fused_values + inst_vec.fused_starts[i] + ny;
+			std::copy(v, v + jacobian_nnz, jacobian + inst_vec.jacobian_starts[i]);
+		}
+		return;
+	}
+
+	auto n = end - begin;
+	auto jacobian_starts = inst_vec.jacobian_starts.data() + begin;
+	if (kernel.has_parameter)
+	{
+		if (kernel.jacobian_batch_eval.p)
+		{
+			kernel.jacobian_batch_eval.p(n, x, p, jacobian, inst_vec.x_indices(begin),
+			                             inst_vec.p_indices(begin), jacobian_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *j = jacobian + inst_vec.jacobian_starts[i];
+			kernel.jacobian_eval.p(x, p, j, inst_vec.x_indices(i), inst_vec.p_indices(i));
+		}
+	}
+	else
+	{
+		if (kernel.jacobian_batch_eval.nop)
+		{
+			kernel.jacobian_batch_eval.nop(n, x, jacobian, inst_vec.x_indices(begin),
+			                               jacobian_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *j = jacobian + inst_vec.jacobian_starts[i];
+			kernel.jacobian_eval.nop(x, j, inst_vec.x_indices(i));
+		}
+	}
 }
 
-void NonlinearFunctionModel::eval_objective_gradient(const double *x, double *grad)
+// the values and jacobian of instance i are written to values[fused_starts[i]:]
+void eval_fused_range(const NonlinearFunction &kernel, const FunctionInstances &inst_vec,
+                      size_t begin, size_t end, const double *x, const double *p, double *values)
 {
-	double *p = this->p.data();
+	if (!kernel.has_fused_evaluator())
+		return;
 
-	// nonlinear objective terms
-	for (auto k : active_objective_function_indices)
+	auto n = end - begin;
+	auto fused_starts = inst_vec.fused_starts.data() + begin;
+	if (kernel.has_parameter)
 	{
-		auto &kernel = nl_functions[k];
-		if (!kernel.has_jacobian)
-			continue;
+		if (kernel.fused_batch_eval.p)
+		{
+			kernel.fused_batch_eval.p(n, x, p, values, inst_vec.x_indices(begin),
+			                          inst_vec.p_indices(begin), fused_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *v = values + inst_vec.fused_starts[i];
+			kernel.fused_eval.p(x, p, v, inst_vec.x_indices(i), inst_vec.p_indices(i));
+		}
+	}
+	else
+	{
+		if (kernel.fused_batch_eval.nop)
+		{
+			kernel.fused_batch_eval.nop(n, x, values, inst_vec.x_indices(begin), fused_starts);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			double *v = values + inst_vec.fused_starts[i];
+			kernel.fused_eval.nop(x, v, inst_vec.x_indices(i));
+		}
+	}
+}
 
-		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = objective_function_instances[k];
+// evaluate all fused kernels at x unless they have been evaluated at the same x
+void update_fused_values(ThreadPool *thread_pool, const std::vector<NonlinearFunction> &kernels,
+                         const std::vector<FunctionInstances> &function_instances,
+                         const std::vector<size_t> &active_function_indices, const double *x,
+                         const double *p, std::vector<double> &values, bool &valid)
+{
+	if (valid || values.empty())
+		return;
+	valid = true;
 
-		if (has_parameter)
+	if (!thread_pool)
+	{
+		for (auto k : active_function_indices)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &grad_indices = inst.grad_indices;
+			auto &inst_vec = function_instances[k];
+			eval_fused_range(kernels[k], inst_vec, 0, inst_vec.size(), x, p, values.data());
+		}
+		return;
+	}
 
-				auto &p_indices = inst.ps;
-				kernel.grad_eval.p(x, p, grad, x_indices.data(), p_indices.data(),
-				                   grad_indices.data());
-			}
+	// every instance writes its own range of values
+	size_t n_threads = thread_pool->size();
+	thread_pool->run([&](size_t t) {
+		for_each_instance_range(function_instances, active_function_indices, t, n_threads,
+		                        [&](size_t k, size_t begin, size_t end) {
+			                        eval_fused_range(kernels[k], function_instances[k], begin, end,
+			                                         x, p, values.data());
+		                        });
+	});
+}
+
+// Sum of floating point numbers, Neumaier's variant of Kahan summation accumulates the rounding
+// errors in c if it is compensated
+struct Summation
+{
+	bool compensated;
+	double sum = 0.0;
+	double c = 0.0;
+
+	Summation(bool compensated_) : compensated(compensated_)
+	{
+	}
+
+	void add(double v)
+	{
+		if (!compensated)
+		{
+			sum += v;
+			return;
 		}
+		double t = sum + v;
+		if (std::abs(sum) >= std::abs(v))
+			c += (sum - t) + v;
 		else
+			c += (v - t) + sum;
+		sum = t;
+	}
+
+	double value() const
+	{
+		return sum + c;
+	}
+};
+
+// the sum of the objective terms [begin, end) of a kernel, the fused values are used if they are
+// given, otherwise the reduction kernel evaluates the instances in one call if it is assigned
+double eval_objective_range(const NonlinearFunction &kernel, const FunctionInstances &inst_vec,
+                            size_t begin, size_t end, const double *x, const double *p,
+                            const double *fused_values, bool compensated)
+{
+	Summation sum(compensated);
+	if (fused_values && kernel.has_fused_evaluator())
+	{
+		for (size_t i = begin; i < end; i++)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &grad_indices = inst.grad_indices;
+			sum.add(fused_values[inst_vec.fused_starts[i]]);
+		}
+		return sum.value();
+	}
 
-				kernel.grad_eval.nop(x, grad, x_indices.data(), grad_indices.data());
-			}
+	auto n = end - begin;
+	double y;
+	if (kernel.has_parameter)
+	{
+		if (kernel.f_sum_eval.p)
+		{
+			return kernel.f_sum_eval.p(n, x, p, inst_vec.x_indices(begin),
+			                           inst_vec.p_indices(begin), compensated);
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			kernel.f_eval.p(x, p, &y, inst_vec.x_indices(i), inst_vec.p_indices(i));
+			sum.add(y);
 		}
 	}
+	else
+	{
+		if (kernel.f_sum_eval.nop)
+		{
+			return kernel.f_sum_eval.nop(n, x, inst_vec.x_indices(begin), compensated);
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			kernel.f_eval.nop(x, &y, inst_vec.x_indices(i));
+			sum.add(y);
+		}
+	}
+	return sum.value();
 }
 
-void NonlinearFunctionModel::eval_constraint(const double *x, double *con)
+// the weights of instance i are w[y_start[i]:], w is lambda for constraints and sigma for
+// objective whose y_start is 0
+void eval_hessian_range(const NonlinearFunction &kernel, const FunctionInstances &inst_vec,
+                        size_t begin, size_t end, const double *x, const double *p,
+                        const double *w, double *hessian)
 {
-	double *p = this->p.data();
-	for (auto k : active_constraint_function_indices)
+	if (!kernel.has_hessian)
+		return;
+
+	auto n = end - begin;
+	auto hessian_nnz = kernel.m_hessian_nnz;
+	auto w_starts = inst_vec.y_starts.data() + begin;
+	auto hessian_indices = inst_vec.hessian_indices.data();
+	if (kernel.has_parameter)
 	{
-		auto &kernel = nl_functions[k];
-		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = constraint_function_instances[k];
-		if (has_parameter)
+		if (kernel.hessian_batch_eval.p)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				double *y = con + inst.eval_y_start;
-
-				auto &p_indices = inst.ps;
-				kernel.f_eval.p(x, p, y, x_indices.data(), p_indices.data());
-			}
+			kernel.hessian_batch_eval.p(n, x, p, w, hessian, inst_vec.x_indices(begin),
+			                            inst_vec.p_indices(begin), w_starts,
+			                            hessian_indices + begin * hessian_nnz);
+			return;
 		}
-		else
+		for (size_t i = begin; i < end; i++)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				double *y = con + inst.eval_y_start;
+			kernel.hessian_eval.p(x, p, w + inst_vec.y_starts[i], hessian, inst_vec.x_indices(i),
+			                      inst_vec.p_indices(i), hessian_indices + i * hessian_nnz);
+		}
+	}
+	else
+	{
+		if (kernel.hessian_batch_eval.nop)
+		{
+			kernel.hessian_batch_eval.nop(n, x, w, hessian, inst_vec.x_indices(begin), w_starts,
+			                              hessian_indices + begin * hessian_nnz);
+			return;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			kernel.hessian_eval.nop(x, w + inst_vec.y_starts[i], hessian, inst_vec.x_indices(i),
+			                        hessian_indices + i * hessian_nnz);
+		}
+	}
+}
+} // namespace
 
-				kernel.f_eval.nop(x, y, x_indices.data());
-			}
+void NonlinearFunctionModel::eval_objective(const double *x, double *y)
+{
+	// The reduction kernels evaluate the objective without its gradient, which is all the line
+	// search needs, so the fused values are only used if they are already evaluated at x or some
+	// kernel has no reduction kernel
+	const double *p = this->p.data();
+	bool has_sum_evaluators = true;
+	for (auto k : active_objective_function_indices)
+	{
+		auto &kernel = nl_functions[k];
+		if (kernel.has_fused_evaluator() && !kernel.has_sum_evaluator())
+		{
+			has_sum_evaluators = false;
+			break;
+		}
+	}
+	if (!has_sum_evaluators)
+	{
+		update_fused_values(thread_pool.get(), nl_functions, objective_function_instances,
+		                    active_objective_function_indices, x, p, objective_fused_values,
+		                    objective_fused_valid);
+	}
+	const double *fused_values = objective_fused_valid ? objective_fused_values.data() : nullptr;
+
+	// nonlinear objective terms
+	if (!thread_pool)
+	{
+		Summation obj(compensated_objective_sum);
+		for (auto k : active_objective_function_indices)
+		{
+			auto &inst_vec = objective_function_instances[k];
+			obj.add(eval_objective_range(nl_functions[k], inst_vec, 0, inst_vec.size(), x, p,
+			                             fused_values, compensated_objective_sum));
 		}
+		y[0] += obj.value();
+		return;
+	}
+
+	// the partial sums of threads are added in the order of threads, so the result does not
+	// depend on the scheduling of threads
+	size_t n_threads = thread_pool->size();
+	objective_partial_sums.assign(n_threads, 0.0);
+	thread_pool->run([&](size_t t) {
+		Summation partial(compensated_objective_sum);
+		for_each_instance_range(objective_function_instances, active_objective_function_indices, t,
+		                        n_threads, [&](size_t k, size_t begin, size_t end) {
+			                        partial.add(eval_objective_range(
+			                            nl_functions[k], objective_function_instances[k], begin,
+			                            end, x, p, fused_values, compensated_objective_sum));
+		                        });
+		objective_partial_sums[t] = partial.value();
+	});
+	Summation obj(compensated_objective_sum);
+	for (auto partial : objective_partial_sums)
+	{
+		obj.add(partial);
 	}
+	y[0] += obj.value();
 }
 
-void NonlinearFunctionModel::eval_constraint_jacobian(const double *x, double *jacobian)
+void NonlinearFunctionModel::eval_objective_gradient(const double *x, double *grad)
 {
 	double *p = this->p.data();
-	for (auto k : active_constraint_function_indices)
+	update_fused_values(thread_pool.get(), nl_functions, objective_function_instances,
+	                    active_objective_function_indices, x, p, objective_fused_values,
+	                    objective_fused_valid);
+
+	// nonlinear objective terms
+	for (auto k : active_objective_function_indices)
 	{
 		auto &kernel = nl_functions[k];
 		if (!kernel.has_jacobian)
 			continue;
 
 		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = constraint_function_instances[k];
+		auto &inst_vec = objective_function_instances[k];
+		auto n = inst_vec.size();
+		auto grad_indices = inst_vec.grad_indices.data();
+		auto grad_nnz = kernel.m_jacobian_nnz;
 
-		if (has_parameter)
+		if (kernel.has_fused_evaluator())
 		{
-			for (const auto &inst : inst_vec)
+			for (size_t i = 0; i < n; i++)
 			{
-				auto &x_indices = inst.xs;
-				double *j = jacobian + inst.jacobian_start;
+				// the gradient follows the objective value
+				const double *v = objective_fused_values.data() + inst_vec.fused_starts[i] + 1;
+				auto indices = grad_indices + i * grad_nnz;
+				for (size_t j = 0; j < grad_nnz; j++)
+				{
+					grad[indices[j]] += v[j];
+				}
+			}
+			continue;
+		}
 
-				auto &p_indices = inst.ps;
-				kernel.jacobian_eval.p(x, p, j, x_indices.data(), p_indices.data());
+		if (has_parameter)
+		{
+			if (kernel.grad_batch_eval.p)
+			{
+				kernel.grad_batch_eval.p(n, x, p, grad, inst_vec.xs.data(), inst_vec.ps.data(),
+				                         grad_indices);
+				continue;
+			}
+			for (size_t i = 0; i < n; i++)
+			{
+				kernel.grad_eval.p(x, p, grad, inst_vec.x_indices(i), inst_vec.p_indices(i),
+				                   grad_indices + i * grad_nnz);
 			}
 		}
 		else
 		{
-			for (const auto &inst : inst_vec)
+			if (kernel.grad_batch_eval.nop)
 			{
-				auto &x_indices = inst.xs;
-				double *j = jacobian + inst.jacobian_start;
-
-				kernel.jacobian_eval.nop(x, j, x_indices.data());
+				kernel.grad_batch_eval.nop(n, x, grad, inst_vec.xs.data(), grad_indices);
+				continue;
+			}
+			for (size_t i = 0; i < n; i++)
+			{
+				kernel.grad_eval.nop(x, grad, inst_vec.x_indices(i), grad_indices + i * grad_nnz);
 			}
 		}
 	}
 }
 
-void NonlinearFunctionModel::eval_lagrangian_hessian(const double *x, const double *sigma,
-                                                     const double *lambda, double *hessian)
+size_t NonlinearFunctionModel::get_n_threads() const
 {
-	double *p = this->p.data();
-	for (auto k : active_constraint_function_indices)
+	return thread_pool ? thread_pool->size() : 1;
+}
+
+void NonlinearFunctionModel::set_n_threads(size_t n_threads)
+{
+	if (n_threads <= 1)
 	{
-		auto &kernel = nl_functions[k];
-		if (!kernel.has_hessian)
-			continue;
+		thread_pool.reset();
+		hessian_buffers.clear();
+		return;
+	}
+	if (!thread_pool)
+	{
+		thread_pool = std::make_unique<ThreadPool>();
+	}
+	thread_pool->resize(n_threads);
+	hessian_buffers.resize(n_threads - 1);
+}
 
-		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = constraint_function_instances[k];
-		if (has_parameter)
+void NonlinearFunctionModel::eval_constraint(const double *x, double *con)
+{
+	// IPOPT evaluates only the constraints at the trial points of the line search and asks for
+	// the jacobian after a point is accepted, so the plain kernels are used unless the fused
+	// values are already evaluated at x
+	const double *p = this->p.data();
+	const double *fused_values = constraint_fused_valid ? constraint_fused_values.data() : nullptr;
+	if (!thread_pool)
+	{
+		for (auto k : active_constraint_function_indices)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &hessian_indices = inst.hessian_indices;
+			auto &inst_vec = constraint_function_instances[k];
+			eval_constraint_range(nl_functions[k], inst_vec, 0, inst_vec.size(), x, p,
+			                      fused_values, con);
+		}
+		return;
+	}
 
-				const double *w = lambda + inst.y_start;
+	// every instance writes its own outputs
+	size_t n_threads = thread_pool->size();
+	thread_pool->run([&](size_t t) {
+		for_each_instance_range(constraint_function_instances, active_constraint_function_indices,
+		                        t, n_threads, [&](size_t k, size_t begin, size_t end) {
+			                        eval_constraint_range(nl_functions[k],
+			                                              constraint_function_instances[k], begin,
+			                                              end, x, p, fused_values, con);
+		                        });
+	});
+}
 
-				auto &p_indices = inst.ps;
-				kernel.hessian_eval.p(x, p, w, hessian, x_indices.data(), p_indices.data(),
-				                      hessian_indices.data());
-			}
-		}
-		else
+void NonlinearFunctionModel::eval_constraint_jacobian(const double *x, double *jacobian)
+{
+	const double *p = this->p.data();
+	update_fused_values(thread_pool.get(), nl_functions, constraint_function_instances,
+	                    active_constraint_function_indices, x, p, constraint_fused_values,
+	                    constraint_fused_valid);
+	const double *fused_values = constraint_fused_values.data();
+	if (!thread_pool)
+	{
+		for (auto k : active_constraint_function_indices)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &hessian_indices = inst.hessian_indices;
+			auto &inst_vec = constraint_function_instances[k];
+			eval_constraint_jacobian_range(nl_functions[k], inst_vec, 0, inst_vec.size(), x, p,
+			                               fused_values, jacobian);
+		}
+		return;
+	}
 
-				const double *w = lambda + inst.y_start;
+	// every instance writes its own range of jacobian starting from jacobian_start
+	size_t n_threads = thread_pool->size();
+	thread_pool->run([&](size_t t) {
+		for_each_instance_range(constraint_function_instances, active_constraint_function_indices,
+		                        t, n_threads, [&](size_t k, size_t begin, size_t end) {
+			                        eval_constraint_jacobian_range(
+			                            nl_functions[k], constraint_function_instances[k], begin,
+			                            end, x, p, fused_values, jacobian);
+		                        });
+	});
+}
 
-				kernel.hessian_eval.nop(x, w, hessian, x_indices.data(), hessian_indices.data());
-			}
+void NonlinearFunctionModel::eval_lagrangian_hessian(const double *x, const double *sigma,
+                                                     const double *lambda, double *hessian)
+{
+	const double *p = this->p.data();
+	if (!thread_pool)
+	{
+		for (auto k : active_constraint_function_indices)
+		{
+			auto &inst_vec = constraint_function_instances[k];
+			eval_hessian_range(nl_functions[k], inst_vec, 0, inst_vec.size(), x, p, lambda,
+			                   hessian);
+		}
+		for (auto k : active_objective_function_indices)
+		{
+			auto &inst_vec = objective_function_instances[k];
+			eval_hessian_range(nl_functions[k], inst_vec, 0, inst_vec.size(), x, p, sigma, hessian);
 		}
+		return;
 	}
-	const double *w = sigma;
-	for (auto k : active_objective_function_indices)
-	{
-		auto &kernel = nl_functions[k];
-		if (!kernel.has_hessian)
-			continue;
 
-		bool has_parameter = kernel.has_parameter;
-		auto &inst_vec = objective_function_instances[k];
-		if (has_parameter)
+	// Instances of different threads may add to the same element of hessian, so the first
+	// thread adds to hessian directly and the other threads add to their own buffers, which are
+	// summed into hessian afterwards. The result does not depend on the scheduling of threads.
+	size_t n_threads = thread_pool->size();
+	thread_pool->run([&](size_t t) {
+		double *h = hessian;
+		if (t > 0)
 		{
-			for (const auto &inst : inst_vec)
-			{
-				auto &x_indices = inst.xs;
-				auto &hessian_indices = inst.hessian_indices;
-
-				auto &p_indices = inst.ps;
-				kernel.hessian_eval.p(x, p, w, hessian, x_indices.data(), p_indices.data(),
-				                      hessian_indices.data());
-			}
+			auto &buffer = hessian_buffers[t - 1];
+			buffer.assign(hessian_nnz, 0.0);
+			h = buffer.data();
 		}
-		else
+		for_each_instance_range(constraint_function_instances, active_constraint_function_indices,
+		                        t, n_threads, [&](size_t k, size_t begin, size_t end) {
+			                        eval_hessian_range(nl_functions[k],
+			                                           constraint_function_instances[k], begin, end,
+			                                           x, p, lambda, h);
+		                        });
+		for_each_instance_range(objective_function_instances, active_objective_function_indices, t,
+		                        n_threads, [&](size_t k, size_t begin, size_t end) {
+			                        eval_hessian_range(nl_functions[k],
+			                                           objective_function_instances[k], begin, end,
+			                                           x, p, sigma, h);
+		                        });
+	});
+	thread_pool->run([&](size_t t) {
+		size_t begin = hessian_nnz * t / n_threads;
+		size_t end = hessian_nnz * (t + 1) / n_threads;
+		for (const auto &buffer : hessian_buffers)
 		{
-			for (const auto &inst : inst_vec)
+			for (size_t i = begin; i < end; i++)
 			{
-				auto &x_indices = inst.xs;
-				auto &hessian_indices = inst.hessian_indices;
-
-				kernel.hessian_eval.nop(x, w, hessian, x_indices.data(), hessian_indices.data());
+				hessian[i] += buffer[i];
 			}
 		}
-	}
+	});
 }
@@ -0,0 +1,345 @@
+#include <cstring>
+
+#include "fmt/format.h"
+#include "pyoptinterface/nlcore.hpp"
+
+// Binary format of cpp_graph and of the analysis of NonlinearFunction
+//
+// A graph is written as
+//   uint64 n_dynamic_ind, uint64 n_variable_ind
+//   string function_name
+//   string lists discrete_name_vec, atomic_name_vec, print_text_vec
+//   arrays constant_vec (double), operator_vec (int32), operator_arg (uint64), dependent_vec
+//   (uint64)
+// Every array is a uint64 length followed by its raw elements, a string is an array of chars and
+// a string list is a uint64 count followed by the strings.
+//
+// The analysis starts with a header:
+//   char[8] magic "POINLFN\0"
+//   uint32 version
+//   uint32 byte order mark 0x01020304, the arrays are written in the byte order of the writer
+// and is followed by nx, np, ny as uint64, the rows and columns of the jacobian and hessian
+// sparsity patterns, the jacobian and fused graphs if the jacobian is not empty and the hessian
+// graph if the hessian is not empty.
+//
+// The serialized f_graph is the key of the kernel cache, it must not contain anything that
+// depends on the values used in tracing.
+namespace
+{
+constexpr char ANALYSIS_MAGIC[8] = {'P', 'O', 'I', 'N', 'L', 'F', 'N', '\0'};
+constexpr std::uint32_t ANALYSIS_VERSION = 2;
+constexpr std::uint32_t ANALYSIS_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(CppAD::graph::graph_op_enum) <= 4, "graph operators are written as int32");
+
+class Writer
+{
+  public:
+	void raw(const void *data, std::size_t size)
+	{
+		buffer.append(static_cast<const char *>(data), size);
+	}
+
+	template <typename T>
+	void value(const T &v)
+	{
+		raw(&v, sizeof(T));
+	}
+
+	template <typename T>
+	void array(const std::vector<T> &v)
+	{
+		value<std::uint64_t>(v.size());
+		raw(v.data(), v.size() * sizeof(T));
+	}
+
+	void string(const std::string &s)
+	{
+		value<std::uint64_t>(s.size());
+		raw(s.data(), s.size());
+	}
+
+	void graph(const cpp_graph &g)
+	{
+		value<std::uint64_t>(g.n_dynamic_ind_get());
+		value<std::uint64_t>(g.n_variable_ind_get());
+		string(g.function_name_get());
+
+		auto strings = [this](size_t n, auto get) {
+			value<std::uint64_t>(n);
+			for (size_t i = 0; i < n; i++)
+			{
+				string(get(i));
+			}
+		};
+		strings(g.discrete_name_vec_size(), [&](size_t i) { return g.discrete_name_vec_get(i); });
+		strings(g.atomic_name_vec_size(), [&](size_t i) { return g.atomic_name_vec_get(i); });
+		strings(g.print_text_vec_size(), [&](size_t i) { return g.print_text_vec_get(i); });
+
+		std::vector<double> constants(g.constant_vec_size());
+		for (size_t i = 0; i < constants.size(); i++)
+		{
+			constants[i] = g.constant_vec_get(i);
+		}
+		array(constants);
+
+		std::vector<std::int32_t> operators(g.operator_vec_size());
+		for (size_t i = 0; i < operators.size(); i++)
+		{
+			operators[i] = static_cast<std::int32_t>(g.operator_vec_get(i));
+		}
+		array(operators);
+
+		std::vector<std::uint64_t> args(g.operator_arg_size());
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			args[i] = g.operator_arg_get(i);
+		}
+		array(args);
+
+		std::vector<std::uint64_t> dependents(g.dependent_vec_size());
+		for (size_t i = 0; i < dependents.size(); i++)
+		{
+			dependents[i] = g.dependent_vec_get(i);
+		}
+		array(dependents);
+	}
+
+	std::string buffer;
+};
+
+class Reader
+{
+  public:
+	Reader(const std::string &data) : data(data)
+	{
+	}
+
+	void raw(void *dst, std::size_t size)
+	{
+		if (data.size() - offset < size)
+		{
+			throw std::runtime_error("The serialized nonlinear function is truncated");
+		}
+		std::memcpy(dst, data.data() + offset, size);
+		offset += size;
+	}
+
+	template <typename T>
+	T value()
+	{
+		T v;
+		raw(&v, sizeof(T));
+		return v;
+	}
+
+	template <typename T>
+	void array(std::vector<T> &v)
+	{
+		auto n = value<std::uint64_t>();
+		if ((data.size() - offset) / sizeof(T) < n)
+		{
+			throw std::runtime_error("The serialized nonlinear function is truncated");
+		}
+		v.resize(n);
+		raw(v.data(), n * sizeof(T));
+	}
+
+	std::string string()
+	{
+		std::vector<char> chars;
+		array(chars);
+		return std::string(chars.begin(), chars.end());
+	}
+
+	void graph(cpp_graph &g)
+	{
+		g.initialize();
+		g.n_dynamic_ind_set(value<std::uint64_t>());
+		g.n_variable_ind_set(value<std::uint64_t>());
+		g.function_name_set(string());
+
+		auto n = value<std::uint64_t>();
+		for (size_t i = 0; i < n; i++)
+		{
+			g.discrete_name_vec_push_back(string());
+		}
+		n = value<std::uint64_t>();
+		for (size_t i = 0; i < n; i++)
+		{
+			g.atomic_name_vec_push_back(string());
+		}
+		n = value<std::uint64_t>();
+		for (size_t i = 0; i < n; i++)
+		{
+			g.print_text_vec_push_back(string());
+		}
+
+		std::vector<double> constants;
+		array(constants);
+		for (auto c : constants)
+		{
+			g.constant_vec_push_back(c);
+		}
+
+		std::vector<std::int32_t> operators;
+		array(operators);
+		for (auto op : operators)
+		{
+			if (op < 0 || op >= CppAD::graph::n_graph_op)
+			{
+				throw std::runtime_error(fmt::format("Unknown graph operator {}", op));
+			}
+			g.operator_vec_push_back(static_cast<CppAD::graph::graph_op_enum>(op));
+		}
+
+		std::vector<std::uint64_t> args;
+		array(args);
+		for (auto arg : args)
+		{
+			g.operator_arg_push_back(arg);
+		}
+
+		std::vector<std::uint64_t> dependents;
+		array(dependents);
+		for (auto d : dependents)
+		{
+			g.dependent_vec_push_back(d);
+		}
+	}
+
+	bool at_end() const
+	{
+		return offset == data.size();
+	}
+
+  private:
+	const std::string &data;
+	std::size_t offset = 0;
+};
+
+std::vector<std::uint64_t> to_u64(const std::vector<size_t> &v)
+{
+	return std::vector<std::uint64_t>(v.begin(), v.end());
+}
+
+std::vector<size_t> from_u64(const std::vector<std::uint64_t> &v)
+{
+	return std::vector<size_t>(v.begin(), v.end());
+}
+} // namespace
+
+std::string serialize_cpp_graph(const cpp_graph &graph)
+{
+	Writer writer;
+	writer.graph(graph);
+	return std::move(writer.buffer);
+}
+
+void deserialize_cpp_graph(const std::string &data, cpp_graph &graph)
+{
+	Reader reader(data);
+	reader.graph(graph);
+	if (!reader.at_end())
+	{
+		throw std::runtime_error("Trailing bytes after the serialized graph");
+	}
+}
+
+std::string NonlinearFunction::save_analysis() const
+{
+	Writer writer;
+	writer.raw(ANALYSIS_MAGIC, sizeof(ANALYSIS_MAGIC));
+	writer.value(ANALYSIS_VERSION);
+	writer.value(ANALYSIS_BYTE_ORDER);
+
+	writer.value<std::uint64_t>(nx);
+	writer.value<std::uint64_t>(np);
+	writer.value<std::uint64_t>(ny);
+	writer.array(to_u64(m_jacobian_rows));
+	writer.array(to_u64(m_jacobian_cols));
+	writer.array(to_u64(m_hessian_rows));
+	writer.array(to_u64(m_hessian_cols));
+	if (has_jacobian)
+	{
+		writer.graph(jacobian_graph);
+		writer.graph(fused_graph);
+	}
+	if (has_hessian)
+	{
+		writer.graph(hessian_graph);
+	}
+	return std::move(writer.buffer);
+}
+
+void NonlinearFunction::init_from_analysis(ADFunD &f_, const std::string &name_,
+                                           const std::string &data)
+{
+	Reader reader(data);
+
+	char magic[8];
+	reader.raw(magic, sizeof(magic));
+	if (std::memcmp(magic, ANALYSIS_MAGIC, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error("Not a serialized nonlinear function");
+	}
+	auto version = reader.value<std::uint32_t>();
+	if (version != ANALYSIS_VERSION)
+	{
+		throw std::runtime_error(
+		    fmt::format("Unsupported version {} of serialized nonlinear function", version));
+	}
+	if (reader.value<std::uint32_t>() != ANALYSIS_BYTE_ORDER)
+	{
+		throw std::runtime_error("The serialized nonlinear function has another byte order");
+	}
+
+	nx = f_.Domain();
+	np = f_.size_dyn_ind();
+	ny = f_.Range();
+	if (reader.value<std::uint64_t>() != nx || reader.value<std::uint64_t>() != np ||
+	    reader.value<std::uint64_t>() != ny)
+	{
+		throw std::runtime_error("The serialized nonlinear function has other dimensions");
+	}
+	has_parameter = np > 0;
+	name = name_;
+
+	f_.to_graph(f_graph);
+
+	std::vector<std::uint64_t> rows, cols;
+	reader.array(rows);
+	reader.array(cols);
+	m_jacobian_rows = from_u64(rows);
+	m_jacobian_cols = from_u64(cols);
+	m_jacobian_nnz = m_jacobian_rows.size();
+
+	reader.array(rows);
+	reader.array(cols);
+	m_hessian_rows = from_u64(rows);
+	m_hessian_cols = from_u64(cols);
+	m_hessian_nnz = m_hessian_rows.size();
+
+	if (m_jacobian_cols.size() != m_jacobian_nnz || m_hessian_cols.size() != m_hessian_nnz)
+	{
+		throw std::runtime_error("The serialized sparsity pattern is corrupted");
+	}
+
+	has_jacobian = m_jacobian_nnz > 0;
+	if (has_jacobian)
+	{
+		reader.graph(jacobian_graph);
+		has_fused = true;
+		reader.graph(fused_graph);
+	}
+	has_hessian = m_hessian_nnz > 0;
+	if (has_hessian)
+	{
+		reader.graph(hessian_graph);
+	}
+
+	if (!reader.at_end())
+	{
+		throw std::runtime_error("Trailing bytes after the serialized nonlinear function");
+	}
+}
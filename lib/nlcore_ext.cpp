@@ -142,6 +142,7 @@ NB_MODULE(nlcore_ext, m)
 	m.def("initialize_cpp_graph_operator_info", []() { CppAD::local::graph::set_operator_info(); });
 
 	nb::class_<cpp_graph>(m, "cpp_graph")
+	    .def(nb::init<>())
 	    .def_prop_ro("n_dynamic_ind", [](cpp_graph &g) { return g.n_dynamic_ind_get(); })
 	    .def_prop_ro("n_variable_ind", [](cpp_graph &g) { return g.n_variable_ind_get(); })
 	    .def_prop_ro("n_constant", [](cpp_graph &g) { return g.constant_vec_size(); })
@@ -171,6 +172,11 @@ NB_MODULE(nlcore_ext, m)
 	         })
 	    .def("next_cursor", &advance_graph_cursor);
 
+	m.def("serialize_cpp_graph", [](const cpp_graph &graph) {
+		auto data = serialize_cpp_graph(graph);
+		return nb::bytes(data.data(), data.size());
+	});
+
 	nb::class_<ADFun>(m, "ADFun")
 	    .def(nb::init<>())
 	    .def(nb::init<advec &, advec &>())
@@ -291,13 +297,23 @@ NB_MODULE(nlcore_ext, m)
 	    .def_ro("f_graph", &NonlinearFunction::f_graph)
 	    .def_ro("jacobian_graph", &NonlinearFunction::jacobian_graph)
 	    .def_ro("hessian_graph", &NonlinearFunction::hessian_graph)
+	    .def_ro("has_fused", &NonlinearFunction::has_fused)
+	    .def_ro("fused_graph", &NonlinearFunction::fused_graph)
 	    .def_ro("m_jacobian_nnz", &NonlinearFunction::m_jacobian_nnz)
 	    .def_ro("m_hessian_nnz", &NonlinearFunction::m_hessian_nnz)
 	    .def_ro("m_jacobian_rows", &NonlinearFunction::m_jacobian_rows)
 	    .def_ro("m_jacobian_cols", &NonlinearFunction::m_jacobian_cols)
 	    .def_ro("m_hessian_rows", &NonlinearFunction::m_hessian_rows)
 	    .def_ro("m_hessian_cols", &NonlinearFunction::m_hessian_cols)
-	    .def("assign_evaluators", &NonlinearFunction::assign_evaluators);
+	    .def("save_analysis",
+	         [](const NonlinearFunction &f) {
+		         auto data = f.save_analysis();
+		         return nb::bytes(data.data(), data.size());
+	         })
+	    .def("assign_evaluators", &NonlinearFunction::assign_evaluators)
+	    .def("assign_batch_evaluators", &NonlinearFunction::assign_batch_evaluators)
+	    .def("assign_fused_evaluators", &NonlinearFunction::assign_fused_evaluators)
+	    .def("assign_sum_evaluator", &NonlinearFunction::assign_sum_evaluator);
 
 	nb::class_<ParameterIndex>(m, "ParameterIndex")
 	    .def(nb::init<IndexT>())
@@ -0,0 +1,130 @@
+#include "pyoptinterface/thread_pool.hpp"
+
+ThreadPool::~ThreadPool()
+{
+	stop_workers();
+}
+
+size_t ThreadPool::size() const
+{
+	return m_workers.size() + 1;
+}
+
+void ThreadPool::resize(size_t n_threads)
+{
+	if (n_threads == 0)
+	{
+		n_threads = 1;
+	}
+	if (n_threads == size())
+	{
+		return;
+	}
+	stop_workers();
+	m_stop = false;
+	m_workers.reserve(n_threads - 1);
+	for (size_t i = 1; i < n_threads; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::worker_loop, this, i, m_generation);
+	}
+}
+
+void ThreadPool::run(const std::function<void(size_t)> &f)
+{
+	if (m_workers.empty())
+	{
+		f(0);
+		return;
+	}
+	{
+		std::lock_guard lock(m_mutex);
+		m_task = &f;
+		m_n_running = m_workers.size();
+		m_exception = nullptr;
+		m_generation++;
+	}
+	m_start_cv.notify_all();
+
+	// the workers still use f, so the caller waits for them even if f(0) throws
+	try
+	{
+		f(0);
+	}
+	catch (...)
+	{
+		std::lock_guard lock(m_mutex);
+		if (!m_exception)
+		{
+			m_exception = std::current_exception();
+		}
+	}
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock lock(m_mutex);
+		m_finish_cv.wait(lock, [this] { return m_n_running == 0; });
+		m_task = nullptr;
+		std::swap(exception, m_exception);
+	}
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::stop_workers()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_start_cv.notify_all();
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void ThreadPool::worker_loop(size_t thread_id, size_t generation)
+{
+	while (true)
+	{
+		const std::function<void(size_t)> *task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_start_cv.wait(lock, [&] { return m_stop || m_generation != generation; });
+			if (m_stop)
+			{
+				return;
+			}
+			generation = m_generation;
+			task = m_task;
+		}
+
+		std::exception_ptr exception;
+		try
+		{
+			(*task)(thread_id);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		bool last = false;
+		{
+			std::lock_guard lock(m_mutex);
+			if (exception && !m_exception)
+			{
+				m_exception = exception;
+			}
+			m_n_running--;
+			last = m_n_running == 0;
+		}
+		if (last)
+		{
+			m_finish_cv.notify_one();
+		}
+	}
+}
@@ -2,6 +2,7 @@ from pyoptinterface._src.core_ext import (
     VariableIndex,
     ConstraintIndex,
     ExprBuilder,
+    FlatExprBuilder,
     VariableDomain,
     ConstraintSense,
     ConstraintType,
@@ -24,7 +25,9 @@ from pyoptinterface._src.tupledict import (
     make_tupledict,
 )
 
-from pyoptinterface._src.aml import make_nd_variable, quicksum, quicksum_
+from pyoptinterface._src.aml import make_nd_variable, quicksum, quicksum_, flat_quicksum
+
+from pyoptinterface._src.cache_model import CacheModel
 
 from pyoptinterface._src.nlcore_ext import (
     abs,
@@ -68,6 +71,7 @@ __all__ = [
     "VariableIndex",
     "ConstraintIndex",
     "ExprBuilder",
+    "FlatExprBuilder",
     "VariableDomain",
     "ConstraintSense",
     "ConstraintType",
@@ -85,6 +89,8 @@ __all__ = [
     "make_nd_variable",
     "quicksum",
     "quicksum_",
+    "flat_quicksum",
+    "CacheModel",
     "Eq",
     "Leq",
     "Geq",
@@ -1,7 +1,8 @@
-from .core_ext import ExprBuilder
-from .tupledict import make_tupledict
+from .core_ext import ExprBuilder, FlatExprBuilder, VariableIndex
+from .tupledict import tupledict, make_tupledict, flatten_tuple
 
 from collections.abc import Collection
+from itertools import product
 
 
 def make_nd_variable(
@@ -30,43 +31,43 @@ def make_nd_variable(
     return td
 
 
-# def make_nd_variable_batch(
-#     model,
-#     *coords: Collection,
-#     domain=None,
-#     lb=None,
-#     ub=None,
-#     name=None,
-# ):
-#     assert model.supports_batch_add_variables()
-#
-#     kw_args = dict()
-#     if domain is not None:
-#         kw_args["domain"] = domain
-#     if lb is not None:
-#         kw_args["lb"] = lb
-#     if ub is not None:
-#         kw_args["ub"] = ub
-#
-#     N = math.prod(len(c) for c in coords)
-#
-#     start_vi = model.add_variables(N, **kw_args)
-#     start_index = start_vi.index
-#
-#     kvs = []
-#     assert len(coords) > 0
-#     for i, coord in enumerate(product(*coords)):
-#         coord = tuple(flatten_tuple(coord))
-#         value = VariableIndex(start_index + i)
-#         if len(coord) == 1:
-#             coord = coord[0]
-#         if value is not None:
-#             kvs.append((coord, value))
-#
-#         suffix = str(coord)
-#         if name is not None:
-#             model.set_variable_name(value, f"{name}{suffix}")
-#     return tupledict(kvs)
+def make_nd_variable_batch(
+    model,
+    *coords: Collection,
+    domain=None,
+    lb=None,
+    ub=None,
+    name=None,
+):
+    assert len(coords) > 0
+
+    keys = []
+    names = []
+    for coord in product(*coords):
+        coord = tuple(flatten_tuple(coord))
+        if name is not None:
+            suffix = str(coord)
+            names.append(f"{name}{suffix}")
+        if len(coord) == 1:
+            coord = coord[0]
+        keys.append(coord)
+
+    kw_args = dict()
+    if domain is not None:
+        kw_args["domains"] = [domain]
+    if lb is not None:
+        kw_args["lbs"] = [lb]
+    if ub is not None:
+        kw_args["ubs"] = [ub]
+    if name is not None:
+        kw_args["names"] = names
+
+    # the indices of variables created in one batch are contiguous
+    start_index = model.add_variables_batch(len(keys), **kw_args).index
+
+    return tupledict(
+        (coord, VariableIndex(start_index + i)) for i, coord in enumerate(keys)
+    )
 
 
 def quicksum_(expr: ExprBuilder, terms, f=None):
@@ -84,3 +85,12 @@ def quicksum(terms, f=None):
     expr = ExprBuilder()
     quicksum_(expr, terms, f)
     return expr
+
+
+def flat_quicksum(terms, f=None):
+    expr = FlatExprBuilder()
+    quicksum_(expr, terms, f)
+    if expr.degree() < 2:
+        return expr.to_affine()
+    else:
+        return expr.to_quadratic()
@@ -0,0 +1,24 @@
+import types
+
+from .core_ext import CacheModel as RawCacheModel
+from .aml import make_nd_variable_batch
+
+
+class CacheModel(RawCacheModel):
+    """A solver-independent model that stores variables and constraints in memory.
+
+    It can be built without any solver and loaded into a solver model later by `flush`.
+    """
+
+    def __init__(self):
+        super().__init__()
+
+        self.add_variables = types.MethodType(make_nd_variable_batch, self)
+
+    def flush(self, model):
+        """Add the whole cached model into `model` (Gurobi, COPT, MOSEK or HiGHS).
+
+        Returns the handles assigned by `model`, `handles.variable(v)` and
+        `handles.constraint(c)` map the handles of the cache to those of `model`.
+        """
+        return model.load_cache(self)
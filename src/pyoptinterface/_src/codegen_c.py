@@ -294,3 +294,158 @@ void {name}(
     extern_function_declaration = "extern " + function_prototype
 
     return extern_function_declaration
+
+
+def generate_csrc_batch_from_graph(
+    io: IO[str],
+    graph_obj,
+    name: str,
+    np: int = 0,
+    hessian_lagrange: bool = False,
+    nw: int = 0,
+    indirect_y: bool = False,
+):
+    # {name}_batch evaluates n instances of {name} in one call
+    # {name} must be generated by generate_csrc_from_graph with indirect_x, indirect_p and the
+    # same arguments
+    # the indices of instance i are xi[i * nx:], pi[i * np:] and yi[i * ny:]
+    # its weights start from w + wo[i] and its output starts from y + yo[i] if y is direct
+    n_dynamic_ind = graph_obj.n_dynamic_ind
+    n_variable_ind = graph_obj.n_variable_ind
+    n_dependent = graph_obj.n_dependent
+
+    if not hessian_lagrange:
+        nx = n_dynamic_ind + n_variable_ind - np
+    else:
+        nx = n_dynamic_ind + n_variable_ind - np - nw
+    ny = n_dependent
+
+    has_parameter = np > 0
+
+    function_args_signature = ["size_t n", "const float_point_t* x"]
+    call_args = ["x"]
+    if has_parameter:
+        function_args_signature.append("const float_point_t* p")
+        call_args.append("p")
+    if hessian_lagrange:
+        function_args_signature.append("const float_point_t* w")
+        call_args.append("w + wo[i]")
+    function_args_signature.append("float_point_t* y")
+    if indirect_y:
+        call_args.append("y")
+    else:
+        call_args.append("y + yo[i]")
+    function_args_signature.append("const size_t* xi")
+    call_args.append(f"xi + i * {nx}")
+    if has_parameter:
+        function_args_signature.append("const size_t* pi")
+        call_args.append(f"pi + i * {np}")
+    if hessian_lagrange:
+        function_args_signature.append("const size_t* wo")
+    if indirect_y:
+        function_args_signature.append("const size_t* yi")
+        call_args.append(f"yi + i * {ny}")
+    else:
+        function_args_signature.append("const size_t* yo")
+
+    function_args = ", ".join(function_args_signature)
+    batch_name = name + "_batch"
+
+    function_prototype = f"""
+void {batch_name}(
+    {function_args}
+)
+"""
+    io.write(function_prototype)
+
+    call = ", ".join(call_args)
+    io.write(
+        f"""{{
+    for (size_t i = 0; i < n; i++)
+    {{
+        {name}({call});
+    }}
+}}
+"""
+    )
+
+    extern_function_declaration = "extern " + function_prototype
+
+    return extern_function_declaration
+
+
+def generate_csrc_sum_from_graph(
+    io: IO[str],
+    graph_obj,
+    name: str,
+    np: int = 0,
+):
+    # {name}_sum returns the sum of the output of n instances of {name}, which has ny = 1
+    # {name} must be generated by generate_csrc_from_graph with indirect_x and indirect_p
+    # the indices of instance i are xi[i * nx:] and pi[i * np:]
+    # the sum stays in a register, it is compensated by Neumaier's variant of Kahan summation if
+    # compensated != 0
+    n_dynamic_ind = graph_obj.n_dynamic_ind
+    n_variable_ind = graph_obj.n_variable_ind
+    assert graph_obj.n_dependent == 1
+
+    nx = n_dynamic_ind + n_variable_ind - np
+
+    has_parameter = np > 0
+
+    function_args_signature = ["size_t n", "const float_point_t* x"]
+    call_args = ["x"]
+    if has_parameter:
+        function_args_signature.append("const float_point_t* p")
+        call_args.append("p")
+    call_args.append("&y")
+    function_args_signature.append("const size_t* xi")
+    call_args.append(f"xi + i * {nx}")
+    if has_parameter:
+        function_args_signature.append("const size_t* pi")
+        call_args.append(f"pi + i * {np}")
+    function_args_signature.append("int compensated")
+
+    function_args = ", ".join(function_args_signature)
+    sum_name = name + "_sum"
+
+    function_prototype = f"""
+float_point_t {sum_name}(
+    {function_args}
+)
+"""
+    io.write(function_prototype)
+
+    call = ", ".join(call_args)
+    io.write(
+        f"""{{
+    float_point_t sum = 0.0;
+    float_point_t c = 0.0;
+    float_point_t y;
+    if (compensated)
+    {{
+        for (size_t i = 0; i < n; i++)
+        {{
+            {name}({call});
+            float_point_t t = sum + y;
+            if (fabs(sum) >= fabs(y))
+                c += (sum - t) + y;
+            else
+                c += (y - t) + sum;
+            sum = t;
+        }}
+        return sum + c;
+    }}
+    for (size_t i = 0; i < n; i++)
+    {{
+        {name}({call});
+        sum += y;
+    }}
+    return sum;
+}}
+"""
+    )
+
+    extern_function_declaration = "extern " + function_prototype
+
+    return extern_function_declaration
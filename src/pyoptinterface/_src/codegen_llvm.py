@@ -497,3 +497,577 @@ def generate_llvmir_from_graph(
 
     # Return from the function
     builder.ret_void()
+
+
+# math functions that have vector intrinsics in LLVM
+simd_intrinsics = {
+    graph_op.abs: "llvm.fabs",
+    graph_op.sqrt: "llvm.sqrt",
+}
+
+
+# Evaluate the graph for simd_width instances at once in <simd_width x double>
+# the loaders return the vector of an input node, store(k, val) writes the output k
+def generate_llvmir_simd_body(
+    module: ir.Module,
+    builder: ir.IRBuilder,
+    graph_obj,
+    simd_width: int,
+    np: int,
+    nw: int,
+    load_p,
+    load_w,
+    load_x,
+    store,
+):
+    n_dynamic_ind = graph_obj.n_dynamic_ind
+    n_variable_ind = graph_obj.n_variable_ind
+    n_constant = graph_obj.n_constant
+    n_dependent = graph_obj.n_dependent
+
+    VD = ir.VectorType(D, simd_width)
+
+    input_dict = {}
+    v_dict = {}
+
+    def get_node_value(node: int):
+        if node < 1:
+            raise ValueError(f"Invalid node: {node}")
+        if node < 1 + n_dynamic_ind + n_variable_ind + n_constant:
+            val = input_dict.get(node, None)
+            if val is not None:
+                return val
+            if node < 1 + np:
+                val = load_p(node - 1)
+            elif node < 1 + np + nw:
+                val = load_w(node - 1 - np)
+            elif node < 1 + n_dynamic_ind + n_variable_ind:
+                val = load_x(node - 1 - np - nw)
+            else:
+                c_index = node - 1 - n_dynamic_ind - n_variable_ind
+                c = graph_obj.constant_vec_get(c_index)
+                val = ir.Constant(VD, [c] * simd_width)
+            input_dict[node] = val
+            return val
+        v_index = node - 1 - n_dynamic_ind - n_variable_ind - n_constant
+        val = v_dict.get(v_index, None)
+        if val is None:
+            raise ValueError(f"Node value not found: {v_index}")
+        return val
+
+    # math functions without vector version are called for each lane
+    def call_per_lane(function, args):
+        ret_val = ir.Constant(VD, ir.Undefined)
+        for lane in range(simd_width):
+            lane_args = [builder.extract_element(arg, I(lane)) for arg in args]
+            lane_val = builder.call(function, lane_args)
+            ret_val = builder.insert_element(ret_val, lane_val, I(lane))
+        return ret_val
+
+    arithmetic_flags = ("fast",)
+    sign = module.get_global("sign")
+
+    result_node = 0
+    for iter in cpp_graph_iterator(graph_obj):
+        op = iter.op
+        n_result = iter.n_result
+        args = iter.args
+
+        assert n_result == 1
+        assert len(args) <= 2
+
+        arg1 = get_node_value(args[0])
+        if len(args) == 2:
+            arg2 = get_node_value(args[1])
+
+        if op == graph_op.add:
+            ret_val = builder.fadd(arg1, arg2, flags=arithmetic_flags)
+        elif op == graph_op.sub:
+            ret_val = builder.fsub(arg1, arg2, flags=arithmetic_flags)
+        elif op == graph_op.mul:
+            ret_val = builder.fmul(arg1, arg2, flags=arithmetic_flags)
+        elif op == graph_op.div:
+            ret_val = builder.fdiv(arg1, arg2, flags=arithmetic_flags)
+        elif op == graph_op.azmul:
+            ret_val = builder.fmul(arg1, arg2, flags=arithmetic_flags)
+        elif op == graph_op.neg:
+            ret_val = builder.fneg(arg1, flags=arithmetic_flags)
+        elif op == graph_op.sign:
+            ret_val = call_per_lane(sign, [arg1])
+        elif op in simd_intrinsics:
+            intrinsic_name = f"{simd_intrinsics[op]}.v{simd_width}f64"
+            intrinsic = module.globals.get(intrinsic_name, None)
+            if intrinsic is None:
+                intrinsic_type = ir.FunctionType(VD, [VD])
+                intrinsic = ir.Function(module, intrinsic_type, name=intrinsic_name)
+            ret_val = builder.call(intrinsic, [arg1])
+        elif op in math_ops:
+            op_function = module.get_global(op2name[op])
+            if op in binary_ops:
+                ret_val = call_per_lane(op_function, [arg1, arg2])
+            else:
+                ret_val = call_per_lane(op_function, [arg1])
+        else:
+            raise ValueError(f"Unknown op_enum: {op}")
+
+        v_dict[result_node] = ret_val
+
+        result_node += n_result
+
+    for i in range(n_dependent):
+        node = graph_obj.dependent_vec_get(i)
+        val = get_node_value(node)
+        store(i, val)
+
+
+# Define the batched entry point of a function generated by generate_llvmir_from_graph
+def generate_llvmir_batch_from_graph(
+    module: ir.Module,
+    graph_obj,
+    name: str,
+    np: int = 0,
+    hessian_lagrange: bool = False,
+    nw: int = 0,
+    indirect_y: bool = False,
+    add_y: bool = False,
+    simd_width: int = 1,
+):
+    # {name}_batch evaluates n instances of {name} in one call
+    # {name} must be generated with indirect_x, indirect_p and the same arguments
+    # the indices of instance i are xi[i * nx:], pi[i * np:] and yi[i * ny:]
+    # its weights start from w + wo[i] and its output starts from y + yo[i] if y is direct
+    # if simd_width > 1, simd_width instances are evaluated at once with vector instructions
+    # and the remaining instances are evaluated by {name}
+    n_dynamic_ind = graph_obj.n_dynamic_ind
+    n_variable_ind = graph_obj.n_variable_ind
+    n_dependent = graph_obj.n_dependent
+
+    if not hessian_lagrange:
+        nx = n_dynamic_ind + n_variable_ind - np
+        nw = 0
+    else:
+        nx = n_dynamic_ind + n_variable_ind - np - nw
+    ny = n_dependent
+
+    has_parameter = np > 0
+
+    func_args = [SZ, D_PTR]
+    arg_names = ["n", "x"]
+    if has_parameter:
+        func_args.append(D_PTR)
+        arg_names.append("p")
+    if hessian_lagrange:
+        func_args.append(D_PTR)
+        arg_names.append("w")
+    func_args.append(D_PTR)
+    arg_names.append("y")
+    func_args.append(SZ_PTR)
+    arg_names.append("xi")
+    if has_parameter:
+        func_args.append(SZ_PTR)
+        arg_names.append("pi")
+    if hessian_lagrange:
+        func_args.append(SZ_PTR)
+        arg_names.append("wo")
+    func_args.append(SZ_PTR)
+    if indirect_y:
+        arg_names.append("yi")
+    else:
+        arg_names.append("yo")
+
+    func_type = ir.FunctionType(ir.VoidType(), func_args)
+    func = ir.Function(module, func_type, name=name + "_batch")
+
+    args_dict = {}
+    for i, arg in enumerate(func.args):
+        arg.name = arg_names[i]
+        args_dict[arg.name] = arg
+    n = args_dict["n"]
+    x = args_dict["x"]
+    p = args_dict.get("p", None)
+    w = args_dict.get("w", None)
+    y = args_dict["y"]
+    xi = args_dict["xi"]
+    pi = args_dict.get("pi", None)
+    wo = args_dict.get("wo", None)
+    yi = args_dict.get("yi", None)
+    yo = args_dict.get("yo", None)
+
+    scalar_func = module.get_global(name)
+    if scalar_func is None:
+        raise ValueError(f"Function {name} not found in module")
+
+    entry_block = func.append_basic_block(name="entry")
+    builder = ir.IRBuilder(entry_block)
+
+    def row(ptr, i, ncol):
+        offset = builder.mul(i, SZ(ncol))
+        return builder.gep(ptr, [offset])
+
+    def offset_by(ptr, offsets, i):
+        offset_ptr = builder.gep(offsets, [i])
+        offset = builder.load(offset_ptr)
+        return builder.gep(ptr, [offset])
+
+    # instances [0, n_simd) are evaluated by the vector loop
+    if simd_width > 1:
+        n_simd = builder.mul(
+            builder.udiv(n, SZ(simd_width)), SZ(simd_width), name="n_simd"
+        )
+    else:
+        n_simd = SZ(0)
+
+    if simd_width > 1:
+        simd_block = func.append_basic_block(name="simd_loop")
+    tail_check_block = func.append_basic_block(name="tail_check")
+    tail_block = func.append_basic_block(name="tail_loop")
+    exit_block = func.append_basic_block(name="exit")
+
+    if simd_width > 1:
+        is_empty = builder.icmp_unsigned("==", n_simd, SZ(0))
+        builder.cbranch(is_empty, tail_check_block, simd_block)
+
+        builder.position_at_end(simd_block)
+        i = builder.phi(SZ, name="i")
+        i.add_incoming(SZ(0), entry_block)
+
+        lanes = [builder.add(i, SZ(lane)) for lane in range(simd_width)]
+        VD = ir.VectorType(D, simd_width)
+
+        def gather(rows, base, k):
+            val = ir.Constant(VD, ir.Undefined)
+            for lane in range(simd_width):
+                if rows is None:
+                    ptr = builder.gep(base[lane], [SZ(k)])
+                else:
+                    index_ptr = builder.gep(rows[lane], [SZ(k)])
+                    index = builder.load(index_ptr)
+                    ptr = builder.gep(base, [index])
+                lane_val = builder.load(ptr)
+                val = builder.insert_element(val, lane_val, I(lane))
+            return val
+
+        xi_rows = [row(xi, lane, nx) for lane in lanes]
+        load_x = lambda k: gather(xi_rows, x, k)
+        load_p = load_w = None
+        if has_parameter:
+            pi_rows = [row(pi, lane, np) for lane in lanes]
+            load_p = lambda k: gather(pi_rows, p, k)
+        if hessian_lagrange:
+            w_starts = [offset_by(w, wo, lane) for lane in lanes]
+            load_w = lambda k: gather(None, w_starts, k)
+
+        # the lanes are written one by one, so the instances may add to the same element
+        if indirect_y:
+            yi_rows = [row(yi, lane, ny) for lane in lanes]
+        else:
+            y_starts = [offset_by(y, yo, lane) for lane in lanes]
+
+        def store(k, val):
+            for lane in range(simd_width):
+                lane_val = builder.extract_element(val, I(lane))
+                if indirect_y:
+                    index_ptr = builder.gep(yi_rows[lane], [SZ(k)])
+                    index = builder.load(index_ptr)
+                    ptr = builder.gep(y, [index])
+                else:
+                    ptr = builder.gep(y_starts[lane], [SZ(k)])
+                if add_y:
+                    old_val = builder.load(ptr)
+                    lane_val = builder.fadd(old_val, lane_val)
+                builder.store(lane_val, ptr)
+
+        generate_llvmir_simd_body(
+            module,
+            builder,
+            graph_obj,
+            simd_width,
+            np,
+            nw,
+            load_p,
+            load_w,
+            load_x,
+            store,
+        )
+
+        i_next = builder.add(i, SZ(simd_width), name="i_next")
+        i.add_incoming(i_next, builder.block)
+        is_done = builder.icmp_unsigned("==", i_next, n_simd)
+        builder.cbranch(is_done, tail_check_block, simd_block)
+    else:
+        builder.branch(tail_check_block)
+
+    builder.position_at_end(tail_check_block)
+    no_tail = builder.icmp_unsigned("==", n_simd, n)
+    builder.cbranch(no_tail, exit_block, tail_block)
+
+    builder.position_at_end(tail_block)
+    j = builder.phi(SZ, name="j")
+    j.add_incoming(n_simd, tail_check_block)
+
+    call_args = [x]
+    if has_parameter:
+        call_args.append(p)
+    if hessian_lagrange:
+        call_args.append(offset_by(w, wo, j))
+    if indirect_y:
+        call_args.append(y)
+    else:
+        call_args.append(offset_by(y, yo, j))
+    call_args.append(row(xi, j, nx))
+    if has_parameter:
+        call_args.append(row(pi, j, np))
+    if indirect_y:
+        call_args.append(row(yi, j, ny))
+    builder.call(scalar_func, call_args)
+
+    j_next = builder.add(j, SZ(1), name="j_next")
+    j.add_incoming(j_next, tail_block)
+    is_done = builder.icmp_unsigned("==", j_next, n)
+    builder.cbranch(is_done, exit_block, tail_block)
+
+    builder.position_at_end(exit_block)
+    builder.ret_void()
+
+
+# Define the reduction entry point of a function generated by generate_llvmir_from_graph
+def generate_llvmir_sum_from_graph(
+    module: ir.Module,
+    graph_obj,
+    name: str,
+    np: int = 0,
+    simd_width: int = 1,
+):
+    # {name}_sum returns the sum of the output of n instances of {name}, which has ny = 1
+    # {name} must be generated with indirect_x and indirect_p
+    # the indices of instance i are xi[i * nx:] and pi[i * np:]
+    # the partial sums stay in registers, they are compensated by Neumaier's variant of Kahan
+    # summation if compensated != 0
+    # if simd_width > 1, simd_width instances are evaluated at once with vector instructions
+    # and each lane has its own partial sum, the remaining instances are evaluated by {name}
+    n_dynamic_ind = graph_obj.n_dynamic_ind
+    n_variable_ind = graph_obj.n_variable_ind
+    assert graph_obj.n_dependent == 1
+
+    nx = n_dynamic_ind + n_variable_ind - np
+
+    has_parameter = np > 0
+
+    func_args = [SZ, D_PTR]
+    arg_names = ["n", "x"]
+    if has_parameter:
+        func_args.append(D_PTR)
+        arg_names.append("p")
+    func_args.append(SZ_PTR)
+    arg_names.append("xi")
+    if has_parameter:
+        func_args.append(SZ_PTR)
+        arg_names.append("pi")
+    func_args.append(I)
+    arg_names.append("compensated")
+
+    func_type = ir.FunctionType(D, func_args)
+    func = ir.Function(module, func_type, name=name + "_sum")
+
+    args_dict = {}
+    for i, arg in enumerate(func.args):
+        arg.name = arg_names[i]
+        args_dict[arg.name] = arg
+    n = args_dict["n"]
+    x = args_dict["x"]
+    p = args_dict.get("p", None)
+    xi = args_dict["xi"]
+    pi = args_dict.get("pi", None)
+    compensated = args_dict["compensated"]
+
+    scalar_func = module.get_global(name)
+    if scalar_func is None:
+        raise ValueError(f"Function {name} not found in module")
+
+    entry_block = func.append_basic_block(name="entry")
+    builder = ir.IRBuilder(entry_block)
+
+    # the output of the scalar function
+    y = builder.alloca(D, name="y")
+
+    def row(ptr, i, ncol):
+        offset = builder.mul(i, SZ(ncol))
+        return builder.gep(ptr, [offset])
+
+    VD = ir.VectorType(D, simd_width)
+
+    def fabs(val):
+        if isinstance(val.type, ir.VectorType):
+            intrinsic_name = f"llvm.fabs.v{simd_width}f64"
+        else:
+            intrinsic_name = "llvm.fabs.f64"
+        intrinsic = module.globals.get(intrinsic_name, None)
+        if intrinsic is None:
+            intrinsic_type = ir.FunctionType(val.type, [val.type])
+            intrinsic = ir.Function(module, intrinsic_type, name=intrinsic_name)
+        return builder.call(intrinsic, [val])
+
+    # returns the sum and the compensation after adding val, it works on scalars and vectors
+    # no fast-math flags are used, they would allow LLVM to remove the compensation
+    def accumulate(is_compensated, sum_val, c_val, val):
+        if not is_compensated:
+            return builder.fadd(sum_val, val), c_val
+        t = builder.fadd(sum_val, val)
+        is_larger = builder.fcmp_ordered(">=", fabs(sum_val), fabs(val))
+        c_larger = builder.fadd(builder.fsub(sum_val, t), val)
+        c_smaller = builder.fadd(builder.fsub(val, t), sum_val)
+        c_val = builder.fadd(c_val, builder.select(is_larger, c_larger, c_smaller))
+        return t, c_val
+
+    # instances [0, n_simd) are evaluated by the vector loop
+    if simd_width > 1:
+        n_simd = builder.mul(
+            builder.udiv(n, SZ(simd_width)), SZ(simd_width), name="n_simd"
+        )
+    else:
+        n_simd = SZ(0)
+
+    # the loops of both kinds of summation, they return the sum and the block that ends them
+    def generate_loops(is_compensated: bool, start_block):
+        prefix = "compensated_" if is_compensated else "plain_"
+        sum_val = D(0.0)
+        c_val = D(0.0)
+        tail_start_block = start_block
+
+        if simd_width > 1:
+            simd_block = func.append_basic_block(name=prefix + "simd_loop")
+            reduce_block = func.append_basic_block(name=prefix + "simd_reduce")
+
+            is_empty = builder.icmp_unsigned("==", n_simd, SZ(0))
+            builder.cbranch(is_empty, reduce_block, simd_block)
+
+            builder.position_at_end(simd_block)
+            zero = ir.Constant(VD, [0.0] * simd_width)
+            i = builder.phi(SZ, name="i")
+            i.add_incoming(SZ(0), start_block)
+            acc = builder.phi(VD, name="acc")
+            acc.add_incoming(zero, start_block)
+            acc_c = builder.phi(VD, name="acc_c")
+            acc_c.add_incoming(zero, start_block)
+
+            lanes = [builder.add(i, SZ(lane)) for lane in range(simd_width)]
+
+            def gather(rows, base, k):
+                val = ir.Constant(VD, ir.Undefined)
+                for lane in range(simd_width):
+                    index_ptr = builder.gep(rows[lane], [SZ(k)])
+                    index = builder.load(index_ptr)
+                    ptr = builder.gep(base, [index])
+                    lane_val = builder.load(ptr)
+                    val = builder.insert_element(val, lane_val, I(lane))
+                return val
+
+            xi_rows = [row(xi, lane, nx) for lane in lanes]
+            load_x = lambda k: gather(xi_rows, x, k)
+            load_p = None
+            if has_parameter:
+                pi_rows = [row(pi, lane, np) for lane in lanes]
+                load_p = lambda k: gather(pi_rows, p, k)
+
+            outputs = []
+            generate_llvmir_simd_body(
+                module,
+                builder,
+                graph_obj,
+                simd_width,
+                np,
+                0,
+                load_p,
+                None,
+                load_x,
+                lambda k, val: outputs.append(val),
+            )
+            acc_next, acc_c_next = accumulate(is_compensated, acc, acc_c, outputs[0])
+
+            i_next = builder.add(i, SZ(simd_width), name="i_next")
+            simd_end_block = builder.block
+            i.add_incoming(i_next, simd_end_block)
+            acc.add_incoming(acc_next, simd_end_block)
+            acc_c.add_incoming(acc_c_next, simd_end_block)
+            is_done = builder.icmp_unsigned("==", i_next, n_simd)
+            builder.cbranch(is_done, reduce_block, simd_block)
+
+            # the partial sums of lanes are added after the loop
+            builder.position_at_end(reduce_block)
+            acc_done = builder.phi(VD, name="acc_done")
+            acc_done.add_incoming(zero, start_block)
+            acc_done.add_incoming(acc_next, simd_end_block)
+            acc_c_done = builder.phi(VD, name="acc_c_done")
+            acc_c_done.add_incoming(zero, start_block)
+            acc_c_done.add_incoming(acc_c_next, simd_end_block)
+            for lane in range(simd_width):
+                lane_val = builder.extract_element(acc_done, I(lane))
+                sum_val, c_val = accumulate(is_compensated, sum_val, c_val, lane_val)
+            if is_compensated:
+                for lane in range(simd_width):
+                    lane_c = builder.extract_element(acc_c_done, I(lane))
+                    c_val = builder.fadd(c_val, lane_c)
+            tail_start_block = builder.block
+
+        tail_block = func.append_basic_block(name=prefix + "tail_loop")
+        done_block = func.append_basic_block(name=prefix + "done")
+
+        no_tail = builder.icmp_unsigned("==", n_simd, n)
+        builder.cbranch(no_tail, done_block, tail_block)
+
+        builder.position_at_end(tail_block)
+        j = builder.phi(SZ, name="j")
+        j.add_incoming(n_simd, tail_start_block)
+        tail_sum = builder.phi(D, name="tail_sum")
+        tail_sum.add_incoming(sum_val, tail_start_block)
+        tail_c = builder.phi(D, name="tail_c")
+        tail_c.add_incoming(c_val, tail_start_block)
+
+        call_args = [x]
+        if has_parameter:
+            call_args.append(p)
+        call_args.append(y)
+        call_args.append(row(xi, j, nx))
+        if has_parameter:
+            call_args.append(row(pi, j, np))
+        builder.call(scalar_func, call_args)
+        val = builder.load(y)
+        tail_sum_next, tail_c_next = accumulate(is_compensated, tail_sum, tail_c, val)
+
+        j_next = builder.add(j, SZ(1), name="j_next")
+        tail_end_block = builder.block
+        j.add_incoming(j_next, tail_end_block)
+        tail_sum.add_incoming(tail_sum_next, tail_end_block)
+        tail_c.add_incoming(tail_c_next, tail_end_block)
+        is_done = builder.icmp_unsigned("==", j_next, n)
+        builder.cbranch(is_done, done_block, tail_block)
+
+        builder.position_at_end(done_block)
+        sum_done = builder.phi(D, name="sum_done")
+        sum_done.add_incoming(sum_val, tail_start_block)
+        sum_done.add_incoming(tail_sum_next, tail_end_block)
+        if not is_compensated:
+            return sum_done, done_block
+        c_done = builder.phi(D, name="c_done")
+        c_done.add_incoming(c_val, tail_start_block)
+        c_done.add_incoming(tail_c_next, tail_end_block)
+        return builder.fadd(sum_done, c_done), done_block
+
+    plain_block = func.append_basic_block(name="plain")
+    compensated_block = func.append_basic_block(name="compensated")
+    exit_block = func.append_basic_block(name="exit")
+
+    is_compensated = builder.icmp_signed("!=", compensated, I(0))
+    builder.cbranch(is_compensated, compensated_block, plain_block)
+
+    results = []
+    for kind, start_block in [(False, plain_block), (True, compensated_block)]:
+        builder.position_at_end(start_block)
+        results.append(generate_loops(kind, start_block))
+        builder.branch(exit_block)
+
+    builder.position_at_end(exit_block)
+    result = builder.phi(D, name="result")
+    for val, block in results:
+        result.add_incoming(val, block)
+    builder.ret(result)
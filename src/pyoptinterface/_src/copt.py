@@ -19,7 +19,7 @@ from .solver_common import (
     _direct_get_entity_attribute,
     _direct_set_entity_attribute,
 )
-from .aml import make_nd_variable
+from .aml import make_nd_variable_batch
 
 
 def detected_libraries():
@@ -354,7 +354,7 @@ class Model(RawModel):
         self._env = env
         self.mip_start_values: dict[VariableIndex, float] = dict()
 
-        self.add_variables = types.MethodType(make_nd_variable, self)
+        self.add_variables = types.MethodType(make_nd_variable_batch, self)
 
     @staticmethod
     def supports_variable_attribute(attribute: VariableAttribute, settable=False):
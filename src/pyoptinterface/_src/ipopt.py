@@ -1,15 +1,31 @@
 from io import StringIO
+import ctypes
+import os
 import types
 import logging
 import platform
+from typing import Union
 
-from llvmlite import ir
+import llvmlite
+from llvmlite import ir, binding
 
 from .ipopt_model_ext import RawModel, ApplicationReturnStatus, load_library
-from .codegen_c import generate_csrc_prelude, generate_csrc_from_graph
-from .jit_c import TCCJITCompiler
-from .codegen_llvm import create_llvmir_basic_functions, generate_llvmir_from_graph
-from .jit_llvm import LLJITCompiler
+from .codegen_c import (
+    generate_csrc_prelude,
+    generate_csrc_from_graph,
+    generate_csrc_batch_from_graph,
+    generate_csrc_sum_from_graph,
+)
+from .jit_c import TCCJITCompiler, TCC_OUTPUT_DLL, sharedlib_suffix
+from .jit_cc import SystemCJITCompiler
+from .codegen_llvm import (
+    create_llvmir_basic_functions,
+    generate_llvmir_from_graph,
+    generate_llvmir_batch_from_graph,
+    generate_llvmir_sum_from_graph,
+)
+from .jit_llvm import LLJITCompiler, host_cpu_features
+from .jit_cache import JITCache, CACHED_KERNEL_NAME, CACHE_FORMAT_VERSION
 from .tracefun import trace_adfun
 
 from .core_ext import ConstraintIndex
@@ -60,60 +76,263 @@ def autoload_library():
 autoload_library()
 
 
-def compile_functions_c(backend: RawModel, jit_compiler: TCCJITCompiler):
-    io = StringIO()
-
-    generate_csrc_prelude(io)
-
-    functions = backend.m_function_model.nl_functions
-
-    for function in functions:
-        name = function.name
-
-        f_name = name
+def generate_function_csrc(io, function, name: str):
+    f_name = name
+    generate_csrc_from_graph(
+        io,
+        function.f_graph,
+        f_name,
+        np=function.np,
+        indirect_x=True,
+        indirect_p=True,
+    )
+    generate_csrc_batch_from_graph(io, function.f_graph, f_name, np=function.np)
+    if function.ny == 1:
+        # the objective terms are summed by the reduction kernel
+        generate_csrc_sum_from_graph(io, function.f_graph, f_name, np=function.np)
+    if function.has_jacobian:
+        jacobian_name = name + "_jacobian"
         generate_csrc_from_graph(
             io,
+            function.jacobian_graph,
+            jacobian_name,
+            np=function.np,
+            indirect_x=True,
+            indirect_p=True,
+        )
+        generate_csrc_batch_from_graph(
+            io, function.jacobian_graph, jacobian_name, np=function.np
+        )
+        gradient_name = name + "_gradient"
+        generate_csrc_from_graph(
+            io,
+            function.jacobian_graph,
+            gradient_name,
+            np=function.np,
+            indirect_x=True,
+            indirect_p=True,
+            indirect_y=True,
+            add_y=True,
+        )
+        generate_csrc_batch_from_graph(
+            io,
+            function.jacobian_graph,
+            gradient_name,
+            np=function.np,
+            indirect_y=True,
+        )
+    if function.has_fused:
+        fused_name = name + "_fused"
+        generate_csrc_from_graph(
+            io,
+            function.fused_graph,
+            fused_name,
+            np=function.np,
+            indirect_x=True,
+            indirect_p=True,
+        )
+        generate_csrc_batch_from_graph(
+            io, function.fused_graph, fused_name, np=function.np
+        )
+    if function.has_hessian:
+        hessian_name = name + "_hessian"
+        generate_csrc_from_graph(
+            io,
+            function.hessian_graph,
+            hessian_name,
+            np=function.np,
+            hessian_lagrange=True,
+            nw=function.ny,
+            indirect_x=True,
+            indirect_p=True,
+            indirect_y=True,
+            add_y=True,
+        )
+        generate_csrc_batch_from_graph(
+            io,
+            function.hessian_graph,
+            hessian_name,
+            np=function.np,
+            hessian_lagrange=True,
+            nw=function.ny,
+            indirect_y=True,
+        )
+
+
+def generate_function_llvmir(module: ir.Module, function, name: str, simd_width: int):
+    f_name = name
+    generate_llvmir_from_graph(
+        module,
+        function.f_graph,
+        f_name,
+        np=function.np,
+        indirect_x=True,
+        indirect_p=True,
+    )
+    generate_llvmir_batch_from_graph(
+        module,
+        function.f_graph,
+        f_name,
+        np=function.np,
+        simd_width=simd_width,
+    )
+    if function.ny == 1:
+        generate_llvmir_sum_from_graph(
+            module,
             function.f_graph,
             f_name,
             np=function.np,
+            simd_width=simd_width,
+        )
+    if function.has_jacobian:
+        jacobian_name = name + "_jacobian"
+        generate_llvmir_from_graph(
+            module,
+            function.jacobian_graph,
+            jacobian_name,
+            np=function.np,
+            indirect_x=True,
+            indirect_p=True,
+        )
+        generate_llvmir_batch_from_graph(
+            module,
+            function.jacobian_graph,
+            jacobian_name,
+            np=function.np,
+            simd_width=simd_width,
+        )
+        gradient_name = name + "_gradient"
+        generate_llvmir_from_graph(
+            module,
+            function.jacobian_graph,
+            gradient_name,
+            np=function.np,
             indirect_x=True,
             indirect_p=True,
+            indirect_y=True,
+            add_y=True,
         )
-        if function.has_jacobian:
-            jacobian_name = name + "_jacobian"
-            generate_csrc_from_graph(
-                io,
-                function.jacobian_graph,
-                jacobian_name,
-                np=function.np,
-                indirect_x=True,
-                indirect_p=True,
-            )
-            gradient_name = name + "_gradient"
-            generate_csrc_from_graph(
-                io,
-                function.jacobian_graph,
-                gradient_name,
-                np=function.np,
-                indirect_x=True,
-                indirect_p=True,
-                indirect_y=True,
-                add_y=True,
-            )
-        if function.has_hessian:
-            hessian_name = name + "_hessian"
-            generate_csrc_from_graph(
-                io,
-                function.hessian_graph,
-                hessian_name,
-                np=function.np,
-                hessian_lagrange=True,
-                nw=function.ny,
-                indirect_x=True,
-                indirect_p=True,
-                indirect_y=True,
-                add_y=True,
-            )
+        generate_llvmir_batch_from_graph(
+            module,
+            function.jacobian_graph,
+            gradient_name,
+            np=function.np,
+            indirect_y=True,
+            add_y=True,
+            simd_width=simd_width,
+        )
+    if function.has_fused:
+        fused_name = name + "_fused"
+        generate_llvmir_from_graph(
+            module,
+            function.fused_graph,
+            fused_name,
+            np=function.np,
+            indirect_x=True,
+            indirect_p=True,
+        )
+        generate_llvmir_batch_from_graph(
+            module,
+            function.fused_graph,
+            fused_name,
+            np=function.np,
+            simd_width=simd_width,
+        )
+    if function.has_hessian:
+        hessian_name = name + "_hessian"
+        generate_llvmir_from_graph(
+            module,
+            function.hessian_graph,
+            hessian_name,
+            np=function.np,
+            hessian_lagrange=True,
+            nw=function.ny,
+            indirect_x=True,
+            indirect_p=True,
+            indirect_y=True,
+            add_y=True,
+        )
+        generate_llvmir_batch_from_graph(
+            module,
+            function.hessian_graph,
+            hessian_name,
+            np=function.np,
+            hessian_lagrange=True,
+            nw=function.ny,
+            indirect_y=True,
+            add_y=True,
+            simd_width=simd_width,
+        )
+
+    return function_symbols(function, name)
+
+
+def function_symbols(function, name: str):
+    # the names of all kernels of a function
+    symbols = [name, name + "_batch"]
+    if function.ny == 1:
+        symbols.append(name + "_sum")
+    if function.has_jacobian:
+        jacobian_name = name + "_jacobian"
+        gradient_name = name + "_gradient"
+        symbols.extend([jacobian_name, jacobian_name + "_batch"])
+        symbols.extend([gradient_name, gradient_name + "_batch"])
+    if function.has_hessian:
+        hessian_name = name + "_hessian"
+        symbols.extend([hessian_name, hessian_name + "_batch"])
+    if function.has_fused:
+        fused_name = name + "_fused"
+        symbols.extend([fused_name, fused_name + "_batch"])
+    return symbols
+
+
+def assign_function_evaluators(function, name: str, get_symbol):
+    f_name = name
+    jacobian_name = name + "_jacobian"
+    gradient_name = name + "_gradient"
+    hessian_name = name + "_hessian"
+
+    f_ptr = get_symbol(f_name)
+    jacobian_ptr = gradient_ptr = hessian_ptr = 0
+    if function.has_jacobian:
+        jacobian_ptr = get_symbol(jacobian_name)
+        gradient_ptr = get_symbol(gradient_name)
+    if function.has_hessian:
+        hessian_ptr = get_symbol(hessian_name)
+
+    function.assign_evaluators(f_ptr, jacobian_ptr, gradient_ptr, hessian_ptr)
+
+    f_ptr = get_symbol(f_name + "_batch")
+    jacobian_ptr = gradient_ptr = hessian_ptr = 0
+    if function.has_jacobian:
+        jacobian_ptr = get_symbol(jacobian_name + "_batch")
+        gradient_ptr = get_symbol(gradient_name + "_batch")
+    if function.has_hessian:
+        hessian_ptr = get_symbol(hessian_name + "_batch")
+
+    function.assign_batch_evaluators(f_ptr, jacobian_ptr, gradient_ptr, hessian_ptr)
+
+    if function.ny == 1:
+        function.assign_sum_evaluator(get_symbol(f_name + "_sum"))
+
+    if function.has_fused:
+        fused_name = name + "_fused"
+        function.assign_fused_evaluators(
+            get_symbol(fused_name), get_symbol(fused_name + "_batch")
+        )
+
+
+def compile_functions_c(
+    backend: RawModel, jit_compiler: Union[TCCJITCompiler, SystemCJITCompiler]
+):
+    io = StringIO()
+
+    generate_csrc_prelude(io)
+
+    functions = backend.m_function_model.nl_functions
+
+    for function in functions:
+        generate_function_csrc(io, function, function.name)
 
     csrc = io.getvalue()
 
@@ -122,24 +341,19 @@ def compile_functions_c(backend: RawModel, jit_compiler: TCCJITCompiler):
     jit_compiler.compile_string(csrc.encode())
 
     for function in functions:
-        name = function.name
-        f_name = name
-        jacobian_name = name + "_jacobian"
-        gradient_name = name + "_gradient"
-        hessian_name = name + "_hessian"
-
-        f_ptr = jit_compiler.get_symbol(f_name.encode())
-        jacobian_ptr = gradient_ptr = hessian_ptr = 0
-        if function.has_jacobian:
-            jacobian_ptr = jit_compiler.get_symbol(jacobian_name.encode())
-            gradient_ptr = jit_compiler.get_symbol(gradient_name.encode())
-        if function.has_hessian:
-            hessian_ptr = jit_compiler.get_symbol(hessian_name.encode())
+        assign_function_evaluators(
+            function, function.name, lambda s: jit_compiler.get_symbol(s.encode())
+        )
 
-        function.assign_evaluators(f_ptr, jacobian_ptr, gradient_ptr, hessian_ptr)
 
+def compile_functions_llvm(
+    backend: RawModel, jit_compiler: LLJITCompiler, simd_width=None
+):
+    # simd_width instances are evaluated at once by the batched functions, it is chosen by the
+    # features of host CPU if it is not specified
+    if simd_width is None:
+        simd_width = jit_compiler.simd_width
 
-def compile_functions_llvm(backend: RawModel, jit_compiler: LLJITCompiler):
     module = ir.Module(name="my_module")
     create_llvmir_basic_functions(module)
 
@@ -148,73 +362,97 @@ def compile_functions_llvm(backend: RawModel, jit_compiler: LLJITCompiler):
     export_functions = []
 
     for function in functions:
-        name = function.name
-
-        f_name = name
-        generate_llvmir_from_graph(
-            module,
-            function.f_graph,
-            f_name,
-            np=function.np,
-            indirect_x=True,
-            indirect_p=True,
+        export_functions.extend(
+            generate_function_llvmir(module, function, function.name, simd_width)
         )
-        if function.has_jacobian:
-            jacobian_name = name + "_jacobian"
-            generate_llvmir_from_graph(
-                module,
-                function.jacobian_graph,
-                jacobian_name,
-                np=function.np,
-                indirect_x=True,
-                indirect_p=True,
-            )
-            gradient_name = name + "_gradient"
-            generate_llvmir_from_graph(
-                module,
-                function.jacobian_graph,
-                gradient_name,
-                np=function.np,
-                indirect_x=True,
-                indirect_p=True,
-                indirect_y=True,
-                add_y=True,
-            )
-        if function.has_hessian:
-            hessian_name = name + "_hessian"
-            generate_llvmir_from_graph(
-                module,
-                function.hessian_graph,
-                hessian_name,
-                np=function.np,
-                hessian_lagrange=True,
-                nw=function.ny,
-                indirect_x=True,
-                indirect_p=True,
-                indirect_y=True,
-                add_y=True,
-            )
-
-        export_functions.extend([f_name, jacobian_name, gradient_name, hessian_name])
 
     jit_compiler.compile_module(module, export_functions)
 
     for function in functions:
-        name = function.name
-        f_name = name
-        jacobian_name = name + "_jacobian"
-        gradient_name = name + "_gradient"
-        hessian_name = name + "_hessian"
+        assign_function_evaluators(function, function.name, jit_compiler.get_symbol)
+
+
+# With a JITCache, every function is compiled into its own shared library or object file named
+# after the hash of its graph, the kernels of functions found in the cache are loaded without
+# code generation and compilation
+def compile_functions_c_cached(
+    backend: RawModel, jit_cache: JITCache, keys, jit_engine="C"
+):
+    functions = backend.m_function_model.nl_functions
+    flavor = f"{jit_engine}-{CACHE_FORMAT_VERSION}-{platform.system()}-{platform.machine()}"
+    if jit_engine == "CC":
+        cc_compiler = SystemCJITCompiler()
+        # the code is built with -march=native for the host CPU by this version of compiler
+        flavor += f"-{binding.get_host_cpu_name()}-{cc_compiler.version()}"
+
+    def build(csrc: str, path: str):
+        if jit_engine == "CC":
+            cc_compiler.compile_to_file(csrc, path)
+        else:
+            jit_compiler = TCCJITCompiler(output_type=TCC_OUTPUT_DLL)
+            jit_compiler.compile_string(csrc.encode())
+            jit_compiler.output_file(path)
+
+    libraries = {}
+    for function, key in zip(functions, keys):
+        library = libraries.get(key)
+        if library is None:
+            path = jit_cache.kernel_path(key, flavor, f".{sharedlib_suffix}")
+            if not os.path.exists(path):
+                io = StringIO()
+                generate_csrc_prelude(io)
+                generate_function_csrc(io, function, CACHED_KERNEL_NAME)
+                csrc = io.getvalue()
+                jit_cache.write_with(path, lambda tmp_path: build(csrc, tmp_path))
+            library = ctypes.CDLL(path)
+            libraries[key] = library
+
+        assign_function_evaluators(
+            function,
+            CACHED_KERNEL_NAME,
+            lambda s: ctypes.cast(library[s], ctypes.c_void_p).value,
+        )
+
+    return libraries
 
-        f_ptr = jit_compiler.get_symbol(f_name)
-        jacobian_ptr = gradient_ptr = hessian_ptr = 0
-        if function.has_jacobian:
-            jacobian_ptr = jit_compiler.get_symbol(jacobian_name)
-            gradient_ptr = jit_compiler.get_symbol(gradient_name)
-        if function.has_hessian:
-            hessian_ptr = jit_compiler.get_symbol(hessian_name)
 
-        function.assign_evaluators(f_ptr, jacobian_ptr, gradient_ptr, hessian_ptr)
+def compile_functions_llvm_cached(
+    backend: RawModel,
+    jit_compiler: LLJITCompiler,
+    jit_cache: JITCache,
+    keys,
+    simd_width=None,
+):
+    if simd_width is None:
+        simd_width = jit_compiler.simd_width
+
+    functions = backend.m_function_model.nl_functions
+    # the object code depends on the target machine and the version of LLVM
+    target_machine = jit_compiler.target_machine
+    flavor = (
+        f"LLVM-{CACHE_FORMAT_VERSION}-{llvmlite.__version__}-{target_machine.triple}-"
+        f"{binding.get_host_cpu_name()}-{host_cpu_features()}-{simd_width}"
+    )
+
+    libraries = {}
+    for function, key in zip(functions, keys):
+        library = libraries.get(key)
+        if library is None:
+            symbols = function_symbols(function, CACHED_KERNEL_NAME)
+            path = jit_cache.kernel_path(key, flavor, ".o")
+            obj = jit_cache.read(path)
+            if obj is None:
+                module = ir.Module(name=key)
+                create_llvmir_basic_functions(module)
+                generate_function_llvmir(module, function, CACHED_KERNEL_NAME, simd_width)
+                obj = jit_compiler.compile_module_to_object(module)
+                jit_cache.write(path, obj)
+            library = jit_compiler.load_object(key, obj, symbols)
+            libraries[key] = library
+
+        assign_function_evaluators(function, CACHED_KERNEL_NAME, library.__getitem__)
+
+    return libraries
 
 
 variable_attribute_get_func_map = {
@@ -317,6 +555,7 @@ model_attribute_get_func_map = {
     ModelAttribute.RawStatusString: get_rawstatusstring,
     ModelAttribute.TerminationStatus: get_terminationstatus,
     ModelAttribute.SolverName: lambda _: "IPOPT",
+    ModelAttribute.NumberOfThreads: lambda model: model.get_n_threads(),
 }
 
 model_attribute_set_func_map = {
@@ -326,6 +565,7 @@ model_attribute_set_func_map = {
     ModelAttribute.Silent: lambda model, v: model.set_raw_option_bool(
         "print_level", 0 if v else 5
     ),
+    ModelAttribute.NumberOfThreads: lambda model, v: model.set_n_threads(v),
 }
 
 
@@ -362,13 +602,27 @@ constraint_attribute_set_func_map = {}
 
 
 class Model(RawModel):
-    def __init__(self):
+    def __init__(self, jit_cache_dir=None):
         super().__init__()
 
         self.n_nl_functions = 0
         self.jit_compiler = None
         self.add_variables = types.MethodType(make_nd_variable, self)
 
+        # the analysis and kernels of nonlinear functions are reused across models and processes
+        # if a cache directory is given
+        self.jit_cache = None
+        if jit_cache_dir is not None:
+            self.jit_cache = JITCache(jit_cache_dir)
+        # the cache keys of registered functions
+        self.nl_function_keys = []
+        self.jit_libraries = None
+        # the JIT options and the number of functions of the last compilation, the kernels are
+        # reused by the next optimize if none of them changes
+        self.jit_compiled = None
+        # (index, cache key) of deferred functions whose analysis is saved after initialization
+        self.deferred_analysis_keys = []
+
     @staticmethod
     def supports_variable_attribute(attribute: VariableAttribute, settable=False):
         if settable:
@@ -390,18 +644,83 @@ class Model(RawModel):
         else:
             return attribute in constraint_attribute_get_func_map
 
-    def optimize(self, jit_engine="LLVM"):
-        if jit_engine == "C":
+    def optimize(self, jit_engine="LLVM", simd_width=None):
+        # jit_engine is one of
+        # "LLVM": llvmlite, the default
+        # "C": in-memory TCC, fast to compile but the code is not optimized
+        # "CC": the C compiler of the system with -O3 -march=native, slow to compile but the
+        # fastest code for long solves, best combined with jit_cache_dir
+        # simd_width is only used by "LLVM"
+        self.prepare_functions(jit_engine, simd_width)
+        super()._optimize()
+
+    def prepare_functions(self, jit_engine="LLVM", simd_width=None):
+        # initializes and compiles the nonlinear functions as optimize does, the model can be
+        # evaluated by eval_objective, eval_constraints, ... afterwards
+        self.initialize_functions()
+        jit_compiled = (jit_engine, simd_width, self.n_nl_functions)
+        if jit_compiled != self.jit_compiled:
+            self.compile_functions(jit_engine, simd_width)
+            self.jit_compiled = jit_compiled
+
+    def initialize_functions(self):
+        # initializes the functions registered with defer=True on the threads of the model
+        super()._initialize_deferred_functions()
+        for index, key in self.deferred_analysis_keys:
+            function = self.m_function_model.nl_functions[index.index]
+            self.jit_cache.save_analysis(key, function.save_analysis())
+        self.deferred_analysis_keys = []
+
+    def compile_functions(self, jit_engine, simd_width):
+        if self.jit_cache is not None:
+            keys = self.nl_function_keys
+            if jit_engine in ("C", "CC"):
+                self.jit_compiler = None
+                self.jit_libraries = compile_functions_c_cached(
+                    self, self.jit_cache, keys, jit_engine
+                )
+            elif jit_engine == "LLVM":
+                self.jit_compiler = LLJITCompiler()
+                self.jit_libraries = compile_functions_llvm_cached(
+                    self, self.jit_compiler, self.jit_cache, keys, simd_width
+                )
+        elif jit_engine == "C":
             self.jit_compiler = TCCJITCompiler()
             compile_functions_c(self, self.jit_compiler)
+        elif jit_engine == "CC":
+            self.jit_compiler = SystemCJITCompiler()
+            compile_functions_c(self, self.jit_compiler)
         elif jit_engine == "LLVM":
             self.jit_compiler = LLJITCompiler()
-            compile_functions_llvm(self, self.jit_compiler)
-        super()._optimize()
+            compile_functions_llvm(self, self.jit_compiler, simd_width)
+
+    def shift_warm_start_point(self, variables, shift=1):
+        # For receding horizon control, variables is a trajectory and variables[t] takes the
+        # warm start values of variables[t + shift], those beyond the end repeat the last one.
+        # The multipliers of constraints are not moved.
+        x, mult_g, mult_x_L, mult_x_U = self.get_warm_start_point()
+        indices = [v.index for v in variables]
+        n = len(indices)
+        for values in (x, mult_x_L, mult_x_U):
+            shifted = [values[indices[max(0, min(t + shift, n - 1))]] for t in range(n)]
+            for i, value in zip(indices, shifted):
+                values[i] = value
+        self.set_warm_start_point(x, mult_g, mult_x_L, mult_x_U)
 
     def register_function(
-        self, f, /, var, param=(), var_values=None, param_values=None, name=None
+        self,
+        f,
+        /,
+        var,
+        param=(),
+        var_values=None,
+        param_values=None,
+        name=None,
+        defer=False,
     ):
+        # With defer=True the sparsity and derivatives of f are computed by the next optimize
+        # or initialize_functions, together with the other deferred functions and on all threads
+        # set by set_n_threads. It saves time when many functions are registered.
         adfun = trace_adfun(f, var, param)
         nx = adfun.nx
         if var_values is not None:
@@ -416,7 +735,30 @@ class Model(RawModel):
         if name is None:
             name = f"nlfunction_{self.n_nl_functions}"
         self.n_nl_functions += 1
-        return super()._register_function(adfun, name, var_values, param_values)
+        if defer:
+            register = super()._register_function_deferred
+        else:
+            register = super()._register_function
+        if self.jit_cache is None:
+            return register(adfun, name, var_values, param_values)
+
+        key = self.jit_cache.function_key(adfun)
+        analysis = self.jit_cache.load_analysis(key)
+        index = None
+        if analysis is not None:
+            try:
+                index = super()._register_function_from_analysis(adfun, name, analysis)
+            except RuntimeError as e:
+                logging.warning(f"Ignore the cached analysis of {name}: {e}")
+        if index is None:
+            index = register(adfun, name, var_values, param_values)
+            if defer:
+                self.deferred_analysis_keys.append((index, key))
+            else:
+                function = self.m_function_model.nl_functions[index.index]
+                self.jit_cache.save_analysis(key, function.save_analysis())
+        self.nl_function_keys.append(key)
+        return index
 
     def get_variable_attribute(self, variable, attribute: VariableAttribute):
         def e(attribute):
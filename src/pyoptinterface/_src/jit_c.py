@@ -22,10 +22,12 @@ TCCErrorFunc = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_char_p)
 
 # Define the output type constant for in-memory execution
 TCC_OUTPUT_MEMORY = ctypes.c_int(1)
+# Define the output type constant for shared libraries
+TCC_OUTPUT_DLL = ctypes.c_int(3)
 
 
 class TCCJITCompiler:
-    def __init__(self, libtcc_path=libtcc_path):
+    def __init__(self, libtcc_path=libtcc_path, output_type=TCC_OUTPUT_MEMORY):
         # Load the libtcc shared library
         self.libtcc = ctypes.CDLL(libtcc_path)
 
@@ -39,8 +41,8 @@ class TCCJITCompiler:
         if not self.state:
             raise Exception("Failed to create TCC state")
 
-        # Set the output type to memory
-        if self.libtcc.tcc_set_output_type(self.state, TCC_OUTPUT_MEMORY) == -1:
+        # Set the output type, the code is run in memory by default
+        if self.libtcc.tcc_set_output_type(self.state, output_type) == -1:
             self.cleanup()
             raise Exception("Failed to set output type")
 
@@ -59,6 +61,8 @@ class TCCJITCompiler:
         libtcc.tcc_add_symbol.restype = ctypes.c_int
         libtcc.tcc_get_symbol.argtypes = [TCCState, ctypes.c_char_p]
         libtcc.tcc_get_symbol.restype = ctypes.c_void_p
+        libtcc.tcc_output_file.argtypes = [TCCState, ctypes.c_char_p]
+        libtcc.tcc_output_file.restype = ctypes.c_int
 
     def compile_string(self, c_code):
         # Compile C code string
@@ -85,6 +89,12 @@ class TCCJITCompiler:
             raise Exception(f"Symbol {symbol_name.decode()} not found")
         return symbol
 
+    def output_file(self, filename):
+        # Write the compiled code to a shared library, the compiler must be created with
+        # output_type=TCC_OUTPUT_DLL
+        if self.libtcc.tcc_output_file(self.state, os.fsencode(filename)) == -1:
+            raise Exception(f"Failed to write {filename}")
+
     def cleanup(self):
         # Clean up the TCC state
         if self.state:
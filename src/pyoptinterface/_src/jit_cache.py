@@ -0,0 +1,77 @@
+import hashlib
+import os
+import tempfile
+from typing import Optional
+
+from .nlcore_ext import cpp_graph, serialize_cpp_graph
+
+# increase it when the generated code or the files in the cache change
+CACHE_FORMAT_VERSION = 3
+
+# the symbols in a cached kernel do not depend on the name of the function, so functions with the
+# same graph share the kernel
+CACHED_KERNEL_NAME = "nlfunction"
+
+
+class JITCache:
+    """
+    Content-addressed on-disk cache of nonlinear functions
+
+    A function is identified by the hash of its serialized graph, the directory contains
+    - {key}.analysis: the sparsity patterns and the graphs of derivatives computed by CppAD
+    - {key}-{flavor}{suffix}: the compiled kernels of one JIT engine and its options
+    Files are written to a temporary file and renamed, so several processes can share a cache.
+    """
+
+    def __init__(self, directory):
+        self.directory = os.fspath(directory)
+        os.makedirs(self.directory, exist_ok=True)
+
+    @staticmethod
+    def function_key(adfun) -> str:
+        graph = cpp_graph()
+        adfun.to_graph(graph)
+        h = hashlib.sha256()
+        h.update(f"pyoptinterface-nlfunction-{CACHE_FORMAT_VERSION}".encode())
+        h.update(serialize_cpp_graph(graph))
+        return h.hexdigest()
+
+    def analysis_path(self, key: str) -> str:
+        return os.path.join(self.directory, f"{key}.analysis")
+
+    def kernel_path(self, key: str, flavor: str, suffix: str) -> str:
+        flavor_hash = hashlib.sha256(flavor.encode()).hexdigest()[:16]
+        return os.path.join(self.directory, f"{key}-{flavor_hash}{suffix}")
+
+    def load_analysis(self, key: str) -> Optional[bytes]:
+        return self.read(self.analysis_path(key))
+
+    def save_analysis(self, key: str, data: bytes):
+        self.write(self.analysis_path(key), data)
+
+    @staticmethod
+    def read(path: str) -> Optional[bytes]:
+        try:
+            with open(path, "rb") as f:
+                return f.read()
+        except FileNotFoundError:
+            return None
+
+    def write(self, path: str, data: bytes):
+        def writer(tmp_path):
+            with open(tmp_path, "wb") as f:
+                f.write(data)
+
+        self.write_with(path, writer)
+
+    def write_with(self, path: str, writer):
+        # writer(tmp_path) creates the file, it is renamed to path when it succeeds
+        fd, tmp_path = tempfile.mkstemp(dir=self.directory, suffix=".tmp")
+        os.close(fd)
+        try:
+            writer(tmp_path)
+            os.replace(tmp_path, path)
+        except BaseException:
+            if os.path.exists(tmp_path):
+                os.remove(tmp_path)
+            raise
@@ -0,0 +1,104 @@
+import ctypes
+import os
+import platform
+import shutil
+import subprocess
+import tempfile
+
+from .jit_c import sharedlib_suffix
+
+# The generated kernels only use +, -, *, / and the functions in math.h, errno is never checked so
+# -fno-math-errno lets the compiler inline sqrt and friends.
+# -ffast-math is not used because it breaks the NaN and Inf checks of IPOPT and the x == 0.0 test
+# in azmul.
+default_cflags = ["-O3", "-march=native", "-fno-math-errno", "-fPIC", "-shared"]
+
+
+def find_c_compiler():
+    cc = os.environ.get("CC")
+    if cc:
+        return cc
+    for cc in ["cc", "gcc", "clang"]:
+        path = shutil.which(cc)
+        if path is not None:
+            return path
+    return None
+
+
+class SystemCJITCompiler:
+    """
+    Compiles C code with the C compiler of the system into a shared library and loads it
+
+    The compiler is $CC or the first one of cc, gcc and clang found in PATH, it must accept
+    GCC-style command line options.
+    """
+
+    def __init__(self, cc=None, cflags=None):
+        if cc is None:
+            cc = find_c_compiler()
+        if cc is None:
+            raise Exception("No C compiler is found, please set the CC environment variable")
+        self.cc = cc
+        self.cflags = list(default_cflags if cflags is None else cflags)
+        if platform.system() != "Windows":
+            self.libs = ["-lm"]
+        else:
+            self.libs = []
+
+        self.build_dir = None
+        self.library = None
+
+    def version(self):
+        # identifies the compiler in the cache of compiled kernels
+        result = subprocess.run(
+            [self.cc, "--version"], capture_output=True, text=True, check=False
+        )
+        first_line = result.stdout.splitlines()[0] if result.stdout else ""
+        return f"{self.cc} {first_line} {' '.join(self.cflags)}"
+
+    def compile_to_file(self, c_code, filename):
+        # Compile C code string to the shared library filename
+        if isinstance(c_code, bytes):
+            c_code = c_code.decode()
+        src_dir = tempfile.mkdtemp(prefix="poi_cc_")
+        try:
+            src = os.path.join(src_dir, "kernels.c")
+            with open(src, "w") as f:
+                f.write(c_code)
+            command = [self.cc, *self.cflags, "-o", os.fspath(filename), src, *self.libs]
+            result = subprocess.run(command, capture_output=True, text=True, check=False)
+            if result.returncode != 0:
+                raise Exception(
+                    f"Failed to compile code with {' '.join(command)}:\n{result.stderr}"
+                )
+        finally:
+            shutil.rmtree(src_dir, ignore_errors=True)
+
+    def compile_string(self, c_code):
+        # Compile C code string into a temporary shared library and load it
+        self.cleanup()
+        self.build_dir = tempfile.mkdtemp(prefix="poi_jit_")
+        filename = os.path.join(self.build_dir, f"kernels.{sharedlib_suffix}")
+        self.compile_to_file(c_code, filename)
+        self.library = ctypes.CDLL(filename)
+
+    def get_symbol(self, symbol_name):
+        if self.library is None:
+            raise Exception("No code has been compiled")
+        if isinstance(symbol_name, bytes):
+            symbol_name = symbol_name.decode()
+        try:
+            symbol = self.library[symbol_name]
+        except AttributeError:
+            raise Exception(f"Symbol {symbol_name} not found")
+        return ctypes.cast(symbol, ctypes.c_void_p).value
+
+    def cleanup(self):
+        # The library stays loaded, only its files are removed. Removing a loaded DLL fails on
+        # Windows and is ignored.
+        if self.build_dir is not None:
+            shutil.rmtree(self.build_dir, ignore_errors=True)
+            self.build_dir = None
+
+    def __del__(self):
+        self.cleanup()
@@ -8,11 +8,45 @@ binding.initialize_native_target()
 binding.initialize_native_asmprinter()
 
 
+def host_cpu_features():
+    try:
+        return binding.get_host_cpu_features()
+    except RuntimeError:
+        return None
+
+
+def host_simd_width(features=None):
+    # the number of instances evaluated at once by the vectorized kernels
+    # <8 x double> on AVX-512 is slower than <4 x double> because the loads of x are gathered
+    # lane by lane, so 8 must be chosen explicitly
+    if features is None:
+        return 1
+    if features.get("avx", False):
+        return 4
+    if features.get("sse2", False) or features.get("neon", False):
+        return 2
+    return 1
+
+
 class LLJITCompiler:
     def __init__(self):
         target = binding.Target.from_default_triple()
-        target_machine = target.create_target_machine(jit=True, opt=3)
+        # generate code for the host CPU so that vector instructions can be used
+        features = host_cpu_features()
+        if features is not None:
+            target_machine = target.create_target_machine(
+                cpu=binding.get_host_cpu_name(),
+                features=features.flatten(),
+                jit=True,
+                opt=3,
+            )
+        else:
+            target_machine = target.create_target_machine(jit=True, opt=3)
+        self.target_machine = target_machine
         self.lljit = binding.create_lljit_compiler(target_machine)
+        self.simd_width = host_simd_width(features)
+        # the libraries linked from object files
+        self.libraries = []
 
     def compile_module(self, module: ir.Module, export_functions: List[str] = []):
         ir_str = str(module)
@@ -24,3 +58,18 @@ class LLJITCompiler:
 
     def get_symbol(self, symbol_name: str):
         return self.rt[symbol_name]
+
+    def compile_module_to_object(self, module: ir.Module) -> bytes:
+        llvm_module = binding.parse_assembly(str(module))
+        llvm_module.verify()
+        return self.target_machine.emit_object(llvm_module)
+
+    def load_object(self, name: str, obj: bytes, export_functions: List[str] = []):
+        # every object file is linked as a separate library, so the same symbols can be defined
+        # in several of them
+        builder = binding.JITLibraryBuilder().add_object_img(obj).add_current_process()
+        for f in export_functions:
+            builder.export_symbol(f)
+        library = builder.link(self.lljit, name)
+        self.libraries.append(library)
+        return library
@@ -22,7 +22,7 @@ from .solver_common import (
     _direct_set_entity_attribute,
 )
 from .constraint_bridge import bridge_soc_quadratic_constraint
-from .aml import make_nd_variable
+from .aml import make_nd_variable_batch
 
 
 def detected_libraries():
@@ -358,7 +358,7 @@ class Model(RawModel):
         self.last_solve_return_code: Optional[int] = None
         self.silent = True
 
-        self.add_variables = types.MethodType(make_nd_variable, self)
+        self.add_variables = types.MethodType(make_nd_variable_batch, self)
 
     @staticmethod
     def supports_variable_attribute(attribute: VariableAttribute, settable=False):
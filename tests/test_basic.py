@@ -69,6 +69,38 @@ def test_basic():
     assert sqf.affine_part.constant == approx(6.0)
 
 
+def test_flat_exprbuilder():
+    vars = [poi.VariableIndex(i) for i in range(10)]
+
+    t = poi.FlatExprBuilder()
+    for i in reversed(range(10)):
+        t += 2.0 * vars[i]
+        t -= vars[i]
+    t += vars[3] * vars[1]
+    t += 2.0 * vars[1] * vars[3]
+    t += 3.0
+    assert t.degree() == 2
+
+    sqf = t.to_quadratic()
+    assert list(sqf.variable_1s) == [1]
+    assert list(sqf.variable_2s) == [3]
+    assert np.allclose(sqf.coefficients, [3.0])
+    assert list(sqf.affine_part.variables) == list(range(10))
+    assert np.allclose(sqf.affine_part.coefficients, [1.0] * 10)
+    assert sqf.affine_part.constant == approx(3.0)
+
+    N = 1000
+    saf = poi.flat_quicksum(vars[i % 10] * float(i) for i in range(N))
+    assert list(saf.variables) == list(range(10))
+    expected = [sum(float(i) for i in range(k, N, 10)) for k in range(10)]
+    assert np.allclose(saf.coefficients, expected)
+
+    t = poi.FlatExprBuilder(vars[0] - vars[0] + vars[1])
+    t.clean_nearzero_terms()
+    saf = t.to_affine()
+    assert list(saf.variables) == [1]
+
+
 def test_monotoneindexer():
     indexer = IntMonotoneIndexer()
 
@@ -85,3 +117,72 @@ def test_monotoneindexer():
         assert x == N - 1 - (i + 1)
         x = indexer.get_index(0)
         assert x == -1
+
+
+def test_monotoneindexer_get_indices():
+    indexer = IntMonotoneIndexer()
+
+    N = 300
+    for i in range(N):
+        indexer.add_index()
+    for i in range(0, N, 7):
+        indexer.delete_index(i)
+
+    # the ranks are tainted by the deletion before each batch lookup
+    sorted_indices = list(range(-2, N + 3))
+    indexer.delete_index(1)
+    result = indexer.get_indices(sorted_indices)
+    expected = [indexer.get_index(i) if 0 <= i < N else -1 for i in sorted_indices]
+    assert result == expected
+
+    shuffled = sorted_indices[::-1] + sorted_indices[::3]
+    indexer.delete_index(2)
+    result = indexer.get_indices(shuffled)
+    expected = [indexer.get_index(i) if 0 <= i < N else -1 for i in shuffled]
+    assert result == expected
+
+    assert indexer.get_indices([]) == []
+
+
+def test_monotoneindexer_delete_indices():
+    indexer = IntMonotoneIndexer()
+    reference = IntMonotoneIndexer()
+
+    N = 1000
+    for i in range(N):
+        indexer.add_index()
+        reference.add_index()
+
+    deleted = list(range(N - 1, 0, -3)) + [5000]
+    indexer.delete_indices(deleted)
+    for i in deleted:
+        reference.delete_index(i)
+    indexer.rebuild()
+
+    for i in range(N):
+        assert indexer.get_index(i) == reference.get_index(i)
+
+    for i in range(N, N + 100):
+        indexer.add_index()
+        reference.add_index()
+    indexer.delete_indices([2, N + 50])
+    reference.delete_index(2)
+    reference.delete_index(N + 50)
+    for i in range(N + 99, -1, -1):
+        assert indexer.get_index(i) == reference.get_index(i)
+
+
+def test_monotoneindexer_parallel_rebuild():
+    # large enough to be split between the threads
+    N = 64 * 1024 * 4 + 17
+    deleted = list(range(3, N, 7)) + list(range(N // 2, N // 2 + 5000))
+    results = []
+    for n_threads in [1, 3]:
+        indexer = IntMonotoneIndexer()
+        for i in range(N):
+            indexer.add_index()
+        indexer.delete_indices(deleted)
+        indexer.rebuild(n_threads=n_threads)
+        results.append(indexer.get_indices(list(range(N))))
+    assert results[0] == results[1]
+    assert max(results[0]) == N - 1 - len(set(deleted))
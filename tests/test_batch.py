@@ -0,0 +1,91 @@
+import pyoptinterface as poi
+import numpy as np
+from pytest import approx
+
+
+def test_add_variables_batch(model_interface):
+    model = model_interface
+
+    N = 10
+    x = model.add_variables(range(N), lb=1.0, ub=2.0, name="x")
+    assert len(x) == N
+    assert model.number_of_variables() == N
+    assert model.pprint(x[3]) == "x(3,)"
+
+    y = model.add_variables_batch(
+        3,
+        domains=[poi.VariableDomain.Continuous],
+        lbs=[0.0, 1.0, 2.0],
+        ubs=[10.0],
+    )
+    y = [poi.VariableIndex(y.index + i) for i in range(3)]
+    assert model.number_of_variables() == N + 3
+
+    obj = poi.quicksum(x.values()) + poi.quicksum(y)
+    model.set_objective(obj, poi.ObjectiveSense.Minimize)
+    model.optimize()
+    status = model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+    assert status == poi.TerminationStatusCode.OPTIMAL
+
+    for i in range(N):
+        assert model.get_value(x[i]) == approx(1.0)
+    for i, v in enumerate(y):
+        assert model.get_value(v) == approx(float(i))
+
+
+def test_add_linear_constraints_batch(model_interface):
+    model = model_interface
+
+    N = 4
+    x = model.add_variables(range(N), lb=0.0, ub=10.0)
+    indices = np.array([x[i].index for i in range(N)], dtype=np.int32)
+
+    # x[i] + x[i+1] >= i + 1 for i in [0, N-1)
+    row_starts = np.arange(0, 2 * N - 1, 2, dtype=np.int32)
+    variables = np.stack([indices[:-1], indices[1:]], axis=1).ravel()
+    coefficients = np.ones(2 * (N - 1))
+    rhss = np.arange(1.0, N)
+    con = model.add_linear_constraints_batch(
+        row_starts,
+        variables,
+        coefficients,
+        [poi.ConstraintSense.GreaterEqual],
+        rhss,
+    )
+    assert con.index == 0
+    assert model.number_of_constraints(poi.ConstraintType.Linear) == N - 1
+
+    model.set_objective(poi.quicksum(x.values()), poi.ObjectiveSense.Minimize)
+    model.optimize()
+    status = model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+    assert status == poi.TerminationStatusCode.OPTIMAL
+
+    for i in range(N - 1):
+        value = model.get_value(x[i]) + model.get_value(x[i + 1])
+        assert value >= i + 1 - 1e-6
+    assert model.get_model_attribute(poi.ModelAttribute.ObjectiveValue) == approx(4.0)
+
+
+def test_get_values_batch(model_interface):
+    model = model_interface
+
+    N = 5
+    x = [model.add_variable(lb=float(i), ub=10.0) for i in range(N)]
+    cons = [model.add_linear_constraint(x[i], poi.Geq, i + 1.0) for i in range(N)]
+
+    model.set_objective(poi.quicksum(x), poi.ObjectiveSense.Minimize)
+    model.optimize()
+    status = model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+    assert status == poi.TerminationStatusCode.OPTIMAL
+
+    values = model.get_variable_values(x)
+    assert values == approx(np.arange(1.0, N + 1))
+    indices = np.array([v.index for v in reversed(x)], dtype=np.int32)
+    values = model.get_variable_values(indices)
+    assert values == approx(np.arange(N, 0.0, -1))
+
+    duals = model.get_constraint_duals(cons)
+    expected = [model.get_constraint_attribute(c, poi.ConstraintAttribute.Dual) for c in cons]
+    assert duals == approx(np.array(expected))
+    indices = np.array([c.index for c in cons], dtype=np.int32)
+    assert model.get_constraint_duals(indices) == approx(duals)
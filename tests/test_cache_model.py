@@ -0,0 +1,201 @@
+import pyoptinterface as poi
+import numpy as np
+from pytest import approx
+
+
+def test_cache_model(model_interface):
+    model = model_interface
+
+    cache = poi.CacheModel()
+    x = cache.add_variables(range(3), lb=0.0, ub=10.0, name="x")
+    y = cache.add_variable(lb=0.0, ub=10.0, name="y")
+    z = cache.add_variable(lb=0.0, ub=10.0)
+    assert cache.number_of_variables() == 5
+
+    c = cache.add_linear_constraint(x[0] + x[1], poi.Geq, 1.0, name="c")
+    cache.add_linear_constraints_batch(
+        np.array([0, 2, 4], dtype=np.int32),
+        np.array([x[1].index, x[2].index, x[2].index, y.index], dtype=np.int32),
+        np.array([1.0, 1.0, 1.0, 1.0]),
+        [poi.Geq],
+        np.array([2.0, 3.0]),
+    )
+    deleted = cache.add_linear_constraint(z, poi.Geq, 5.0)
+    cache.delete_constraint(deleted)
+    cache.delete_variable(z)
+    assert not cache.is_variable_active(z)
+    assert not cache.is_constraint_active(deleted)
+    assert cache.number_of_variables() == 4
+    assert cache.number_of_constraints(poi.ConstraintType.Linear) == 3
+
+    cache.set_objective(x[0] + x[1] + x[2] + y + 1.0)
+
+    handles = cache.flush(model)
+    assert handles.variable(y).index == y.index
+    assert model.is_constraint_active(handles.constraint(c))
+    assert not model.is_constraint_active(handles.constraint(deleted))
+    assert model.number_of_variables() == 4
+    assert model.number_of_constraints(poi.ConstraintType.Linear) == 3
+    assert model.is_variable_active(y)
+    assert not model.is_variable_active(z)
+
+    model.optimize()
+    status = model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+    assert status == poi.TerminationStatusCode.OPTIMAL
+    obj = model.get_model_attribute(poi.ModelAttribute.ObjectiveValue)
+    assert obj == approx(5.0)
+
+    x_val = [model.get_value(x[i]) for i in range(3)]
+    y_val = model.get_value(y)
+    assert x_val[0] + x_val[1] >= 1.0 - 1e-6
+    assert x_val[1] + x_val[2] >= 2.0 - 1e-6
+    assert x_val[2] + y_val >= 3.0 - 1e-6
+
+
+def test_cache_model_write(tmp_path):
+    cache = poi.CacheModel()
+    x = cache.add_variable(lb=0.0, ub=10.0, name="x")
+    y = cache.add_variable(domain=poi.VariableDomain.Integer, lb=-1.0, name="y")
+    z = cache.add_variable(name="z")
+    cache.add_linear_constraint(x + 2.0 * y, poi.Leq, 3.0, name="c")
+    cache.add_linear_constraint(x - z, poi.Geq, 1.0)
+    cache.delete_variable(z)
+    cache.set_objective(x * x + y, poi.ObjectiveSense.Maximize)
+
+    lp_file = tmp_path / "model.lp"
+    cache.write(str(lp_file))
+    lp = lp_file.read_text()
+    assert lp.startswith("\\ Problem written by PyOptInterface\nMaximize\n")
+    assert " c: + 1 x + 2 y <= 3\n" in lp
+    assert " c1: + 1 x >= 1\n" in lp
+    assert " 0 <= x <= 10\n" in lp
+    assert "General\n y\n" in lp
+    assert "z" not in lp
+
+    mps_file = tmp_path / "model.mps"
+    cache.write(str(mps_file))
+    mps = mps_file.read_text()
+    assert "OBJSENSE\n    MAX\n" in mps
+    assert "ROWS\n N  obj\n L  c\n G  c1\n" in mps
+    assert "    MARKER 'MARKER' 'INTORG'\n    y c 2\n    y obj 1\n" in mps
+    assert "QUADOBJ\n    x x 2\n" in mps
+    assert mps.endswith("ENDATA\n")
+
+
+def test_cache_model_write_names(tmp_path):
+    cache = poi.CacheModel()
+    x = cache.add_variable(name="x1")
+    y = cache.add_variable()
+    cache.add_linear_constraint(x + y, poi.Leq, 1.0, name="c1")
+    cache.add_linear_constraint(x - y, poi.Geq, 0.0)
+    cache.add_linear_constraint(x + 2.0 * y, poi.Geq, 0.0)
+
+    # the default names of unnamed items do not collide with the given names
+    lp_file = tmp_path / "model.lp"
+    cache.write(str(lp_file))
+    lp = lp_file.read_text()
+    assert "Minimize\n obj:\nSubject To\n" in lp
+    assert " c1: + 1 x1 + 1 x1_ <= 1\n" in lp
+    assert " c1_: + 1 x1 - 1 x1_ >= 0\n" in lp
+    assert " c2: + 1 x1 + 2 x1_ >= 0\n" in lp
+
+    variables, constraints = poi.CacheModel().read(str(lp_file))
+    assert set(variables) == {"x1", "x1_"}
+    assert set(constraints) == {"c1", "c1_", "c2"}
+
+    # the rows are formatted in parallel, the file stays the same
+    parallel_file = tmp_path / "parallel.lp"
+    cache.write(str(parallel_file), n_threads=3)
+    assert parallel_file.read_text() == lp
+
+
+def test_cache_model_write_cone(tmp_path):
+    cache = poi.CacheModel()
+    t = cache.add_variable(lb=-1.0, ub=10.0, name="t")
+    # the names that cannot be written are replaced by default names
+    x = cache.add_variable(name="1x")
+    y = cache.add_variable(name="y + 1")
+    z = cache.add_variable(name="end")
+    cache.add_second_order_cone_constraint([t, x, y, z], name="soc")
+
+    lp_file = tmp_path / "model.lp"
+    cache.write(str(lp_file))
+    lp = lp_file.read_text()
+    assert " soc: + [ - 1 t ^ 2 + 1 x1 ^ 2 + 1 x2 ^ 2 + 1 x3 ^ 2 ] <= 0\n" in lp
+    # t of the cone is nonnegative
+    assert " 0 <= t <= 10\n" in lp
+
+    variables, constraints = poi.CacheModel().read(str(lp_file))
+    assert set(variables) == {"t", "x1", "x2", "x3"}
+    assert set(constraints) == {"soc"}
+
+
+def test_cache_model_read(tmp_path, model_interface):
+    model = model_interface
+
+    lp_file = tmp_path / "model.lp"
+    lp_file.write_text(
+        """\\ a small LP
+Minimize
+ obj: x + 2 y + 3 z
+Subject To
+ c1: x + y >= 1
+ y + z >= 2
+Bounds
+ x <= 10
+ -1 <= z <= 5
+End
+"""
+    )
+    cache = poi.CacheModel()
+    variables, constraints = cache.read(str(lp_file))
+    assert set(variables) == {"x", "y", "z"}
+    assert set(constraints) == {"c1", "R2"}
+    assert cache.number_of_variables() == 3
+    assert cache.number_of_constraints(poi.ConstraintType.Linear) == 2
+
+    # read the MPS file written from the LP file again
+    mps_file = tmp_path / "model.mps"
+    cache.write(str(mps_file))
+    cache = poi.CacheModel()
+    variables, constraints = cache.read(str(mps_file))
+    assert set(constraints) == {"c1", "R2"}
+
+    cache.flush(model)
+    model.optimize()
+    status = model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+    assert status == poi.TerminationStatusCode.OPTIMAL
+    obj = model.get_model_attribute(poi.ModelAttribute.ObjectiveValue)
+    assert obj == approx(3.0)
+    assert model.get_value(variables["x"]) == approx(0.0, abs=1e-6)
+    assert model.get_value(variables["y"]) == approx(3.0)
+    assert model.get_value(variables["z"]) == approx(-1.0)
+
+
+def test_cache_model_snapshot(tmp_path, model_interface):
+    model = model_interface
+
+    cache = poi.CacheModel()
+    x = cache.add_variables(range(3), lb=0.0, ub=10.0, name="x")
+    z = cache.add_variable(lb=0.0, ub=10.0, name="z")
+    c = cache.add_linear_constraint(x[0] + x[1] + x[2], poi.Geq, 3.0, name="c")
+    deleted = cache.add_linear_constraint(x[0] + z, poi.Geq, 5.0)
+    cache.delete_constraint(deleted)
+    cache.delete_variable(z)
+    cache.set_objective(x[0] + 2.0 * x[1] + 3.0 * x[2])
+
+    snapshot = tmp_path / "model.snapshot"
+    cache.save_snapshot(str(snapshot))
+
+    loaded = poi.CacheModel()
+    loaded.load_snapshot(str(snapshot))
+    assert loaded.number_of_variables() == 3
+    assert not loaded.is_variable_active(z)
+    assert loaded.is_constraint_active(c)
+    assert not loaded.is_constraint_active(deleted)
+
+    loaded.flush(model)
+    model.optimize()
+    obj = model.get_model_attribute(poi.ModelAttribute.ObjectiveValue)
+    assert obj == approx(3.0)
+    assert model.get_value(x[0]) == approx(3.0)
@@ -178,7 +178,395 @@ def test_nlp_param():
 
     assert x_values == pytest.approx(correct_x_values)
 
+    assert model.get_eval_cache_misses() > 0
+
+    # the constraints are stored once they are requested twice at the same x, so the
+    # third request is answered by the cache
+    hits = model.get_eval_cache_hits()
+    g = model.eval_constraints(x_values)
+    for _ in range(2):
+        assert model.eval_constraints(x_values, new_x=False) == g
+    assert model.get_eval_cache_hits() > hits
+    assert g == pytest.approx([1.0] * N)
+
+
+def test_nlp_resolve():
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+
+    model = ipopt.Model()
+
+    N = 10
+    xs = []
+    for i in range(N):
+        x = model.add_variable(lb=0.0, ub=10.0, start=1.0)
+        xs.append(x)
+
+    def obj(vars):
+        return poi.exp(vars[0])
+
+    obj_f = model.register_function(obj, var=1, name="obj")
+
+    for i in range(N):
+        model.add_nl_objective(obj_f, [xs[i]])
+
+    def con(vars, params):
+        x = vars[0]
+        p = params[0]
+        return x * (p + 1) * (p + 1)
+
+    con_f = model.register_function(con, var=1, param=1, name="con")
+
+    ps = [model.add_parameter(float(i)) for i in range(N)]
+    for i in range(N):
+        model.add_nl_constraint(con_f, [xs[i]], [ps[i]], poi.Geq, [1.0])
+
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    assert x_values == pytest.approx([1.0 / (i + 1) / (i + 1) for i in range(N)])
+
+    # only parameters and bounds change, the structure of the previous solve is reused
+    for i in range(N):
+        model.set_parameter(ps[i], float(i + 1))
+    model.set_variable_attribute(xs[0], poi.VariableAttribute.LowerBound, 0.5)
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    correct_x_values = [1.0 / (i + 2) / (i + 2) for i in range(N)]
+    correct_x_values[0] = 0.5
+    assert x_values == pytest.approx(correct_x_values)
+
+    # a new constraint changes the structure
+    model.add_linear_constraint(xs[1], poi.Geq, 0.5)
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    correct_x_values[1] = 0.5
+    assert x_values == pytest.approx(correct_x_values)
+
+
+def test_nlp_warm_start():
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+
+    model = ipopt.Model()
+
+    N = 10
+    xs = [model.add_variable(lb=0.0, ub=10.0, start=1.0) for i in range(N)]
+
+    def obj(vars):
+        return poi.exp(vars[0])
+
+    obj_f = model.register_function(obj, var=1, name="obj")
+    for i in range(N):
+        model.add_nl_objective(obj_f, [xs[i]])
+
+    def con(vars, params):
+        return vars[0] * (params[0] + 1) * (params[0] + 1)
+
+    con_f = model.register_function(con, var=1, param=1, name="con")
+    ps = [model.add_parameter(float(i)) for i in range(N)]
+    for i in range(N):
+        model.add_nl_constraint(con_f, [xs[i]], [ps[i]], poi.Geq, [1.0])
+
+    model.set_warm_start(True)
+    model.optimize()
+    x, mult_g, mult_x_L, mult_x_U = model.get_warm_start_point()
+    assert len(x) == N and len(mult_g) == N
+    assert x == pytest.approx([1.0 / (i + 1) / (i + 1) for i in range(N)])
+
+    # the parameters move by one step, so does the solution
+    for i in range(N):
+        model.set_parameter(ps[i], float(i + 1))
+    model.shift_warm_start_point(xs)
+    x, _, _, _ = model.get_warm_start_point()
+    assert x[:-1] == pytest.approx([1.0 / (i + 2) / (i + 2) for i in range(N - 1)])
+
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    assert x_values == pytest.approx([1.0 / (i + 2) / (i + 2) for i in range(N)])
+
+    # a solve stopped early does not replace the starting point of the next solve
+    model.set_raw_parameter("max_iter", 0)
+    model.optimize()
+    model.set_raw_parameter("max_iter", 3000)
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    assert x_values == pytest.approx([1.0 / (i + 2) / (i + 2) for i in range(N)])
+
+    # warm_start_init_point set by the user is respected
+    model.set_warm_start(False)
+    model.set_raw_parameter("warm_start_init_point", "yes")
+    model.optimize()
+    x_values = [model.get_value(x) for x in xs]
+    assert x_values == pytest.approx([1.0 / (i + 2) / (i + 2) for i in range(N)])
+
+    with pytest.raises(RuntimeError):
+        model.set_warm_start_point([0.0], [], [], [])
+
+
+def test_nlp_evaluation():
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+
+    model = ipopt.Model()
+    x0, x1, x2, x3 = [model.add_variable(lb=-5.0, ub=5.0) for _ in range(4)]
+
+    # the nonlinear terms share hessian entries with the quadratic terms
+    model.set_objective(x0 * x0 + 3.0 * x0 * x1 + 2.0 * x2 + 1.0)
+
+    def obj(vars):
+        return poi.exp(vars[0]) * vars[1]
+
+    obj_f = model.register_function(obj, var=2, name="obj")
+    model.add_nl_objective(obj_f, [x0, x1])
+
+    model.add_linear_constraint(x0 + 2.0 * x3, poi.Eq, 1.0)
+    model.add_quadratic_constraint(x1 * x2 + 0.5 * x3 * x3 + x0, poi.Leq, 5.0)
+
+    def con(vars):
+        return vars[0] * vars[1] * vars[1]
+
+    con_f = model.register_function(con, var=2, name="con")
+    model.add_nl_constraint(con_f, [x0, x1], poi.Geq, [0.0])
+
+    def dense(rows, cols, values, n_rows, n_cols):
+        matrix = [[0.0] * n_cols for _ in range(n_rows)]
+        for r, c, v in zip(rows, cols, values):
+            matrix[r][c] += v
+        return matrix
+
+    model.prepare_functions()
+    jacobian_rows, jacobian_cols = model.get_jacobian_structure()
+    hessian_rows, hessian_cols = model.get_hessian_structure()
+    assert all(r >= c for r, c in zip(hessian_rows, hessian_cols))
+
+    # the constant parts are refreshed at every evaluation, so several points are
+    # compared
+    for x, sigma, lambdas in [
+        ([0.5, -1.0, 2.0, 0.25], 1.0, [0.3, -2.0, 1.5]),
+        ([-1.0, 2.0, 0.5, -3.0], 2.5, [1.0, 0.5, -0.75]),
+    ]:
+        a, b, c, d = x
+        e = math.exp(a)
+
+        f = a * a + 3.0 * a * b + 2.0 * c + 1.0 + e * b
+        assert model.eval_objective(x) == pytest.approx(f)
+
+        grad = [2.0 * a + 3.0 * b + e * b, 3.0 * a + e, 2.0, 0.0]
+        assert model.eval_objective_gradient(x) == pytest.approx(grad)
+
+        g = [a + 2.0 * d, b * c + 0.5 * d * d + a, a * b * b]
+        assert model.eval_constraints(x) == pytest.approx(g)
+
+        jacobian = [
+            [1.0, 0.0, 0.0, 2.0],
+            [1.0, c, b, d],
+            [b * b, 2.0 * a * b, 0.0, 0.0],
+        ]
+        values = model.eval_constraint_jacobian(x)
+        assert dense(jacobian_rows, jacobian_cols, values, 3, 4) == [
+            pytest.approx(row) for row in jacobian
+        ]
+
+        _, l1, l2 = lambdas
+        hessian = [
+            [sigma * (2.0 + e * b), 0.0, 0.0, 0.0],
+            [sigma * (3.0 + e) + l2 * 2.0 * b, l2 * 2.0 * a, 0.0, 0.0],
+            [0.0, l1, 0.0, 0.0],
+            [0.0, 0.0, 0.0, l1],
+        ]
+        values = model.eval_lagrangian_hessian(x, sigma, lambdas)
+        assert dense(hessian_rows, hessian_cols, values, 4, 4) == [
+            pytest.approx(row) for row in hessian
+        ]
+
+
+def has_c_compiler():
+    from pyoptinterface._src.jit_cc import find_c_compiler
+
+    return find_c_compiler() is not None
+
+
+def build_nlp_model(n_threads=1, defer=False, jit_cache_dir=None):
+    model = ipopt.Model(jit_cache_dir=jit_cache_dir)
+    model.set_model_attribute(poi.ModelAttribute.NumberOfThreads, n_threads)
+    assert model.get_model_attribute(poi.ModelAttribute.NumberOfThreads) == n_threads
+
+    # the number of instances is not a multiple of the simd width
+    N = 11
+    xs = [model.add_variable(lb=0.1, ub=10.0, start=1.0) for _ in range(N)]
+
+    def obj(vars):
+        return poi.exp(vars[0]) + poi.sqrt(vars[1]) * vars[0]
+
+    # the same graph under another name shares the cached kernels
+    obj_f = model.register_function(obj, var=2, name="obj", defer=defer)
+    obj_g = model.register_function(obj, var=2, name="obj_copy", defer=defer)
+    for i in range(N):
+        f = obj_f if i % 2 == 0 else obj_g
+        model.add_nl_objective(f, [xs[i], xs[(i + 3) % N]])
+
+    def con(vars, params):
+        x = vars[0]
+        y = vars[1]
+        p = params[0]
+        return [x * y * (p + 1), poi.log(x) + y * y]
+
+    con_f = model.register_function(con, var=2, param=1, name="con", defer=defer)
+    for i in range(N):
+        model.add_nl_constraint(
+            con_f, [xs[i], xs[(i + 1) % N]], [i % 3], poi.Geq, [1.0, 0.5]
+        )
+
+    return model, xs
+
+
+def solve_nlp_model(
+    jit_engine="LLVM", simd_width=1, n_threads=1, defer=False, jit_cache_dir=None
+):
+    model, xs = build_nlp_model(n_threads, defer, jit_cache_dir)
+    model.optimize(jit_engine=jit_engine, simd_width=simd_width)
+
+    assert (
+        model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+        == poi.TerminationStatusCode.LOCALLY_SOLVED
+    )
+    return [model.get_value(x) for x in xs]
+
+
+@pytest.mark.parametrize("n_threads", [2, 4])
+@pytest.mark.parametrize("defer", [False, True])
+def test_nlp_threads(n_threads, defer):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+
+    # with defer=True the functions are initialized in parallel
+    x_values = solve_nlp_model(n_threads=n_threads, defer=defer)
+    assert x_values == pytest.approx(solve_nlp_model())
+
+
+@pytest.mark.parametrize("simd_width", [2, 4, 8, None])
+def test_nlp_simd(simd_width):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+
+    x_values = solve_nlp_model(simd_width=simd_width)
+    assert x_values == pytest.approx(solve_nlp_model())
+
+
+@pytest.mark.parametrize("jit_engine", ["C", "CC"])
+def test_nlp_jit_engines(jit_engine):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+    if jit_engine == "CC" and not has_c_compiler():
+        pytest.skip("No C compiler is found")
+
+    x_values = solve_nlp_model(jit_engine=jit_engine, simd_width=None)
+    assert x_values == pytest.approx(solve_nlp_model())
+
+
+@pytest.mark.parametrize("jit_engine", ["LLVM", "C", "CC"])
+def test_nlp_jit_cache(tmp_path, jit_engine):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+    if jit_engine == "CC" and not has_c_compiler():
+        pytest.skip("No C compiler is found")
+
+    x_values = solve_nlp_model(jit_engine=jit_engine, jit_cache_dir=tmp_path)
+    files = sorted(p.name for p in tmp_path.iterdir())
+    assert len([f for f in files if f.endswith(".analysis")]) == 2
+    assert len(files) == 4
+
+    assert solve_nlp_model(
+        jit_engine=jit_engine, jit_cache_dir=tmp_path
+    ) == pytest.approx(x_values)
+    assert sorted(p.name for p in tmp_path.iterdir()) == files
+
+
+def build_objective_sum_model(n_threads=1, compensated=False):
+    model = ipopt.Model()
+    model.set_compensated_objective_sum(compensated)
+    assert model.get_compensated_objective_sum() == compensated
+    model.set_model_attribute(poi.ModelAttribute.NumberOfThreads, n_threads)
+
+    # all terms share one kernel, the number of terms is not a multiple of the simd
+    # width
+    N = 1001
+    params = [1.0 + 0.5 * (i % 7) for i in range(N)]
+    xs = [model.add_variable(lb=-5.0, ub=5.0, start=1.0) for _ in range(N)]
+
+    def obj(vars, params):
+        return poi.exp(vars[0]) - params[0] * vars[0]
+
+    obj_f = model.register_function(obj, var=1, param=1, name="obj")
+    for x, p in zip(xs, params):
+        model.add_nl_objective(obj_f, [x], [p])
+
+    return model, xs, params
+
+
+@pytest.mark.parametrize("jit_engine", ["LLVM", "C", "CC"])
+@pytest.mark.parametrize("compensated", [False, True])
+@pytest.mark.parametrize("n_threads", [1, 3])
+def test_nlp_objective_sum(jit_engine, compensated, n_threads):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+    if jit_engine == "CC" and not has_c_compiler():
+        pytest.skip("No C compiler is found")
+
+    model, xs, params = build_objective_sum_model(n_threads, compensated)
+    model.optimize(jit_engine=jit_engine)
+
+    assert (
+        model.get_model_attribute(poi.ModelAttribute.TerminationStatus)
+        == poi.TerminationStatusCode.LOCALLY_SOLVED
+    )
+    # every term is minimized at x = log(p)
+    for x, p in zip(xs, params):
+        assert model.get_value(x) == pytest.approx(math.log(p), rel=1e-6, abs=1e-6)
+    expected = sum(p - p * math.log(p) for p in params)
+    assert model.get_model_attribute(
+        poi.ModelAttribute.ObjectiveValue
+    ) == pytest.approx(expected)
+
+
+@pytest.mark.parametrize("jit_engine", ["LLVM", "C", "CC"])
+@pytest.mark.parametrize("n_threads", [1, 3])
+def test_nlp_objective_instances(jit_engine, n_threads):
+    if not ipopt.is_library_loaded():
+        pytest.skip("Ipopt library is not loaded")
+    if jit_engine == "CC" and not has_c_compiler():
+        pytest.skip("No C compiler is found")
+
+    # every instance of the kernel contributes to the objective, not only the last one
+    model, xs, params = build_objective_sum_model(n_threads)
+    model.prepare_functions(jit_engine=jit_engine)
+
+    x = [0.25 * (i % 5) - 0.5 for i in range(len(xs))]
+    expected = sum(math.exp(xi) - p * xi for xi, p in zip(x, params))
+    assert model.eval_objective(x) == pytest.approx(expected)
+
+    grad = [math.exp(xi) - p for xi, p in zip(x, params)]
+    assert model.eval_objective_gradient(x) == pytest.approx(grad)
+
 
 if __name__ == "__main__":
     test_ipopt()
     test_nlp_param()
+    test_nlp_resolve()
+    test_nlp_warm_start()
+    test_nlp_evaluation()
+    for n_threads in [2, 4]:
+        for defer in [False, True]:
+            test_nlp_threads(n_threads, defer)
+    for simd_width in [2, 4, 8, None]:
+        test_nlp_simd(simd_width)
+    jit_engines = ["LLVM", "C"]
+    if has_c_compiler():
+        jit_engines.append("CC")
+    for jit_engine in jit_engines[1:]:
+        test_nlp_jit_engines(jit_engine)
+    for jit_engine in jit_engines:
+        for n_threads in [1, 3]:
+            for compensated in [False, True]:
+                test_nlp_objective_sum(jit_engine, compensated, n_threads)
+            test_nlp_objective_instances(jit_engine, n_threads)